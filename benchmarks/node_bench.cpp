@@ -0,0 +1,292 @@
+// Copyright (c) 2021 Tim Perkins
+
+#include <benchmark/benchmark.h>
+
+#include <tsig/signal.hpp>
+#include <tsig/tn/executor.hpp>
+#include <tsig/tn/node.hpp>
+#include <tsig/tn/synchronizer.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace {
+
+using PassNode = tsig::tn::Node<tsig::tn::WithInputs<int>, tsig::tn::WithOutputs<int>>;
+using EndNode = tsig::tn::Node<tsig::tn::WithInputs<int>, tsig::tn::WithoutOutputs>;
+
+class PassTask {
+ public:
+  tsig::tn::DataHandlerTuple<int> GetHandlers()
+  {
+    return {[this](const int& x) { output_sink_(x + 1); }};
+  }
+
+  void SetSinks(const tsig::tn::DataSinkTuple<int>& sinks)
+  {
+    output_sink_ = std::get<0>(sinks);
+  }
+
+ private:
+  tsig::tn::DataSink<int> output_sink_;
+};
+
+class EndTask {
+ public:
+  tsig::tn::DataHandlerTuple<int> GetHandlers()
+  {
+    return {[this](const int& x) { total_ += x; }};
+  }
+
+  void SetSinks(tsig::tn::DataSinkTuple<>)
+  {
+    // Do nothing
+  }
+
+  int Total() const
+  {
+    return total_;
+  }
+
+ private:
+  int total_ = 0;
+};
+
+// Does some slow work for each value, like a detector
+class BusyTask {
+ public:
+  tsig::tn::DataHandlerTuple<int> GetHandlers()
+  {
+    return {[this](const int& x) {
+      unsigned hash = static_cast<unsigned>(x);
+      for (std::size_t ii = 0; ii < 20000u; ++ii) {
+        hash = hash * 31u + static_cast<unsigned>(ii);
+      }
+      total_ += hash;
+    }};
+  }
+
+  void SetSinks(tsig::tn::DataSinkTuple<>)
+  {
+    // Do nothing
+  }
+
+  unsigned Total() const
+  {
+    return total_;
+  }
+
+ private:
+  unsigned total_ = 0u;
+};
+
+// Keeps the latest point cloud, like a detector waiting for another
+template <typename PortType>
+class KeepTask {
+ public:
+  tsig::tn::DataHandlerTuple<PortType> GetHandlers()
+  {
+    return {[this](const tsig::tn::PortData<PortType>& data) { data_ = data; }};
+  }
+
+  void SetSinks(tsig::tn::DataSinkTuple<>)
+  {
+    // Do nothing
+  }
+
+ private:
+  tsig::tn::PortData<PortType> data_;
+};
+
+void MakePointCloud(std::vector<int>& point_cloud)
+{
+  point_cloud.assign(100000u, 1);
+}
+
+void MakePointCloud(std::shared_ptr<const std::vector<int>>& point_cloud_ptr)
+{
+  point_cloud_ptr = std::make_shared<const std::vector<int>>(100000u, 1);
+}
+
+void SetSinks(PassNode& node, PassTask& task)
+{
+  task.SetSinks(tsig::tn::DataSinkTuple<int>(node.GetSink<0>()));
+}
+
+void SetSinks(EndNode&, EndTask&)
+{
+  // Do nothing
+}
+
+void SetSinks(EndNode&, BusyTask&)
+{
+  // Do nothing
+}
+
+// Nodes keep pointers to themselves in their sinks, so they are built in place rather than with
+// the node builder, which returns them by value
+template <typename NodeType, typename TaskType>
+std::unique_ptr<NodeType> MakeNode(TaskType& task)
+{
+  std::unique_ptr<NodeType> node(new NodeType());
+  node->template RegisterHandler<0>(std::get<0>(task.GetHandlers()));
+  SetSinks(*node, task);
+  return node;
+}
+
+}  // namespace
+
+static void BM_NodePipeline(benchmark::State& state)
+{
+  const std::size_t num_stages = static_cast<std::size_t>(state.range(0));
+  tsig::Signal<void(const int&)> source;
+  std::vector<std::unique_ptr<PassTask>> pass_tasks;
+  std::vector<std::unique_ptr<PassNode>> pass_nodes;
+  for (std::size_t ii = 0; ii < num_stages; ++ii) {
+    pass_tasks.emplace_back(new PassTask());
+    pass_nodes.push_back(MakeNode<PassNode>(*pass_tasks.back()));
+    if (ii == 0) {
+      pass_nodes.back()->Accept<0>(source);
+    }
+    else {
+      pass_nodes[ii - 1]->Connect<0, 0>(*pass_nodes.back());
+    }
+  }
+  EndTask end_task;
+  std::unique_ptr<EndNode> end_node = MakeNode<EndNode>(end_task);
+  pass_nodes.back()->Connect<0, 0>(*end_node);
+  for (auto _ : state) {
+    source.Emit(1);
+    benchmark::ClobberMemory();
+  }
+  benchmark::DoNotOptimize(end_task.Total());
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(num_stages));
+}
+BENCHMARK(BM_NodePipeline)->Arg(1)->Arg(4)->Arg(16);
+
+static void BM_NodeFanOut(benchmark::State& state)
+{
+  const std::size_t num_branches = static_cast<std::size_t>(state.range(0));
+  tsig::Signal<void(const int&)> source;
+  PassTask pass_task;
+  std::unique_ptr<PassNode> pass_node = MakeNode<PassNode>(pass_task);
+  pass_node->Accept<0>(source);
+  std::vector<std::unique_ptr<EndTask>> end_tasks;
+  std::vector<std::unique_ptr<EndNode>> end_nodes;
+  for (std::size_t ii = 0; ii < num_branches; ++ii) {
+    end_tasks.emplace_back(new EndTask());
+    end_nodes.push_back(MakeNode<EndNode>(*end_tasks.back()));
+    pass_node->Connect<0, 0>(*end_nodes.back());
+  }
+  for (auto _ : state) {
+    source.Emit(1);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(num_branches));
+}
+BENCHMARK(BM_NodeFanOut)->Arg(1)->Arg(10)->Arg(100);
+
+template <bool USE_EXECUTOR>
+static void BM_NodeFanOutBusy(benchmark::State& state)
+{
+  const std::size_t num_branches = static_cast<std::size_t>(state.range(0));
+  tsig::tn::Executor executor(USE_EXECUTOR ? num_branches : 1u);
+  tsig::Signal<void(const int&)> source;
+  std::vector<std::unique_ptr<BusyTask>> busy_tasks;
+  std::vector<std::unique_ptr<EndNode>> busy_nodes;
+  for (std::size_t ii = 0; ii < num_branches; ++ii) {
+    busy_tasks.emplace_back(new BusyTask());
+    busy_nodes.push_back(MakeNode<EndNode>(*busy_tasks.back()));
+    if (USE_EXECUTOR) {
+      busy_nodes.back()->RunOn(executor);
+    }
+    busy_nodes.back()->Accept<0>(source);
+  }
+  for (auto _ : state) {
+    source.Emit(1);
+    executor.WaitIdle();
+  }
+  for (const std::unique_ptr<BusyTask>& busy_task : busy_tasks) {
+    benchmark::DoNotOptimize(busy_task->Total());
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(num_branches));
+}
+template <typename PortType>
+static void BM_NodeFanOutKeep(benchmark::State& state)
+{
+  // Each branch keeps the point cloud
+  using KeepNode = tsig::tn::Node<tsig::tn::WithInputs<PortType>, tsig::tn::WithoutOutputs>;
+  const std::size_t num_branches = static_cast<std::size_t>(state.range(0));
+  tsig::Signal<void(const tsig::tn::PortData<PortType>&)> source;
+  std::vector<std::unique_ptr<KeepTask<PortType>>> keep_tasks;
+  std::vector<std::unique_ptr<KeepNode>> keep_nodes;
+  for (std::size_t ii = 0; ii < num_branches; ++ii) {
+    keep_tasks.emplace_back(new KeepTask<PortType>());
+    keep_nodes.emplace_back(new KeepNode());
+    keep_nodes.back()->template RegisterHandler<0>(std::get<0>(keep_tasks.back()->GetHandlers()));
+    keep_nodes.back()->template Accept<0>(source);
+  }
+  tsig::tn::PortData<PortType> data;
+  MakePointCloud(data);
+  for (auto _ : state) {
+    source.Emit(data);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(num_branches));
+}
+BENCHMARK_TEMPLATE(BM_NodeFanOutKeep, std::vector<int>)->Arg(4);
+BENCHMARK_TEMPLATE(BM_NodeFanOutKeep, tsig::tn::Shared<std::vector<int>>)->Arg(4);
+
+template <bool USE_POOL>
+static void BM_NodeSharedSend(benchmark::State& state)
+{
+  // The producer fills a new point cloud every frame, and the consumer lets it go
+  using SharedPointCloud = tsig::tn::Shared<std::vector<int>>;
+  using KeepNode =
+      tsig::tn::Node<tsig::tn::WithInputs<SharedPointCloud>, tsig::tn::WithoutOutputs>;
+  using SourceNode =
+      tsig::tn::Node<tsig::tn::WithoutInputs, tsig::tn::WithOutputs<SharedPointCloud>>;
+  SourceNode source_node;
+  KeepTask<SharedPointCloud> keep_task;
+  KeepNode keep_node;
+  keep_node.RegisterHandler<0>(std::get<0>(keep_task.GetHandlers()));
+  source_node.Connect<0, 0>(keep_node);
+  tsig::tn::DataSink<SharedPointCloud> sink = source_node.GetSink<0>();
+  for (auto _ : state) {
+    std::shared_ptr<std::vector<int>> point_cloud_ptr =
+        USE_POOL ? sink.Acquire() : std::make_shared<std::vector<int>>();
+    point_cloud_ptr->assign(100000u, 1);
+    sink(std::move(point_cloud_ptr));
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_NodeSharedSend, false);
+BENCHMARK_TEMPLATE(BM_NodeSharedSend, true);
+
+static void BM_SyncExactTime(benchmark::State& state)
+{
+  // Every other message of the first input is matched
+  struct Scan {
+    int stamp;
+  };
+  int total = 0;
+  tsig::tn::Synchronizer<tsig::tn::ExactTime<>, Scan, Scan> sync(
+      [&total](const Scan& scan_a, const Scan&) { total += scan_a.stamp; });
+  int stamp = 0;
+  for (auto _ : state) {
+    sync.Handle<0>(Scan{stamp});
+    if (stamp % 2 == 0) {
+      sync.Handle<1>(Scan{stamp});
+    }
+    ++stamp;
+  }
+  benchmark::DoNotOptimize(total);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SyncExactTime);
+
+BENCHMARK_TEMPLATE(BM_NodeFanOutBusy, false)->Arg(4)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_NodeFanOutBusy, true)->Arg(4)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,586 @@
+// Copyright (c) 2021 Tim Perkins
+
+#include <benchmark/benchmark.h>
+
+#include <tsig/coalescing_signal.hpp>
+#include <tsig/dispatcher.hpp>
+#include <tsig/keyed_signal.hpp>
+#include <tsig/signal.hpp>
+#include <tsig/static_signal.hpp>
+
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+
+namespace {
+
+using IntSignal = tsig::Signal<void(int)>;
+
+template <typename SignalType>
+void ConnectCounters(SignalType& signal, std::size_t num_handlers, std::vector<int>& counters,
+                     std::vector<tsig::Sigcon>& sigcons)
+{
+  counters.assign(num_handlers, 0);
+  sigcons.clear();
+  sigcons.reserve(num_handlers);
+  for (std::size_t ii = 0; ii < num_handlers; ++ii) {
+    int& counter = counters[ii];
+    sigcons.push_back(signal.Connect([&counter](int x) { counter += x; }));
+  }
+}
+
+}  // namespace
+
+static void BM_Emit(benchmark::State& state)
+{
+  const std::size_t num_handlers = static_cast<std::size_t>(state.range(0));
+  IntSignal signal;
+  std::vector<int> counters;
+  std::vector<tsig::Sigcon> sigcons;
+  ConnectCounters(signal, num_handlers, counters, sigcons);
+  for (auto _ : state) {
+    signal.Emit(1);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(num_handlers));
+}
+BENCHMARK(BM_Emit)->Arg(0)->Arg(1)->Arg(10)->Arg(100)->Arg(1000)->Arg(10000);
+
+static void BM_EmitInstrumented(benchmark::State& state)
+{
+  const std::size_t num_handlers = static_cast<std::size_t>(state.range(0));
+  tsig::Signal<void(int), tsig::Instrumented> signal;
+  std::vector<int> counters;
+  std::vector<tsig::Sigcon> sigcons;
+  ConnectCounters(signal, num_handlers, counters, sigcons);
+  for (auto _ : state) {
+    signal.Emit(1);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(num_handlers));
+}
+BENCHMARK(BM_EmitInstrumented)->Arg(0)->Arg(1)->Arg(10)->Arg(100);
+
+namespace {
+
+struct IgnoreError {
+  void operator()(std::exception_ptr) const
+  {
+    // Do nothing
+  }
+};
+
+}  // namespace
+
+template <typename ErrorPolicy>
+static void BM_EmitErrors(benchmark::State& state)
+{
+  const std::size_t num_handlers = static_cast<std::size_t>(state.range(0));
+  tsig::Signal<void(int), ErrorPolicy> signal;
+  std::vector<int> counters;
+  std::vector<tsig::Sigcon> sigcons;
+  ConnectCounters(signal, num_handlers, counters, sigcons);
+  for (auto _ : state) {
+    signal.Emit(1);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(num_handlers));
+}
+BENCHMARK_TEMPLATE(BM_EmitErrors, tsig::PropagateErrors)->Arg(1)->Arg(10)->Arg(100);
+BENCHMARK_TEMPLATE(BM_EmitErrors, tsig::CatchErrors<IgnoreError>)->Arg(1)->Arg(10)->Arg(100);
+BENCHMARK_TEMPLATE(BM_EmitErrors, tsig::TerminateOnError)->Arg(1)->Arg(10)->Arg(100);
+
+namespace {
+
+struct CounterHandler {
+  void operator()(int x)
+  {
+    *counter_ptr += x;
+  }
+
+  int* counter_ptr;
+};
+
+}  // namespace
+
+static void BM_EmitStatic(benchmark::State& state)
+{
+  std::vector<int> counters(10u, 0);
+  auto signal = tsig::MakeStaticSignal<void(int)>(
+      CounterHandler{&counters[0]}, CounterHandler{&counters[1]}, CounterHandler{&counters[2]},
+      CounterHandler{&counters[3]}, CounterHandler{&counters[4]}, CounterHandler{&counters[5]},
+      CounterHandler{&counters[6]}, CounterHandler{&counters[7]}, CounterHandler{&counters[8]},
+      CounterHandler{&counters[9]});
+  for (auto _ : state) {
+    signal.Emit(1);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(counters.size()));
+}
+BENCHMARK(BM_EmitStatic);
+
+static void BM_EmitFiltered(benchmark::State& state)
+{
+  const std::size_t num_handlers = static_cast<std::size_t>(state.range(0));
+  tsig::Signal<void(std::size_t, int)> signal;
+  std::vector<int> counters(num_handlers, 0);
+  std::vector<tsig::Sigcon> sigcons;
+  // Every handler is called, only to check if the emission is meant for it
+  for (std::size_t ii = 0; ii < num_handlers; ++ii) {
+    int& counter = counters[ii];
+    sigcons.push_back(signal.Connect([&counter, ii](std::size_t key, int x) {
+      if (key == ii) {
+        counter += x;
+      }
+    }));
+  }
+  std::size_t key = 0u;
+  for (auto _ : state) {
+    signal.Emit(std::size_t(key), 1);
+    key = (key + 1u) % num_handlers;
+    benchmark::ClobberMemory();
+  }
+}
+BENCHMARK(BM_EmitFiltered)->Arg(10)->Arg(1000);
+
+static void BM_EmitKeyed(benchmark::State& state)
+{
+  const std::size_t num_handlers = static_cast<std::size_t>(state.range(0));
+  tsig::KeyedSignal<std::size_t, void(int)> signal;
+  std::vector<int> counters(num_handlers, 0);
+  std::vector<tsig::Sigcon> sigcons;
+  for (std::size_t ii = 0; ii < num_handlers; ++ii) {
+    int& counter = counters[ii];
+    sigcons.push_back(signal.Connect(ii, [&counter](int x) { counter += x; }));
+  }
+  std::size_t key = 0u;
+  for (auto _ : state) {
+    signal.Emit(key, 1);
+    key = (key + 1u) % num_handlers;
+    benchmark::ClobberMemory();
+  }
+}
+BENCHMARK(BM_EmitKeyed)->Arg(10)->Arg(1000);
+
+static void BM_EmitCoalesced(benchmark::State& state)
+{
+  // A fast producer emits many times for each flush by a slow consumer
+  const std::size_t num_emits = static_cast<std::size_t>(state.range(0));
+  tsig::CoalescingSignal<std::string> signal;
+  std::size_t total = 0u;
+  const tsig::Sigcon sigcon = signal.Connect([&total](const std::string& str) {
+    total += str.size();
+  });
+  const std::string value(64u, 'X');
+  for (auto _ : state) {
+    for (std::size_t ii = 0; ii < num_emits; ++ii) {
+      signal.Emit(value);
+    }
+    signal.Flush();
+  }
+  benchmark::DoNotOptimize(total);
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(num_emits));
+}
+BENCHMARK(BM_EmitCoalesced)->Arg(1)->Arg(20);
+
+static void BM_ConnectDisconnect(benchmark::State& state)
+{
+  const std::size_t num_handlers = static_cast<std::size_t>(state.range(0));
+  IntSignal signal;
+  std::vector<int> counters;
+  std::vector<tsig::Sigcon> sigcons;
+  ConnectCounters(signal, num_handlers, counters, sigcons);
+  int counter = 0;
+  for (auto _ : state) {
+    tsig::Sigcon sigcon = signal.Connect([&counter](int x) { counter += x; });
+    sigcon.Reset();
+  }
+  benchmark::DoNotOptimize(counter);
+}
+BENCHMARK(BM_ConnectDisconnect)->Arg(1)->Arg(10)->Arg(100)->Arg(10000);
+
+static void BM_ConnectChurn(benchmark::State& state)
+{
+  const std::size_t num_handlers = static_cast<std::size_t>(state.range(0));
+  IntSignal signal;
+  std::vector<int> counters;
+  std::vector<tsig::Sigcon> sigcons;
+  ConnectCounters(signal, num_handlers, counters, sigcons);
+  // Replace handlers all over the signal, rather than always the most recent one
+  std::size_t index = 0u;
+  for (auto _ : state) {
+    index = (index * 1103515245u + 12345u) % num_handlers;
+    int& counter = counters[index];
+    sigcons[index] = signal.Connect([&counter](int x) { counter += x; });
+  }
+  signal.Emit(1);
+  benchmark::ClobberMemory();
+}
+BENCHMARK(BM_ConnectChurn)->Arg(10)->Arg(1000);
+
+static void BM_SigconMove(benchmark::State& state)
+{
+  IntSignal signal;
+  int counter = 0;
+  tsig::Sigcon sigcon = signal.Connect([&counter](int x) { counter += x; });
+  for (auto _ : state) {
+    tsig::Sigcon moved_sigcon(std::move(sigcon));
+    sigcon = std::move(moved_sigcon);
+    benchmark::DoNotOptimize(sigcon);
+  }
+  signal.Emit(1);
+  benchmark::DoNotOptimize(counter);
+}
+BENCHMARK(BM_SigconMove);
+
+static void BM_BlockToggle(benchmark::State& state)
+{
+  const std::size_t num_handlers = static_cast<std::size_t>(state.range(0));
+  IntSignal signal;
+  std::vector<int> counters;
+  std::vector<tsig::Sigcon> sigcons;
+  ConnectCounters(signal, num_handlers, counters, sigcons);
+  // Mute and unmute every handler around an emission, like a frame would
+  for (auto _ : state) {
+    for (tsig::Sigcon& sigcon : sigcons) {
+      sigcon.Block();
+    }
+    signal.Emit(1);
+    for (tsig::Sigcon& sigcon : sigcons) {
+      sigcon.Unblock();
+    }
+  }
+  benchmark::DoNotOptimize(counters.data());
+}
+BENCHMARK(BM_BlockToggle)->Arg(10)->Arg(1000);
+
+template <bool USE_GROUP>
+static void BM_DisconnectAll(benchmark::State& state)
+{
+  // Tear down a component with 500 connections, spread over some signals
+  constexpr std::size_t NUM_SIGCONS = 500u;
+  const std::size_t num_signals = static_cast<std::size_t>(state.range(0));
+  std::vector<IntSignal> signals(num_signals);
+  int counter = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::vector<tsig::Sigcon> sigcons;
+    tsig::SigconGroup sigcon_group;
+    for (std::size_t ii = 0; ii < NUM_SIGCONS; ++ii) {
+      tsig::Sigcon sigcon = signals[ii % num_signals].Connect([&counter](int x) { counter += x; });
+      if (USE_GROUP) {
+        sigcon_group.Add(std::move(sigcon));
+      }
+      else {
+        sigcons.push_back(std::move(sigcon));
+      }
+    }
+    state.ResumeTiming();
+    sigcons.clear();
+    sigcon_group.Reset();
+  }
+  benchmark::DoNotOptimize(counter);
+}
+BENCHMARK_TEMPLATE(BM_DisconnectAll, false)->Arg(1)->Arg(50);
+BENCHMARK_TEMPLATE(BM_DisconnectAll, true)->Arg(1)->Arg(50);
+
+namespace {
+
+// Reconnects itself every call, disconnecting from the signal in the middle of an emission
+struct ReconnectHandler {
+  void operator()(int x)
+  {
+    *counter_ptr += x;
+    *sigcon_ptr = signal_ptr->Connect(*this);
+  }
+
+  IntSignal* signal_ptr;
+  tsig::Sigcon* sigcon_ptr;
+  int* counter_ptr;
+};
+
+}  // namespace
+
+static void BM_EmitReentrantDisconnect(benchmark::State& state)
+{
+  const std::size_t num_handlers = static_cast<std::size_t>(state.range(0));
+  IntSignal signal;
+  std::vector<int> counters;
+  std::vector<tsig::Sigcon> sigcons;
+  ConnectCounters(signal, num_handlers, counters, sigcons);
+  int counter = 0;
+  tsig::Sigcon sigcon;
+  sigcon = signal.Connect(ReconnectHandler{&signal, &sigcon, &counter});
+  for (auto _ : state) {
+    signal.Emit(1);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(num_handlers + 1u));
+}
+BENCHMARK(BM_EmitReentrantDisconnect)->Arg(1)->Arg(10)->Arg(1000);
+
+constexpr std::size_t NUM_BATCH_EMITS = 1000;
+
+template <typename SignalType>
+static void BM_EmitRepeated(benchmark::State& state)
+{
+  const std::size_t num_handlers = static_cast<std::size_t>(state.range(0));
+  SignalType signal;
+  std::vector<int> counters;
+  std::vector<tsig::Sigcon> sigcons;
+  ConnectCounters(signal, num_handlers, counters, sigcons);
+  for (auto _ : state) {
+    for (std::size_t ii = 0; ii < NUM_BATCH_EMITS; ++ii) {
+      signal.Emit(static_cast<int>(ii));
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(num_handlers)
+                          * static_cast<int64_t>(NUM_BATCH_EMITS));
+}
+BENCHMARK_TEMPLATE(BM_EmitRepeated, IntSignal)->Arg(1)->Arg(10)->Arg(100);
+BENCHMARK_TEMPLATE(BM_EmitRepeated, tsig::Signal<void(int), tsig::MultiThreaded>)->Arg(10);
+
+template <typename SignalType>
+static void BM_EmitBatch(benchmark::State& state)
+{
+  const std::size_t num_handlers = static_cast<std::size_t>(state.range(0));
+  SignalType signal;
+  std::vector<int> counters;
+  std::vector<tsig::Sigcon> sigcons;
+  ConnectCounters(signal, num_handlers, counters, sigcons);
+  std::vector<std::tuple<int>> batch_args;
+  for (std::size_t ii = 0; ii < NUM_BATCH_EMITS; ++ii) {
+    batch_args.emplace_back(static_cast<int>(ii));
+  }
+  for (auto _ : state) {
+    signal.EmitBatch(batch_args);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(num_handlers)
+                          * static_cast<int64_t>(NUM_BATCH_EMITS));
+}
+BENCHMARK_TEMPLATE(BM_EmitBatch, IntSignal)->Arg(1)->Arg(10)->Arg(100);
+BENCHMARK_TEMPLATE(BM_EmitBatch, tsig::Signal<void(int), tsig::MultiThreaded>)->Arg(10);
+
+static void BM_EmitCollect(benchmark::State& state)
+{
+  const std::size_t num_handlers = static_cast<std::size_t>(state.range(0));
+  tsig::Signal<int(int)> signal;
+  std::vector<tsig::Sigcon> sigcons;
+  for (std::size_t ii = 0; ii < num_handlers; ++ii) {
+    sigcons.push_back(signal.Connect([](int x) { return x; }));
+  }
+  // The caller owns the buffer, so it's only allocated once
+  std::vector<int> results;
+  for (auto _ : state) {
+    results.clear();
+    signal.EmitInto(tsig::CollectInto(results), 1);
+    benchmark::DoNotOptimize(results.data());
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(num_handlers));
+}
+BENCHMARK(BM_EmitCollect)->Arg(10)->Arg(1000);
+
+static void BM_EmitAnyOf(benchmark::State& state)
+{
+  const std::size_t num_handlers = static_cast<std::size_t>(state.range(0));
+  tsig::Signal<bool(int)> signal;
+  std::vector<tsig::Sigcon> sigcons;
+  // The answer is known from the first handler, so the rest are never called
+  for (std::size_t ii = 0; ii < num_handlers; ++ii) {
+    sigcons.push_back(signal.Connect([](int x) { return x > 0; }));
+  }
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(signal.EmitWith<tsig::AnyOf>(1));
+  }
+}
+BENCHMARK(BM_EmitAnyOf)->Arg(10)->Arg(1000);
+
+namespace {
+
+class Accumulator {
+ public:
+  void Add(int x)
+  {
+    total_ += x;
+  }
+
+ private:
+  int total_ = 0;
+};
+
+}  // namespace
+
+template <typename SignalType>
+static void BM_ConnectMembers(benchmark::State& state)
+{
+  const std::size_t num_handlers = static_cast<std::size_t>(state.range(0));
+  using namespace std::placeholders;
+  SignalType signal;
+  std::vector<Accumulator> accumulators(num_handlers);
+  std::vector<tsig::Sigcon> sigcons;
+  sigcons.reserve(num_handlers);
+  for (auto _ : state) {
+    for (Accumulator& accumulator : accumulators) {
+      sigcons.push_back(signal.Connect(std::bind(&Accumulator::Add, &accumulator, _1)));
+    }
+    sigcons.clear();
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(num_handlers));
+}
+BENCHMARK_TEMPLATE(BM_ConnectMembers, IntSignal)->Arg(1000);
+BENCHMARK_TEMPLATE(BM_ConnectMembers, tsig::Signal<void(int), tsig::DelegateHandlers<>>)
+    ->Arg(1000);
+
+template <typename SignalType>
+static void BM_EmitMembers(benchmark::State& state)
+{
+  const std::size_t num_handlers = static_cast<std::size_t>(state.range(0));
+  using namespace std::placeholders;
+  SignalType signal;
+  std::vector<Accumulator> accumulators(num_handlers);
+  std::vector<tsig::Sigcon> sigcons;
+  for (Accumulator& accumulator : accumulators) {
+    sigcons.push_back(signal.Connect(std::bind(&Accumulator::Add, &accumulator, _1)));
+  }
+  for (auto _ : state) {
+    signal.Emit(1);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(num_handlers));
+}
+BENCHMARK_TEMPLATE(BM_EmitMembers, IntSignal)->Arg(100);
+BENCHMARK_TEMPLATE(BM_EmitMembers, tsig::Signal<void(int), tsig::DelegateHandlers<>>)->Arg(100);
+
+static void BM_EmitTracked(benchmark::State& state)
+{
+  const std::size_t num_handlers = static_cast<std::size_t>(state.range(0));
+  IntSignal signal;
+  std::vector<std::shared_ptr<Accumulator>> accumulator_ptrs;
+  for (std::size_t ii = 0; ii < num_handlers; ++ii) {
+    accumulator_ptrs.push_back(std::make_shared<Accumulator>());
+    Accumulator* const accumulator_raw_ptr = accumulator_ptrs.back().get();
+    signal.Connect(accumulator_ptrs.back(), [accumulator_raw_ptr](int x) {
+      accumulator_raw_ptr->Add(x);
+    });
+  }
+  for (auto _ : state) {
+    signal.Emit(1);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(num_handlers));
+}
+BENCHMARK(BM_EmitTracked)->Arg(100);
+
+static void BM_ExpireTracked(benchmark::State& state)
+{
+  // Half of the tracked objects die, and the next emission removes their handlers
+  const std::size_t num_handlers = static_cast<std::size_t>(state.range(0));
+  IntSignal signal;
+  std::vector<std::shared_ptr<Accumulator>> accumulator_ptrs;
+  for (auto _ : state) {
+    state.PauseTiming();
+    signal = IntSignal();
+    accumulator_ptrs.clear();
+    for (std::size_t ii = 0; ii < num_handlers; ++ii) {
+      accumulator_ptrs.push_back(std::make_shared<Accumulator>());
+      Accumulator* const accumulator_raw_ptr = accumulator_ptrs.back().get();
+      signal.Connect(accumulator_ptrs.back(), [accumulator_raw_ptr](int x) {
+        accumulator_raw_ptr->Add(x);
+      });
+    }
+    for (std::size_t ii = 0; ii < num_handlers; ii += 2u) {
+      accumulator_ptrs[ii] = nullptr;
+    }
+    state.ResumeTiming();
+    signal.Emit(1);
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(num_handlers));
+}
+BENCHMARK(BM_ExpireTracked)->Arg(1000);
+
+namespace {
+
+constexpr std::size_t NUM_SHARED_HANDLERS = 10;
+
+template <typename SignalType>
+SignalType& SharedSignal()
+{
+  static SignalType signal;
+  static std::atomic<int> total(0);
+  static std::vector<tsig::Sigcon> sigcons = []() {
+    std::vector<tsig::Sigcon> sigcons;
+    for (std::size_t ii = 0; ii < NUM_SHARED_HANDLERS; ++ii) {
+      sigcons.push_back(signal.Connect([](int x) { total.fetch_add(x); }));
+    }
+    return sigcons;
+  }();
+  return signal;
+}
+
+}  // namespace
+
+static void BM_EmitLocked(benchmark::State& state)
+{
+  static std::mutex mutex;
+  IntSignal& signal = SharedSignal<IntSignal>();
+  for (auto _ : state) {
+    std::lock_guard<std::mutex> lock(mutex);
+    signal.Emit(1);
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(NUM_SHARED_HANDLERS));
+}
+BENCHMARK(BM_EmitLocked)->ThreadRange(1, 8)->UseRealTime();
+
+static void BM_EmitMultiThreaded(benchmark::State& state)
+{
+  auto& signal = SharedSignal<tsig::Signal<void(int), tsig::MultiThreaded>>();
+  for (auto _ : state) {
+    signal.Emit(1);
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(NUM_SHARED_HANDLERS));
+}
+BENCHMARK(BM_EmitMultiThreaded)->ThreadRange(1, 8)->UseRealTime();
+
+namespace {
+
+// Runs an event loop on its own thread, for as long as the benchmarks run
+struct EventLoopThread {
+  EventLoopThread() : thread([this]() { dispatcher.Run(); })
+  {
+    // Do nothing
+  }
+
+  ~EventLoopThread()
+  {
+    dispatcher.Stop();
+    thread.join();
+  }
+
+  tsig::EventLoopDispatcher dispatcher;
+  std::thread thread;
+};
+
+}  // namespace
+
+static void BM_EmitDispatched(benchmark::State& state)
+{
+  static EventLoopThread event_loop_thread;
+  static tsig::SignalFactory<tsig::EventLoopDispatcher> factory(event_loop_thread.dispatcher);
+  static auto signal = factory.MakeSignal<void(int), tsig::MultiThreaded>();
+  static std::atomic<int> total(0);
+  static tsig::Sigcon sigcon = signal.Connect([](int x) { total.fetch_add(x); });
+  for (auto _ : state) {
+    // Blocks while the queue is full, so this is limited by the event loop
+    signal.Emit(1);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EmitDispatched)->ThreadRange(1, 8)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -4,6 +4,7 @@
 
 #include <tsig/signal.hpp>
 #include <tsig/tn/node.hpp>
+#include <tsig/tn/synchronizer.hpp>
 
 struct Point {
   int x;
@@ -11,6 +12,7 @@ struct Point {
 };
 
 struct PointCloud {
+  double stamp;
   std::vector<Point> points;
 };
 
@@ -26,15 +28,21 @@ struct DetectorDiag {
   int num_detections;
 };
 
+// Point clouds and detections are big, so they're shared rather than copied
 using ObstacleDetectorNode =  //
-    tsig::tn::Node<tsig::tn::WithInputs<PointCloud, PointCloud, VehiclePose>,
-                   tsig::tn::WithOutputs<ObstacleDetections, DetectorDiag>>;
+    tsig::tn::Node<tsig::tn::WithInputs<tsig::tn::Shared<PointCloud>,
+                                        tsig::tn::Shared<PointCloud>, VehiclePose>,
+                   tsig::tn::WithOutputs<tsig::tn::Shared<ObstacleDetections>, DetectorDiag>>;
 
 using ObstacleAvoidanceNode =  //
-    tsig::tn::Node<tsig::tn::WithInputs<ObstacleDetections>, tsig::tn::WithoutOutputs>;
+    tsig::tn::Node<tsig::tn::WithInputs<tsig::tn::Shared<ObstacleDetections>>,
+                   tsig::tn::WithoutOutputs>;
 
 class ObstacleDetectorTask {
  public:
+  // Point clouds are stamped in seconds
+  using PointCloudSyncPolicy = tsig::tn::ApproximateTime<double>;
+
   // These constants are optional but help readability
   static constexpr size_t INPUT_PONT_CLOUD1 = 0;
   static constexpr size_t INPUT_PONT_CLOUD2 = 1;
@@ -42,17 +50,27 @@ class ObstacleDetectorTask {
   static constexpr size_t OUTPUT_OBSTACLE_DETECTIONS = 0;
   static constexpr size_t OUTPUT_DETECTOR_DIAG = 1;
 
-  ObstacleDetectorTask() = default;
+  // The point clouds are paired up by the synchronizer, if they are close enough in time
+  ObstacleDetectorTask()
+      : pc_sync_(std::bind(&ObstacleDetectorTask::HandlePointClouds, this,
+                           std::placeholders::_1, std::placeholders::_2),
+                 PointCloudSyncPolicy(0.05))
+  {
+    // Do nothing
+  }
 
-  tsig::tn::DataHandlerTuple<PointCloud, PointCloud, VehiclePose> GetHandlers()
+  tsig::tn::DataHandlerTuple<tsig::tn::Shared<PointCloud>, tsig::tn::Shared<PointCloud>,
+                             VehiclePose>
+  GetHandlers()
   {
     using namespace std::placeholders;
-    return {std::bind(&ObstacleDetectorTask::HandlePointCloud1, this, _1),
-            std::bind(&ObstacleDetectorTask::HandlePointCloud2, this, _1),
-            std::bind(&ObstacleDetectorTask::HandleVehiclePose, this, _1)};
+    return std::tuple_cat(pc_sync_.GetHandlers(),
+                          tsig::tn::DataHandlerTuple<VehiclePose>(
+                              std::bind(&ObstacleDetectorTask::HandleVehiclePose, this, _1)));
   }
 
-  void SetSinks(tsig::tn::DataSinkTuple<ObstacleDetections, DetectorDiag> sinks)
+  void SetSinks(
+      tsig::tn::DataSinkTuple<tsig::tn::Shared<ObstacleDetections>, DetectorDiag> sinks)
   {
     // Ideally... the sinks would be const so it's enforced that they never
     // change after construction. Make a more advanced builder?
@@ -60,28 +78,12 @@ class ObstacleDetectorTask {
     detector_diag_sink_ = std::get<1>(sinks);
   }
 
-  void HandlePointCloud1(const PointCloud& pc)
-  {
-    pc1_ = pc;
-    got_pc1_ = true;
-    if (got_pc2_) {
-      merged_pc_ = MergePointClouds_(pc1_, pc2_);
-      got_pc1_ = got_pc2_ = false;
-      // For now, let's just do Tick right here
-      Tick();
-    }
-  }
-
-  void HandlePointCloud2(const PointCloud& pc)
+  void HandlePointClouds(const std::shared_ptr<const PointCloud>& pc1_ptr,
+                         const std::shared_ptr<const PointCloud>& pc2_ptr)
   {
-    pc2_ = pc;
-    got_pc2_ = true;
-    if (got_pc1_) {
-      merged_pc_ = MergePointClouds_(pc1_, pc2_);
-      got_pc1_ = got_pc2_ = false;
-      // For now, let's just do Tick right here
-      Tick();
-    }
+    MergePointClouds_(*pc1_ptr, *pc2_ptr, merged_pc_);
+    // For now, let's just do Tick right here
+    Tick();
   }
 
   void HandleVehiclePose(const VehiclePose& vp)
@@ -92,28 +94,31 @@ class ObstacleDetectorTask {
   // TODO How will this work? Process one iteration.
   void Tick()
   {
-    ObstacleDetections od = GetDetections_(merged_pc_, vp_);
-    output_detection_sink_(od);
+    // Fill in recycled detections, which already have room for the points
+    const std::shared_ptr<ObstacleDetections> od_ptr = output_detection_sink_.Acquire();
+    GetDetections_(merged_pc_, vp_, *od_ptr);
+    output_detection_sink_(od_ptr);
     // And publish the diagnostic info as well
-    detector_diag_sink_(DetectorDiag{static_cast<int>(od.points.size())});
+    detector_diag_sink_(DetectorDiag{static_cast<int>(od_ptr->points.size())});
   }
 
  private:
-  static PointCloud MergePointClouds_(const PointCloud& pc1, const PointCloud& pc2)
+  // Merges into the existing point cloud, reusing its memory
+  static void MergePointClouds_(const PointCloud& pc1, const PointCloud& pc2,
+                                PointCloud& merged_pc)
   {
-    PointCloud merged_pc = {};
+    merged_pc.points.clear();
     for (const auto& point : pc1.points) {
       merged_pc.points.push_back(point);
     }
     for (const auto& point : pc2.points) {
       merged_pc.points.push_back(point);
     }
-    return merged_pc;
   }
 
-  static ObstacleDetections GetDetections_(const PointCloud& pc, const VehiclePose& vp)
+  static void GetDetections_(const PointCloud& pc, const VehiclePose& vp, ObstacleDetections& od)
   {
-    ObstacleDetections od = {};
+    od.points.clear();
     for (const auto& point : pc.points) {
       const double dist =
           std::sqrt(static_cast<double>((point.x - vp.point.x) * (point.x - vp.point.x)
@@ -122,16 +127,14 @@ class ObstacleDetectorTask {
         od.points.push_back(point);
       }
     }
-    return od;
   }
 
-  tsig::tn::DataHandler<ObstacleDetections> output_detection_sink_;
-  tsig::tn::DataHandler<DetectorDiag> detector_diag_sink_;
+  tsig::tn::DataSink<tsig::tn::Shared<ObstacleDetections>> output_detection_sink_;
+  tsig::tn::DataSink<DetectorDiag> detector_diag_sink_;
 
-  PointCloud pc1_;
-  bool got_pc1_ = false;
-  PointCloud pc2_;
-  bool got_pc2_ = false;
+  tsig::tn::Synchronizer<PointCloudSyncPolicy, tsig::tn::Shared<PointCloud>,
+                         tsig::tn::Shared<PointCloud>>
+      pc_sync_;
   PointCloud merged_pc_;
   VehiclePose vp_;
 };
@@ -143,7 +146,7 @@ class ObstacleAvoidanceTask {
 
   ObstacleAvoidanceTask() = default;
 
-  tsig::tn::DataHandlerTuple<ObstacleDetections> GetHandlers()
+  tsig::tn::DataHandlerTuple<tsig::tn::Shared<ObstacleDetections>> GetHandlers()
   {
     using namespace std::placeholders;
     return {std::bind(&ObstacleAvoidanceTask::HandleObstacleDetections, this, _1)};
@@ -154,9 +157,9 @@ class ObstacleAvoidanceTask {
     // Would be nice to be able to remove this completely
   }
 
-  void HandleObstacleDetections(const ObstacleDetections& od)
+  void HandleObstacleDetections(const std::shared_ptr<const ObstacleDetections>& od_ptr)
   {
-    for (const auto& point : od.points) {
+    for (const auto& point : od_ptr->points) {
       fmt::print("Got OD point: x = {}, y = {}\n", point.x, point.y);
     }
   }
@@ -177,8 +180,8 @@ int main(void)
   ObstacleAvoidanceNode oa_node =
       tsig::tn::NodeBuilder<ObstacleAvoidanceNode>::Build(std::move(oa_task));
 
-  tsig::Signal<void(const PointCloud&)> sig_pc1;
-  tsig::Signal<void(const PointCloud&)> sig_pc2;
+  tsig::Signal<void(const std::shared_ptr<const PointCloud>&)> sig_pc1;
+  tsig::Signal<void(const std::shared_ptr<const PointCloud>&)> sig_pc2;
   tsig::Signal<void(const VehiclePose&)> sig_vp;
 
   // Connect these up manually for testing
@@ -198,8 +201,10 @@ int main(void)
 
   // Do some manual sends
   sig_vp.Emit(VehiclePose{Point{0, 0}});
-  sig_pc1.Emit(PointCloud{{Point{1, 1}, Point{1, 2}, Point{2, 2}}});
-  sig_pc2.Emit(PointCloud{{Point{5, 5}, Point{10, 10}, Point{12, 10}}});
+  sig_pc1.Emit(std::make_shared<const PointCloud>(
+      PointCloud{0.00, {Point{1, 1}, Point{1, 2}, Point{2, 2}}}));
+  sig_pc2.Emit(std::make_shared<const PointCloud>(
+      PointCloud{0.01, {Point{5, 5}, Point{10, 10}, Point{12, 10}}}));
 
   return 0;
 }
@@ -0,0 +1,162 @@
+// Copyright (c) 2021 Tim Perkins
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <tsig/coalescing_signal.hpp>
+#include <tsig/dispatcher.hpp>
+
+constexpr std::size_t NUM_THREADS = 4;
+constexpr std::size_t NUM_THREAD_EMITS = 10000;
+
+using StringSignal = tsig::CoalescingSignal<std::string>;
+
+TEST(CoalescingSignal, Construct)
+{
+  StringSignal signal;
+  signal.Emit("BLUE");
+  StringSignal move_signal(std::move(signal));
+  EXPECT_TRUE(move_signal.IsPending());
+  EXPECT_TRUE(move_signal.Flush());
+}
+
+TEST(CoalescingSignal, EmitFlush)
+{
+  StringSignal signal;
+  std::vector<std::string> called;
+  const tsig::Sigcon sigcon =
+      signal.Connect([&](const std::string& str) { called.push_back(str); });
+  EXPECT_FALSE(signal.IsPending());
+  EXPECT_FALSE(signal.Flush());
+  signal.Emit("BLUE");
+  signal.Emit("RED");
+  EXPECT_TRUE(signal.IsPending());
+  EXPECT_TRUE(called.empty());
+  // Only the latest value is flushed
+  EXPECT_TRUE(signal.Flush());
+  EXPECT_FALSE(signal.IsPending());
+  EXPECT_EQ(called, std::vector<std::string>({"RED"}));
+  EXPECT_FALSE(signal.Flush());
+  const std::string green = "GREEN";
+  signal.Emit(green);
+  EXPECT_TRUE(signal.Flush());
+  EXPECT_EQ(called, std::vector<std::string>({"RED", "GREEN"}));
+}
+
+TEST(CoalescingSignal, EmitReset)
+{
+  StringSignal signal;
+  std::size_t num_calls = 0u;
+  tsig::Sigcon sigcon = signal.Connect([&](const std::string&) { ++num_calls; });
+  signal.Emit("BLUE");
+  sigcon.Reset();
+  // The value is still flushed, there's just nothing to call
+  EXPECT_TRUE(signal.Flush());
+  EXPECT_EQ(num_calls, 0u);
+}
+
+TEST(CoalescingSignal, EmitDuringFlush)
+{
+  StringSignal signal;
+  std::vector<std::string> called;
+  const tsig::Sigcon sigcon = signal.Connect([&](const std::string& str) {
+    called.push_back(str);
+    // Flushing from a handler does nothing, but emitting makes a new pending value
+    EXPECT_FALSE(signal.Flush());
+    signal.Emit(str + "!");
+  });
+  signal.Emit("BLUE");
+  EXPECT_TRUE(signal.Flush());
+  EXPECT_TRUE(signal.IsPending());
+  EXPECT_TRUE(signal.Flush());
+  EXPECT_EQ(called, std::vector<std::string>({"BLUE", "BLUE!"}));
+}
+
+TEST(CoalescingSignal, ConnectPriority)
+{
+  tsig::CoalescingSignal<int> signal;
+  std::vector<int> called;
+  const tsig::Sigcon sigcon1 = signal.Connect([&](int x) { called.push_back(x); });
+  const tsig::Sigcon sigcon2 = signal.Connect([&](int x) { called.push_back(-x); }, 1);
+  signal.Emit(1);
+  signal.Flush();
+  EXPECT_EQ(called, std::vector<int>({-1, 1}));
+}
+
+TEST(CoalescingSignal, EmitDispatched)
+{
+  tsig::EventLoopDispatcher dispatcher;
+  tsig::CoalescingSignal<int, tsig::DispatchWith<tsig::EventLoopDispatcher>> signal(dispatcher);
+  std::vector<int> called;
+  const tsig::Sigcon sigcon = signal.Connect([&](int x) { called.push_back(x); });
+  for (int ii = 0; ii < 10; ++ii) {
+    signal.Emit(ii);
+  }
+  EXPECT_TRUE(called.empty());
+  // Only the first emission queued a flush
+  EXPECT_EQ(dispatcher.Poll(), 1u);
+  EXPECT_EQ(called, std::vector<int>({9}));
+  signal.Emit(10);
+  EXPECT_EQ(dispatcher.Poll(), 1u);
+  EXPECT_EQ(called, std::vector<int>({9, 10}));
+}
+
+TEST(CoalescingSignal, EmitDispatchedDropped)
+{
+  tsig::EventLoopDispatcher dispatcher;
+  std::size_t num_calls = 0u;
+  {
+    tsig::CoalescingSignal<int, tsig::DispatchWith<tsig::EventLoopDispatcher>> signal(
+        dispatcher);
+    const tsig::Sigcon sigcon = signal.Connect([&](int) { ++num_calls; });
+    signal.Emit(1);
+  }
+  // The queued flush went with the signal
+  EXPECT_EQ(dispatcher.Poll(), 1u);
+  EXPECT_EQ(num_calls, 0u);
+}
+
+TEST(CoalescingSignal, EmitConcurrent)
+{
+  tsig::CoalescingSignal<std::size_t, tsig::MultiThreaded> signal;
+  std::atomic<std::size_t> num_calls(0u);
+  std::atomic<std::size_t> last_value(0u);
+  const tsig::Sigcon sigcon = signal.Connect([&](std::size_t value) {
+    num_calls.fetch_add(1u);
+    last_value.store(value);
+  });
+  std::vector<std::thread> threads;
+  for (std::size_t ii = 0; ii < NUM_THREADS; ++ii) {
+    threads.emplace_back([&]() {
+      for (std::size_t jj = 1; jj <= NUM_THREAD_EMITS; ++jj) {
+        signal.Emit(jj);
+      }
+    });
+  }
+  std::atomic<bool> done(false);
+  std::thread flush_thread([&]() {
+    while (!done.load()) {
+      signal.Flush();
+    }
+  });
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  done.store(true);
+  flush_thread.join();
+  signal.Flush();
+  EXPECT_FALSE(signal.IsPending());
+  EXPECT_LE(num_calls.load(), NUM_THREADS * NUM_THREAD_EMITS);
+  EXPECT_GT(num_calls.load(), 0u);
+  EXPECT_LE(last_value.load(), NUM_THREAD_EMITS);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,237 @@
+// Copyright (c) 2021 Tim Perkins
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <tsig/coro.hpp>
+#include <tsig/dispatcher.hpp>
+
+constexpr std::size_t NUM_COROUTINES = 1000;
+constexpr std::size_t NUM_THREAD_EMITS = 10000;
+
+namespace {
+
+// A minimal coroutine, which starts eagerly and is destroyed by its owner
+class Task {
+ public:
+  struct promise_type {
+    Task get_return_object()
+    {
+      return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_never initial_suspend() noexcept
+    {
+      return {};
+    }
+    std::suspend_always final_suspend() noexcept
+    {
+      return {};
+    }
+    void return_void() {}
+    void unhandled_exception()
+    {
+      std::terminate();
+    }
+  };
+
+  explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+  Task(const Task&) = delete;
+  Task(Task&& task) : handle_(task.handle_)
+  {
+    task.handle_ = nullptr;
+  }
+  ~Task()
+  {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  Task& operator=(const Task&) = delete;
+  Task& operator=(Task&& task)
+  {
+    std::swap(handle_, task.handle_);
+    return *this;
+  }
+
+  bool IsDone() const
+  {
+    return handle_.done();
+  }
+
+ private:
+  std::coroutine_handle<promise_type> handle_;
+};
+
+using VoidSignal = tsig::Signal<void(const std::string&, int)>;
+
+Task WaitOnce(VoidSignal& signal, std::vector<std::string>& called)
+{
+  const auto [str, x] = co_await signal.Next();
+  called.push_back(str + std::to_string(x));
+}
+
+Task WaitForever(tsig::Signal<void(int)>& signal, std::vector<int>& called)
+{
+  while (true) {
+    const auto [x] = co_await signal.Next();
+    called.push_back(x);
+  }
+}
+
+}  // namespace
+
+TEST(Coro, Next)
+{
+  VoidSignal signal;
+  std::vector<std::string> called;
+  Task task = WaitOnce(signal, called);
+  EXPECT_FALSE(task.IsDone());
+  signal.Emit("BLUE", 1);
+  EXPECT_TRUE(task.IsDone());
+  signal.Emit("RED", 2);
+  EXPECT_EQ(called, std::vector<std::string>({"BLUE1"}));
+}
+
+TEST(Coro, NextWithHandlers)
+{
+  VoidSignal signal;
+  std::vector<std::string> called;
+  const tsig::Sigcon sigcon =
+      signal.Connect([&](const std::string& str, int) { called.push_back(str); });
+  Task task = WaitOnce(signal, called);
+  signal.Emit("BLUE", 1);
+  // Waiters are woken before the handlers are called
+  EXPECT_EQ(called, std::vector<std::string>({"BLUE1", "BLUE"}));
+}
+
+TEST(Coro, NextManyWaiters)
+{
+  VoidSignal signal;
+  std::vector<std::string> called;
+  std::vector<Task> tasks;
+  for (std::size_t ii = 0; ii < NUM_COROUTINES; ++ii) {
+    tasks.push_back(WaitOnce(signal, called));
+  }
+  signal.Emit("BLUE", 1);
+  // Woken in waiting order
+  EXPECT_EQ(called, std::vector<std::string>(NUM_COROUTINES, "BLUE1"));
+  for (const Task& task : tasks) {
+    EXPECT_TRUE(task.IsDone());
+  }
+}
+
+TEST(Coro, NextAgain)
+{
+  tsig::Signal<void(int)> signal;
+  std::vector<int> called;
+  Task task = WaitForever(signal, called);
+  signal.Emit(1);
+  signal.Emit(2);
+  // Each element of a batch is its own emission
+  const std::vector<std::tuple<int>> batch_args = {{3}, {4}};
+  signal.EmitBatch(batch_args);
+  EXPECT_EQ(called, std::vector<int>({1, 2, 3, 4}));
+}
+
+TEST(Coro, NextDestroyed)
+{
+  VoidSignal signal;
+  std::vector<std::string> called;
+  {
+    Task task = WaitOnce(signal, called);
+    Task other_task = WaitOnce(signal, called);
+  }
+  Task task = WaitOnce(signal, called);
+  signal.Emit("BLUE", 1);
+  EXPECT_EQ(called, std::vector<std::string>({"BLUE1"}));
+}
+
+TEST(Coro, NextDestroyedWhileWaking)
+{
+  tsig::Signal<void(int)> signal;
+  std::vector<int> called;
+  std::vector<Task> tasks;
+  // The first waiter to wake destroys the others, which are still waiting to be woken
+  tasks.push_back([](tsig::Signal<void(int)>& signal, std::vector<Task>& tasks) -> Task {
+    co_await signal.Next();
+    tasks.erase(tasks.begin() + 1, tasks.end());
+  }(signal, tasks));
+  for (std::size_t ii = 0; ii < 10; ++ii) {
+    tasks.push_back(WaitForever(signal, called));
+  }
+  signal.Emit(1);
+  EXPECT_TRUE(called.empty());
+  EXPECT_EQ(tasks.size(), 1u);
+}
+
+TEST(Coro, NextSignalDropped)
+{
+  std::vector<std::string> called;
+  std::optional<Task> task;
+  {
+    VoidSignal signal;
+    task.emplace(WaitOnce(signal, called));
+  }
+  // Never resumed, but still safe to destroy
+  EXPECT_FALSE(task->IsDone());
+  task.reset();
+  EXPECT_TRUE(called.empty());
+}
+
+TEST(Coro, NextDispatched)
+{
+  tsig::EventLoopDispatcher dispatcher;
+  tsig::Signal<void(int), tsig::DispatchWith<tsig::EventLoopDispatcher>> signal(dispatcher);
+  std::vector<int> called;
+  Task task = [](auto& signal, std::vector<int>& called) -> Task {
+    const auto [x] = co_await signal.Next();
+    called.push_back(x);
+  }(signal, called);
+  signal.Emit(1);
+  EXPECT_TRUE(called.empty());
+  dispatcher.Poll();
+  EXPECT_EQ(called, std::vector<int>({1}));
+}
+
+TEST(Coro, NextMultiThreaded)
+{
+  tsig::Signal<void(int), tsig::MultiThreaded> signal;
+  std::atomic<bool> done(false);
+  std::thread thread([&]() {
+    for (std::size_t ii = 0; ii < NUM_THREAD_EMITS && !done.load(); ++ii) {
+      signal.Emit(1);
+    }
+  });
+  std::atomic<int> total(0);
+  std::vector<Task> tasks;
+  for (std::size_t ii = 0; ii < NUM_COROUTINES; ++ii) {
+    tasks.push_back([](auto& signal, std::atomic<int>& total) -> Task {
+      const auto [x] = co_await signal.Next();
+      total.fetch_add(x);
+    }(signal, total));
+  }
+  done.store(true);
+  thread.join();
+  // Wake whatever is left
+  signal.Emit(1);
+  for (const Task& task : tasks) {
+    EXPECT_TRUE(task.IsDone());
+  }
+  EXPECT_EQ(total.load(), static_cast<int>(NUM_COROUTINES));
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
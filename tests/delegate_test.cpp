@@ -0,0 +1,284 @@
+// Copyright (c) 2021 Tim Perkins
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <type_traits>
+
+#include <tsig/delegate.hpp>
+#include <tsig/signal.hpp>
+
+namespace {
+
+std::size_t num_allocations = 0u;
+
+}  // namespace
+
+void* operator new(std::size_t size)
+{
+  ++num_allocations;
+  void* const ptr = std::malloc(size != 0u ? size : 1u);
+  if (!ptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+using IntDelegate = tsig::Delegate<void(int)>;
+
+class Accumulator {
+ public:
+  void Add(int x)
+  {
+    total_ += x;
+  }
+
+  void AddTo(int& x) const
+  {
+    x += total_;
+  }
+
+  int Plus(int x) const
+  {
+    return total_ + x;
+  }
+
+  int Total() const
+  {
+    return total_;
+  }
+
+ private:
+  int total_ = 0;
+};
+
+struct LargeHandler {
+  void operator()(int x)
+  {
+    *total_ptr += x;
+  }
+
+  int* total_ptr;
+  char padding[4u * tsig::DEFAULT_DELEGATE_INLINE_SIZE];
+};
+
+TEST(Delegate, Construct)
+{
+  IntDelegate delegate;
+  EXPECT_FALSE(delegate);
+  IntDelegate null_delegate(nullptr);
+  EXPECT_FALSE(null_delegate);
+  EXPECT_THROW(delegate(1), std::bad_function_call);
+}
+
+void AddOne(int& x)
+{
+  ++x;
+}
+
+TEST(Delegate, ConstructEmpty)
+{
+  // Null function pointers and empty functions make empty delegates, like std::function
+  void (*null_func_ptr)(int) = nullptr;
+  IntDelegate func_ptr_delegate(null_func_ptr);
+  EXPECT_FALSE(func_ptr_delegate);
+  EXPECT_THROW(func_ptr_delegate(1), std::bad_function_call);
+  IntDelegate function_delegate(std::function<void(int)>{});
+  EXPECT_FALSE(function_delegate);
+  EXPECT_THROW(function_delegate(1), std::bad_function_call);
+  IntDelegate small_delegate(tsig::Delegate<void(int), sizeof(void*)>{});
+  EXPECT_FALSE(small_delegate);
+  EXPECT_THROW(small_delegate(1), std::bad_function_call);
+  // But functions themselves are never null
+  int total = 0;
+  tsig::Delegate<void(int&)> add_delegate(AddOne);
+  EXPECT_TRUE(add_delegate);
+  add_delegate(total);
+  EXPECT_EQ(total, 1);
+}
+
+int TakeDelegate(const tsig::Delegate<void(int)>&)
+{
+  return 1;
+}
+
+int TakeDelegate(const tsig::Delegate<void(const std::string&)>&)
+{
+  return 2;
+}
+
+TEST(Delegate, ConstructOnlyCallable)
+{
+  // Like std::function, so overloads on other callable types aren't ambiguous
+  static_assert(!std::is_constructible<IntDelegate, int>::value, "");
+  static_assert(!std::is_constructible<IntDelegate, std::string>::value, "");
+  static_assert(!std::is_constructible<IntDelegate, void (*)(const std::string&)>::value, "");
+  static_assert(!std::is_constructible<tsig::Delegate<int(int)>, void (*)(int)>::value, "");
+  static_assert(std::is_constructible<tsig::Delegate<long(int)>, int (*)(int)>::value, "");
+  static_assert(std::is_constructible<IntDelegate, int (*)(int)>::value, "");
+  EXPECT_EQ(TakeDelegate([](int) {}), 1);
+  EXPECT_EQ(TakeDelegate([](const std::string&) {}), 2);
+}
+
+TEST(Delegate, CallLambda)
+{
+  int total = 0;
+  IntDelegate delegate([&total](int x) { total += x; });
+  EXPECT_TRUE(delegate);
+  delegate(1);
+  delegate(2);
+  EXPECT_EQ(total, 3);
+}
+
+TEST(Delegate, CallMember)
+{
+  Accumulator accumulator;
+  IntDelegate delegate(&accumulator, &Accumulator::Add);
+  delegate(1);
+  delegate(2);
+  EXPECT_EQ(accumulator.Total(), 3);
+  const Accumulator& const_accumulator = accumulator;
+  tsig::Delegate<void(int&)> const_delegate(&const_accumulator, &Accumulator::AddTo);
+  int x = 1;
+  const_delegate(x);
+  EXPECT_EQ(x, 4);
+}
+
+TEST(Delegate, BindMember)
+{
+  Accumulator accumulator;
+  IntDelegate delegate = IntDelegate::Bind<Accumulator, &Accumulator::Add>(&accumulator);
+  delegate(1);
+  delegate(2);
+  EXPECT_EQ(accumulator.Total(), 3);
+  const Accumulator& const_accumulator = accumulator;
+  auto const_delegate = tsig::Delegate<void(int&)>::Bind<Accumulator, &Accumulator::AddTo>(
+      &const_accumulator);
+  int x = 1;
+  const_delegate(x);
+  EXPECT_EQ(x, 4);
+}
+
+TEST(Delegate, CallResult)
+{
+  Accumulator accumulator;
+  accumulator.Add(1);
+  tsig::Delegate<int(int)> lambda_delegate([](int x) { return 2 * x; });
+  tsig::Delegate<int(int)> member_delegate(&accumulator, &Accumulator::Plus);
+  auto bind_delegate =
+      tsig::Delegate<int(int)>::Bind<Accumulator, &Accumulator::Plus>(&accumulator);
+  EXPECT_EQ(lambda_delegate(2), 4);
+  EXPECT_EQ(member_delegate(2), 3);
+  EXPECT_EQ(bind_delegate(3), 4);
+  // The result is discarded by a void delegate
+  IntDelegate void_delegate([&accumulator](int x) { return accumulator.Plus(x); });
+  void_delegate(1);
+}
+
+TEST(Delegate, CopyMove)
+{
+  int total = 0;
+  LargeHandler large_handler;
+  large_handler.total_ptr = &total;
+  IntDelegate delegate(large_handler);
+  IntDelegate copy_delegate(delegate);
+  IntDelegate move_delegate(std::move(delegate));
+  EXPECT_FALSE(delegate);
+  copy_delegate(1);
+  move_delegate(2);
+  EXPECT_EQ(total, 3);
+  delegate = copy_delegate;
+  delegate(3);
+  EXPECT_EQ(total, 6);
+  delegate = nullptr;
+  EXPECT_FALSE(delegate);
+}
+
+TEST(Delegate, NoAllocations)
+{
+  Accumulator accumulator;
+  using namespace std::placeholders;
+  const std::size_t start_num_allocations = num_allocations;
+  IntDelegate bind_delegate(std::bind(&Accumulator::Add, &accumulator, _1));
+  IntDelegate member_delegate(&accumulator, &Accumulator::Add);
+  IntDelegate lambda_delegate([&accumulator](int x) { accumulator.Add(x); });
+  IntDelegate copy_delegate(bind_delegate);
+  bind_delegate(1);
+  member_delegate(2);
+  lambda_delegate(3);
+  copy_delegate(4);
+  EXPECT_EQ(num_allocations, start_num_allocations);
+  EXPECT_EQ(accumulator.Total(), 10);
+}
+
+TEST(Delegate, LargeAllocates)
+{
+  int total = 0;
+  LargeHandler large_handler;
+  large_handler.total_ptr = &total;
+  const std::size_t start_num_allocations = num_allocations;
+  IntDelegate delegate(large_handler);
+  EXPECT_EQ(num_allocations, start_num_allocations + 1u);
+  delegate(1);
+  EXPECT_EQ(total, 1);
+}
+
+TEST(Delegate, SignalConnectMembers)
+{
+  tsig::Signal<void(int), tsig::DelegateHandlers<>> signal;
+  std::vector<Accumulator> accumulators(100u);
+  std::vector<tsig::Sigcon> sigcons;
+  sigcons.reserve(accumulators.size());
+  // Warm up the handler storage, so only the handlers themselves could allocate
+  for (Accumulator& accumulator : accumulators) {
+    sigcons.push_back(signal.Connect({&accumulator, &Accumulator::Add}));
+  }
+  sigcons.clear();
+  const std::size_t start_num_allocations = num_allocations;
+  using namespace std::placeholders;
+  for (Accumulator& accumulator : accumulators) {
+    sigcons.push_back(signal.Connect(std::bind(&Accumulator::Add, &accumulator, _1)));
+  }
+  EXPECT_EQ(num_allocations, start_num_allocations);
+  signal.Emit(1);
+  for (const Accumulator& accumulator : accumulators) {
+    EXPECT_EQ(accumulator.Total(), 1);
+  }
+}
+
+TEST(Delegate, SignalCollectNoAllocations)
+{
+  tsig::Signal<int(int), tsig::DelegateHandlers<>> signal;
+  std::vector<Accumulator> accumulators(100u);
+  std::vector<tsig::Sigcon> sigcons;
+  for (Accumulator& accumulator : accumulators) {
+    sigcons.push_back(signal.Connect({&accumulator, &Accumulator::Plus}));
+  }
+  std::vector<int> results;
+  results.reserve(accumulators.size());
+  const std::size_t start_num_allocations = num_allocations;
+  EXPECT_EQ(signal.EmitInto(tsig::CollectInto(results), 1), accumulators.size());
+  EXPECT_EQ(num_allocations, start_num_allocations);
+  ASSERT_EQ(results.size(), accumulators.size());
+  for (int result : results) {
+    EXPECT_EQ(result, 1);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,195 @@
+// Copyright (c) 2021 Tim Perkins
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <tsig/dispatcher.hpp>
+#include <tsig/signal.hpp>
+
+constexpr std::size_t NUM_PRODUCERS = 4;
+constexpr std::size_t NUM_PRODUCER_EMITS = 10000;
+
+TEST(ImmediateDispatcher, Emit)
+{
+  tsig::ImmediateDispatcher dispatcher;
+  tsig::SignalFactory<tsig::ImmediateDispatcher> factory(dispatcher);
+  auto signal = factory.MakeSignal<void(const std::string&, int)>();
+  std::vector<std::string> strs;
+  const tsig::Sigcon sigcon =
+      signal.Connect([&](const std::string& str, int x) { strs.push_back(str + std::to_string(x)); });
+  signal.Emit("BLUE", 1);
+  ASSERT_EQ(strs.size(), 1u);
+  EXPECT_EQ(strs.at(0), "BLUE1");
+}
+
+TEST(EventLoopDispatcher, EmitDeferred)
+{
+  tsig::EventLoopDispatcher dispatcher;
+  tsig::SignalFactory<tsig::EventLoopDispatcher> factory(dispatcher);
+  auto signal = factory.MakeSignal<void(const std::string&, int)>();
+  std::vector<std::string> strs;
+  const tsig::Sigcon sigcon =
+      signal.Connect([&](const std::string& str, int x) { strs.push_back(str + std::to_string(x)); });
+  {
+    // The queued emission keeps its own copy of the arguments
+    const std::string str = "BLUE";
+    signal.Emit(str, 1);
+  }
+  signal.Emit("RED", 2);
+  EXPECT_TRUE(strs.empty());
+  EXPECT_EQ(dispatcher.Poll(), 2u);
+  ASSERT_EQ(strs.size(), 2u);
+  EXPECT_EQ(strs.at(0), "BLUE1");
+  EXPECT_EQ(strs.at(1), "RED2");
+  EXPECT_EQ(dispatcher.Poll(), 0u);
+}
+
+TEST(EventLoopDispatcher, EmitDropped)
+{
+  tsig::EventLoopDispatcher dispatcher;
+  tsig::SignalFactory<tsig::EventLoopDispatcher> factory(dispatcher);
+  std::size_t num_calls = 0u;
+  {
+    auto signal = factory.MakeSignal<void(int)>();
+    const tsig::Sigcon sigcon = signal.Connect([&](int) { ++num_calls; });
+    signal.Emit(1);
+  }
+  EXPECT_EQ(dispatcher.Poll(), 1u);
+  EXPECT_EQ(num_calls, 0u);
+}
+
+TEST(EventLoopDispatcher, EmitBatch)
+{
+  tsig::EventLoopDispatcher dispatcher;
+  tsig::SignalFactory<tsig::EventLoopDispatcher> factory(dispatcher);
+  auto signal = factory.MakeSignal<void(const std::string&, int)>();
+  std::vector<std::string> strs;
+  const tsig::Sigcon sigcon =
+      signal.Connect([&](const std::string& str, int x) { strs.push_back(str + std::to_string(x)); });
+  {
+    // Each emission in the batch is queued with its own copy of the arguments
+    const std::vector<std::tuple<std::string, int>> batch_args = {
+        std::make_tuple("BLUE", 1), std::make_tuple("RED", 2)};
+    signal.EmitBatch(batch_args);
+  }
+  EXPECT_TRUE(strs.empty());
+  EXPECT_EQ(dispatcher.Poll(), 2u);
+  EXPECT_EQ(strs, std::vector<std::string>({"BLUE1", "RED2"}));
+}
+
+TEST(EventLoopDispatcher, TryDispatchFull)
+{
+  tsig::EventLoopDispatcher dispatcher(4u);
+  std::size_t num_calls = 0u;
+  std::size_t num_dispatched = 0u;
+  while (dispatcher.TryDispatch([&]() { ++num_calls; })) {
+    ++num_dispatched;
+  }
+  EXPECT_EQ(num_dispatched, 4u);
+  EXPECT_EQ(dispatcher.Poll(), 4u);
+  EXPECT_EQ(num_calls, 4u);
+}
+
+TEST(EventLoopDispatcher, PollThrows)
+{
+  tsig::EventLoopDispatcher dispatcher(4u);
+  const std::thread::id main_thread_id = std::this_thread::get_id();
+  std::atomic<std::size_t> num_main_calls(0u);
+  const auto record_call = [&]() {
+    if (std::this_thread::get_id() == main_thread_id) {
+      num_main_calls.fetch_add(1u);
+    }
+  };
+  dispatcher.Dispatch([]() { throw std::runtime_error("RED"); });
+  dispatcher.Dispatch(record_call);
+  EXPECT_THROW(dispatcher.Poll(), std::runtime_error);
+  // The rest of the tasks are still queued
+  EXPECT_EQ(num_main_calls.load(), 0u);
+  EXPECT_EQ(dispatcher.Poll(), 1u);
+  EXPECT_EQ(num_main_calls.load(), 1u);
+  while (dispatcher.TryDispatch(record_call)) {
+    // Fill the queue
+  }
+  std::thread loop_thread([&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    dispatcher.Run();
+  });
+  // No longer the loop thread, so this waits for the loop rather than polling
+  dispatcher.Dispatch([&]() {
+    record_call();
+    dispatcher.Stop();
+  });
+  loop_thread.join();
+  EXPECT_EQ(num_main_calls.load(), 1u);
+}
+
+TEST(EventLoopDispatcher, EmitCrossThread)
+{
+  tsig::EventLoopDispatcher dispatcher(64u);
+  tsig::SignalFactory<tsig::EventLoopDispatcher> factory(dispatcher);
+  auto signal = factory.MakeSignal<void(std::size_t, std::size_t)>();
+  std::thread::id handler_thread_id;
+  std::vector<std::size_t> next_values(NUM_PRODUCERS, 0u);
+  std::size_t num_out_of_order = 0u;
+  std::size_t num_calls = 0u;
+  const tsig::Sigcon sigcon = signal.Connect([&](std::size_t producer, std::size_t value) {
+    handler_thread_id = std::this_thread::get_id();
+    // Emissions from each producer must arrive in order
+    if (next_values.at(producer) != value) {
+      ++num_out_of_order;
+    }
+    next_values.at(producer) = value + 1u;
+    if (++num_calls == NUM_PRODUCERS * NUM_PRODUCER_EMITS) {
+      dispatcher.Stop();
+    }
+  });
+  std::thread loop_thread([&]() { dispatcher.Run(); });
+  const std::thread::id loop_thread_id = loop_thread.get_id();
+  std::vector<std::thread> producer_threads;
+  for (std::size_t ii = 0; ii < NUM_PRODUCERS; ++ii) {
+    producer_threads.emplace_back([&, ii]() {
+      for (std::size_t jj = 0; jj < NUM_PRODUCER_EMITS; ++jj) {
+        signal.Emit(std::size_t(ii), std::size_t(jj));
+      }
+    });
+  }
+  for (std::thread& producer_thread : producer_threads) {
+    producer_thread.join();
+  }
+  loop_thread.join();
+  EXPECT_EQ(num_calls, NUM_PRODUCERS * NUM_PRODUCER_EMITS);
+  EXPECT_EQ(num_out_of_order, 0u);
+  EXPECT_EQ(handler_thread_id, loop_thread_id);
+}
+
+TEST(EventLoopDispatcher, StopBeforeRun)
+{
+  tsig::EventLoopDispatcher dispatcher(64u);
+  std::size_t num_calls = 0u;
+  dispatcher.Dispatch([&]() { ++num_calls; });
+  // A stop which arrives before the loop starts isn't lost
+  dispatcher.Stop();
+  std::thread loop_thread([&]() { dispatcher.Run(); });
+  loop_thread.join();
+  EXPECT_EQ(num_calls, 0u);
+  dispatcher.Reset();
+  dispatcher.Dispatch([&]() {
+    ++num_calls;
+    dispatcher.Stop();
+  });
+  dispatcher.Run();
+  EXPECT_EQ(num_calls, 2u);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
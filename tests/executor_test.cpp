@@ -0,0 +1,352 @@
+// Copyright (c) 2021 Tim Perkins
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <tsig/signal.hpp>
+#include <tsig/tn/executor.hpp>
+#include <tsig/tn/node.hpp>
+
+constexpr std::size_t NUM_THREADS = 4;
+constexpr std::size_t NUM_THREAD_EMITS = 10000;
+constexpr std::size_t NUM_STAGES = 4;
+
+using PassNode = tsig::tn::Node<tsig::tn::WithInputs<int>, tsig::tn::WithOutputs<int>>;
+using EndNode = tsig::tn::Node<tsig::tn::WithInputs<int>, tsig::tn::WithoutOutputs>;
+
+namespace {
+
+class PassTask {
+ public:
+  tsig::tn::DataHandlerTuple<int> GetHandlers()
+  {
+    return {[this](const int& x) { output_sink_(x + 1); }};
+  }
+
+  void SetSinks(const tsig::tn::DataSinkTuple<int>& sinks)
+  {
+    output_sink_ = std::get<0>(sinks);
+  }
+
+ private:
+  tsig::tn::DataSink<int> output_sink_;
+};
+
+// Records into a vector which may be shared with other nodes
+class EndTask {
+ public:
+  explicit EndTask(std::vector<int>& values) : values_(values) {}
+
+  tsig::tn::DataHandlerTuple<int> GetHandlers()
+  {
+    return {[this](const int& x) { values_.push_back(x); }};
+  }
+
+  void SetSinks(tsig::tn::DataSinkTuple<>)
+  {
+    // Do nothing
+  }
+
+ private:
+  std::vector<int>& values_;
+};
+
+void SetSinks(PassNode& node, PassTask& task)
+{
+  task.SetSinks(tsig::tn::DataSinkTuple<int>(node.GetSink<0>()));
+}
+
+void SetSinks(EndNode&, EndTask&)
+{
+  // Do nothing
+}
+
+// Nodes keep pointers to themselves in their sinks, so they're built in place
+template <typename NodeType, typename TaskType>
+std::unique_ptr<NodeType> MakeNode(TaskType& task, const tsig::tn::Mailbox& mailbox)
+{
+  std::unique_ptr<NodeType> node(new NodeType());
+  node->RunOn(mailbox);
+  node->template RegisterHandler<0>(std::get<0>(task.GetHandlers()));
+  SetSinks(*node, task);
+  return node;
+}
+
+}  // namespace
+
+TEST(Executor, Construct)
+{
+  tsig::tn::Executor executor(NUM_THREADS);
+  EXPECT_EQ(executor.NumThreads(), NUM_THREADS);
+  tsig::tn::Executor default_executor;
+  EXPECT_GE(default_executor.NumThreads(), 1u);
+  default_executor.WaitIdle();
+}
+
+TEST(Executor, PostOrder)
+{
+  tsig::tn::Executor executor(NUM_THREADS);
+  const tsig::tn::Mailbox mailbox = executor.MakeMailbox();
+  std::vector<std::size_t> values;
+  for (std::size_t ii = 0; ii < NUM_THREAD_EMITS; ++ii) {
+    mailbox.Post([&values, ii]() { values.push_back(ii); });
+  }
+  executor.WaitIdle();
+  ASSERT_EQ(values.size(), NUM_THREAD_EMITS);
+  for (std::size_t ii = 0; ii < NUM_THREAD_EMITS; ++ii) {
+    EXPECT_EQ(values[ii], ii);
+  }
+}
+
+TEST(Executor, PostConcurrent)
+{
+  tsig::tn::Executor executor(NUM_THREADS);
+  const tsig::tn::Mailbox mailbox = executor.MakeMailbox();
+  std::vector<std::pair<std::size_t, std::size_t>> values;
+  std::vector<std::thread> threads;
+  for (std::size_t ii = 0; ii < NUM_THREADS; ++ii) {
+    threads.emplace_back([&, ii]() {
+      for (std::size_t jj = 0; jj < NUM_THREAD_EMITS; ++jj) {
+        mailbox.Post([&values, ii, jj]() { values.emplace_back(ii, jj); });
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  executor.WaitIdle();
+  // The messages of each thread are run in the order they were posted
+  ASSERT_EQ(values.size(), NUM_THREADS * NUM_THREAD_EMITS);
+  std::vector<std::size_t> next_values(NUM_THREADS, 0u);
+  for (const std::pair<std::size_t, std::size_t>& value : values) {
+    EXPECT_EQ(value.second, next_values.at(value.first)++);
+  }
+}
+
+TEST(Executor, MailboxesInParallel)
+{
+  tsig::tn::Executor executor(2u);
+  const tsig::tn::Mailbox mailbox = executor.MakeMailbox();
+  const tsig::tn::Mailbox other_mailbox = executor.MakeMailbox();
+  std::atomic<bool> released(false);
+  // Only finishes if the other mailbox runs at the same time
+  mailbox.Post([&]() {
+    while (!released.load()) {
+      std::this_thread::yield();
+    }
+  });
+  other_mailbox.Post([&]() { released.store(true); });
+  executor.WaitIdle();
+  EXPECT_TRUE(released.load());
+}
+
+TEST(Executor, PostDuringMessage)
+{
+  tsig::tn::Executor executor(NUM_THREADS);
+  const tsig::tn::Mailbox mailbox = executor.MakeMailbox();
+  const tsig::tn::Mailbox other_mailbox = executor.MakeMailbox();
+  std::atomic<std::size_t> num_calls(0u);
+  std::function<void(std::size_t)> post_next = [&](std::size_t depth) {
+    num_calls.fetch_add(1u);
+    if (depth != 0u) {
+      const tsig::tn::Mailbox& next_mailbox = (depth % 2u == 0u) ? mailbox : other_mailbox;
+      next_mailbox.Post([&post_next, depth]() { post_next(depth - 1u); });
+    }
+  };
+  mailbox.Post([&]() { post_next(NUM_THREAD_EMITS); });
+  // Waits for the messages posted by messages too
+  executor.WaitIdle();
+  EXPECT_EQ(num_calls.load(), NUM_THREAD_EMITS + 1u);
+}
+
+TEST(Executor, MessageThrows)
+{
+  std::atomic<std::size_t> num_errors(0u);
+  tsig::tn::Executor executor(NUM_THREADS, [&num_errors](std::exception_ptr error_ptr) {
+    EXPECT_THROW(std::rethrow_exception(error_ptr), std::runtime_error);
+    num_errors.fetch_add(1u);
+  });
+  const tsig::tn::Mailbox mailbox = executor.MakeMailbox();
+  std::atomic<std::size_t> num_calls(0u);
+  for (std::size_t ii = 0; ii < NUM_THREAD_EMITS; ++ii) {
+    mailbox.Post([&num_calls, ii]() {
+      if (ii % 2u == 0u) {
+        throw std::runtime_error("RED");
+      }
+      num_calls.fetch_add(1u);
+    });
+  }
+  // The mailbox keeps running after an error, and the errors are still counted as finished
+  executor.WaitIdle();
+  EXPECT_EQ(num_errors.load(), NUM_THREAD_EMITS / 2u);
+  EXPECT_EQ(num_calls.load(), NUM_THREAD_EMITS / 2u);
+}
+
+TEST(Executor, DestroyWhileQueued)
+{
+  std::atomic<std::size_t> num_calls(0u);
+  std::function<void(void)> post_self;
+  {
+    tsig::tn::Executor executor(NUM_THREADS);
+    const tsig::tn::Mailbox mailbox = executor.MakeMailbox();
+    const tsig::tn::Mailbox other_mailbox = executor.MakeMailbox();
+    // Never runs out of messages
+    post_self = [&]() {
+      num_calls.fetch_add(1u);
+      mailbox.Post([&post_self]() { post_self(); });
+    };
+    mailbox.Post([&post_self]() { post_self(); });
+    for (std::size_t ii = 0; ii < NUM_THREAD_EMITS; ++ii) {
+      other_mailbox.Post([&num_calls]() { num_calls.fetch_add(1u); });
+    }
+    while (num_calls.load() == 0u) {
+      std::this_thread::yield();
+    }
+  }
+  // Nothing runs after the executor is destroyed
+  const std::size_t end_num_calls = num_calls.load();
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_EQ(num_calls.load(), end_num_calls);
+}
+
+TEST(Executor, NodePipeline)
+{
+  tsig::tn::Executor executor(NUM_THREADS);
+  tsig::Signal<void(const int&)> source;
+  std::vector<std::unique_ptr<PassTask>> pass_tasks;
+  std::vector<std::unique_ptr<PassNode>> pass_nodes;
+  for (std::size_t ii = 0; ii < NUM_STAGES; ++ii) {
+    pass_tasks.emplace_back(new PassTask());
+    pass_nodes.push_back(MakeNode<PassNode>(*pass_tasks.back(), executor.MakeMailbox()));
+    if (ii == 0) {
+      pass_nodes.back()->Accept<0>(source);
+    }
+    else {
+      pass_nodes[ii - 1]->Connect<0, 0>(*pass_nodes.back());
+    }
+  }
+  std::vector<int> values;
+  EndTask end_task(values);
+  std::unique_ptr<EndNode> end_node = MakeNode<EndNode>(end_task, executor.MakeMailbox());
+  pass_nodes.back()->Connect<0, 0>(*end_node);
+  for (std::size_t ii = 0; ii < NUM_THREAD_EMITS; ++ii) {
+    source.Emit(static_cast<int>(ii));
+  }
+  executor.WaitIdle();
+  // Each node runs its messages in order, so the values come out in order
+  ASSERT_EQ(values.size(), NUM_THREAD_EMITS);
+  for (std::size_t ii = 0; ii < NUM_THREAD_EMITS; ++ii) {
+    EXPECT_EQ(values[ii], static_cast<int>(ii + NUM_STAGES));
+  }
+}
+
+TEST(Executor, ConnectDuringRun)
+{
+  tsig::tn::Executor executor(NUM_THREADS);
+  tsig::Signal<void(const int&)> source;
+  PassTask pass_task;
+  std::unique_ptr<PassNode> pass_node = MakeNode<PassNode>(pass_task, executor.MakeMailbox());
+  pass_node->Accept<0>(source);
+  std::atomic<std::size_t> num_calls(0u);
+  std::atomic<bool> done(false);
+  std::thread thread([&]() {
+    for (std::size_t ii = 0; ii < NUM_THREAD_EMITS; ++ii) {
+      source.Emit(1);
+    }
+    done.store(true);
+  });
+  // The output is emitted from the executor's threads while it's connected and disconnected
+  while (!done.load()) {
+    const tsig::Sigcon sigcon =
+        pass_node->Connect<0>([&num_calls](const int&) { num_calls.fetch_add(1u); });
+  }
+  thread.join();
+  executor.WaitIdle();
+  const std::size_t start_num_calls = num_calls.load();
+  const tsig::Sigcon sigcon =
+      pass_node->Connect<0>([&num_calls](const int&) { num_calls.fetch_add(1u); });
+  source.Emit(1);
+  executor.WaitIdle();
+  EXPECT_EQ(num_calls.load(), start_num_calls + 1u);
+}
+
+TEST(Executor, NodeGroup)
+{
+  tsig::tn::Executor executor(NUM_THREADS);
+  // The nodes share a mailbox, so they can share the values without locking
+  const tsig::tn::Mailbox mailbox = executor.MakeMailbox();
+  std::vector<int> values;
+  EndTask end_task(values);
+  EndTask other_end_task(values);
+  std::unique_ptr<EndNode> end_node = MakeNode<EndNode>(end_task, mailbox);
+  std::unique_ptr<EndNode> other_end_node = MakeNode<EndNode>(other_end_task, mailbox);
+  // Signals aren't multi threaded, so each thread emits its own
+  tsig::Signal<void(const int&)> source;
+  tsig::Signal<void(const int&)> other_source;
+  end_node->Accept<0>(source);
+  other_end_node->Accept<0>(other_source);
+  std::thread thread([&]() {
+    for (std::size_t ii = 0; ii < NUM_THREAD_EMITS; ++ii) {
+      source.Emit(1);
+    }
+  });
+  std::thread other_thread([&]() {
+    for (std::size_t ii = 0; ii < NUM_THREAD_EMITS; ++ii) {
+      other_source.Emit(2);
+    }
+  });
+  thread.join();
+  other_thread.join();
+  executor.WaitIdle();
+  EXPECT_EQ(values.size(), 2u * NUM_THREAD_EMITS);
+}
+
+TEST(Executor, NodeDestroyed)
+{
+  tsig::tn::Executor executor(NUM_THREADS);
+  const tsig::tn::Mailbox mailbox = executor.MakeMailbox();
+  tsig::Signal<void(const int&)> source;
+  std::vector<int> values;
+  EndTask end_task(values);
+  std::unique_ptr<EndNode> end_node = MakeNode<EndNode>(end_task, mailbox);
+  end_node->Accept<0>(source);
+  // Hold up the mailbox, so the emissions are still queued when the node is destroyed
+  std::atomic<bool> released(false);
+  std::atomic<bool> running(false);
+  mailbox.Post([&]() {
+    running.store(true);
+    while (!released.load()) {
+      std::this_thread::yield();
+    }
+  });
+  for (std::size_t ii = 0; ii < NUM_THREAD_EMITS; ++ii) {
+    source.Emit(1);
+  }
+  while (!running.load()) {
+    std::this_thread::yield();
+  }
+  std::thread release_thread([&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    released.store(true);
+  });
+  // Waits for the running message to finish
+  end_node = nullptr;
+  EXPECT_TRUE(released.load());
+  release_thread.join();
+  executor.WaitIdle();
+  EXPECT_TRUE(values.empty());
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
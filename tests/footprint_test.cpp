@@ -0,0 +1,124 @@
+// Copyright (c) 2021 Tim Perkins
+
+#include <fmt/format.h>
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include <tsig/signal.hpp>
+#include <tsig/tn/node.hpp>
+
+namespace {
+
+std::size_t num_allocated_bytes = 0u;
+
+}  // namespace
+
+void* operator new(std::size_t size)
+{
+  num_allocated_bytes += size;
+  void* const ptr = std::malloc(size != 0u ? size : 1u);
+  if (!ptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+namespace {
+
+constexpr std::size_t NUM_IDLE_OBJECTS = 1000;
+
+using IntSignal = tsig::Signal<void(int)>;
+
+using DiagNode = tsig::tn::Node<tsig::tn::WithInputs<int, double>,
+                                tsig::tn::WithOutputs<int, double, std::vector<int>>>;
+
+// Heap bytes allocated per object, when making many idle objects
+template <typename T>
+std::size_t IdleHeapBytes()
+{
+  std::vector<T> objects;
+  objects.reserve(NUM_IDLE_OBJECTS);
+  const std::size_t start_num_allocated_bytes = num_allocated_bytes;
+  for (std::size_t ii = 0; ii < NUM_IDLE_OBJECTS; ++ii) {
+    objects.emplace_back();
+  }
+  return (num_allocated_bytes - start_num_allocated_bytes) / NUM_IDLE_OBJECTS;
+}
+
+template <typename T>
+void ReportFootprint(const char* name, std::size_t heap_bytes)
+{
+  fmt::print("{}: sizeof {} bytes, heap {} bytes\n", name, sizeof(T), heap_bytes);
+  testing::Test::RecordProperty(std::string(name) + "_sizeof", static_cast<int>(sizeof(T)));
+  testing::Test::RecordProperty(std::string(name) + "_heap", static_cast<int>(heap_bytes));
+}
+
+}  // namespace
+
+TEST(Footprint, IdleSignal)
+{
+  const std::size_t heap_bytes = IdleHeapBytes<IntSignal>();
+  ReportFootprint<IntSignal>("Signal", heap_bytes);
+  EXPECT_EQ(heap_bytes, 0u);
+}
+
+TEST(Footprint, IdleNode)
+{
+  const std::size_t heap_bytes = IdleHeapBytes<DiagNode>();
+  ReportFootprint<DiagNode>("Node", heap_bytes);
+  EXPECT_EQ(heap_bytes, 0u);
+}
+
+TEST(Footprint, EmitUnconnected)
+{
+  IntSignal signal;
+  tsig::Signal<int(int)> result_signal;
+  const std::size_t start_num_allocated_bytes = num_allocated_bytes;
+  signal.Emit(1);
+  EXPECT_EQ(result_signal.Emit(1), 0);
+  EXPECT_EQ(num_allocated_bytes, start_num_allocated_bytes);
+}
+
+TEST(Footprint, ConnectAllocates)
+{
+  IntSignal signal;
+  const std::size_t start_num_allocated_bytes = num_allocated_bytes;
+  int total = 0;
+  {
+    const tsig::Sigcon sigcon = signal.Connect([&total](int x) { total += x; });
+    EXPECT_GT(num_allocated_bytes, start_num_allocated_bytes);
+    signal.Emit(1);
+  }
+  // The data is kept after the handler is disconnected
+  signal.Emit(1);
+  EXPECT_EQ(total, 1);
+}
+
+TEST(Footprint, ConnectorAllocates)
+{
+  IntSignal signal;
+  auto signal_connector = tsig::MakeSignalConnector(signal);
+  int total = 0;
+  const tsig::Sigcon sigcon = signal_connector([&total](int x) { total += x; });
+  signal.Emit(1);
+  EXPECT_EQ(total, 1);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
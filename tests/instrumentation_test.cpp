@@ -0,0 +1,249 @@
+// Copyright (c) 2021 Tim Perkins
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <tsig/instrumentation.hpp>
+#include <tsig/signal.hpp>
+
+constexpr std::size_t NUM_THREADS = 4;
+constexpr std::size_t NUM_THREAD_EMITS = 10000;
+
+using InstrumentedSignal = tsig::Signal<void(int), tsig::Instrumented>;
+
+namespace {
+
+std::uint64_t SumLatencyBuckets(const tsig::HandlerStats& handler_stats)
+{
+  return std::accumulate(handler_stats.latency_buckets.begin(),
+                         handler_stats.latency_buckets.end(), std::uint64_t(0u));
+}
+
+const tsig::SignalStats* FindSignalStats(const std::vector<tsig::SignalStats>& all_signal_stats,
+                                         const std::string& name)
+{
+  for (const tsig::SignalStats& signal_stats : all_signal_stats) {
+    if (signal_stats.name == name) {
+      return &signal_stats;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+TEST(Instrumentation, Uninstrumented)
+{
+  tsig::Signal<void(int)> signal;
+  signal.SetName("BLUE");
+  const tsig::Sigcon sigcon = signal.Connect([](int) {});
+  signal.Emit(1);
+  const tsig::SignalStats signal_stats = signal.GetStats();
+  EXPECT_EQ(signal_stats.name, "");
+  EXPECT_EQ(signal_stats.num_emits, 0u);
+  EXPECT_EQ(signal_stats.num_handlers, 0u);
+  EXPECT_TRUE(signal_stats.handler_stats.empty());
+}
+
+TEST(Instrumentation, CountEmits)
+{
+  InstrumentedSignal signal;
+  signal.SetName("BLUE");
+  // Idle signals are counted too
+  signal.Emit(1);
+  const tsig::Sigcon sigcon1 = signal.Connect([](int) {});
+  const tsig::Sigcon sigcon2 = signal.Connect([](int) {});
+  signal.Emit(2);
+  signal.Emit(3);
+  const tsig::SignalStats signal_stats = signal.GetStats();
+  EXPECT_EQ(signal_stats.name, "BLUE");
+  EXPECT_EQ(signal_stats.num_emits, 3u);
+  EXPECT_EQ(signal_stats.num_handlers, 2u);
+  ASSERT_EQ(signal_stats.handler_stats.size(), 2u);
+  for (const tsig::HandlerStats& handler_stats : signal_stats.handler_stats) {
+    EXPECT_EQ(handler_stats.num_calls, 2u);
+    EXPECT_EQ(SumLatencyBuckets(handler_stats), 2u);
+  }
+}
+
+TEST(Instrumentation, Disconnect)
+{
+  InstrumentedSignal signal;
+  tsig::Sigcon sigcon1 = signal.Connect([](int) {});
+  const tsig::Sigcon sigcon2 = signal.Connect([](int) {});
+  signal.Emit(1);
+  sigcon1.Reset();
+  signal.Emit(2);
+  const tsig::SignalStats signal_stats = signal.GetStats();
+  EXPECT_EQ(signal_stats.num_emits, 2u);
+  EXPECT_EQ(signal_stats.num_handlers, 1u);
+  ASSERT_EQ(signal_stats.handler_stats.size(), 1u);
+  EXPECT_EQ(signal_stats.handler_stats[0].num_calls, 2u);
+}
+
+TEST(Instrumentation, Priorities)
+{
+  InstrumentedSignal signal;
+  const tsig::Sigcon sigcon1 = signal.Connect([](int) {}, -10);
+  const tsig::Sigcon sigcon2 = signal.Connect([](int) {}, 10);
+  const tsig::Sigcon sigcon3 = signal.Connect([](int) {}, 10);
+  signal.Emit(1);
+  signal.Emit(2);
+  const tsig::Sigcon sigcon4 = signal.Connect([](int) {}, 100);
+  signal.Emit(3);
+  // The stats are in call order, so the highest priority comes first
+  const tsig::SignalStats signal_stats = signal.GetStats();
+  ASSERT_EQ(signal_stats.handler_stats.size(), 4u);
+  EXPECT_EQ(signal_stats.handler_stats[0].num_calls, 1u);
+  EXPECT_EQ(signal_stats.handler_stats[1].num_calls, 3u);
+  EXPECT_EQ(signal_stats.handler_stats[2].num_calls, 3u);
+  EXPECT_EQ(signal_stats.handler_stats[3].num_calls, 3u);
+}
+
+TEST(Instrumentation, DisconnectTracked)
+{
+  InstrumentedSignal signal;
+  auto tracked_ptr = std::make_shared<int>(0);
+  signal.Connect(tracked_ptr, [](int) {});
+  const tsig::Sigcon sigcon = signal.Connect([](int) {});
+  signal.Emit(1);
+  EXPECT_EQ(signal.GetStats().num_handlers, 2u);
+  // The expired handler is removed by the next emission
+  tracked_ptr = nullptr;
+  signal.Emit(2);
+  const tsig::SignalStats signal_stats = signal.GetStats();
+  EXPECT_EQ(signal_stats.num_handlers, 1u);
+  ASSERT_EQ(signal_stats.handler_stats.size(), 1u);
+  EXPECT_EQ(signal_stats.handler_stats[0].num_calls, 2u);
+}
+
+TEST(Instrumentation, CountThrows)
+{
+  InstrumentedSignal signal;
+  const tsig::Sigcon sigcon = signal.Connect([](int x) {
+    if (x == 2) {
+      throw std::runtime_error("BLUE");
+    }
+  });
+  signal.Emit(1);
+  EXPECT_THROW(signal.Emit(2), std::runtime_error);
+  // Calls which throw are recorded too
+  const tsig::SignalStats signal_stats = signal.GetStats();
+  ASSERT_EQ(signal_stats.handler_stats.size(), 1u);
+  EXPECT_EQ(signal_stats.handler_stats[0].num_calls, 2u);
+  EXPECT_EQ(SumLatencyBuckets(signal_stats.handler_stats[0]), 2u);
+}
+
+TEST(Instrumentation, Latency)
+{
+  InstrumentedSignal signal;
+  const tsig::Sigcon sigcon =
+      signal.Connect([](int) { std::this_thread::sleep_for(std::chrono::milliseconds(1)); });
+  signal.Emit(1);
+  const tsig::SignalStats signal_stats = signal.GetStats();
+  ASSERT_EQ(signal_stats.handler_stats.size(), 1u);
+  const tsig::HandlerStats& handler_stats = signal_stats.handler_stats[0];
+  EXPECT_GE(handler_stats.total_latency_ns, 1000000u);
+  // A millisecond is at least 2^19 ns
+  const std::uint64_t num_slow_calls =
+      std::accumulate(handler_stats.latency_buckets.begin() + 20,
+                      handler_stats.latency_buckets.end(), std::uint64_t(0u));
+  EXPECT_EQ(num_slow_calls, 1u);
+}
+
+TEST(Instrumentation, ResultSignal)
+{
+  tsig::Signal<int(int), tsig::Instrumented> signal;
+  const tsig::Sigcon sigcon1 = signal.Connect([](int x) { return x; });
+  const tsig::Sigcon sigcon2 = signal.Connect([](int x) { return 2 * x; });
+  EXPECT_EQ(signal.Emit(1), 2);
+  EXPECT_TRUE(signal.EmitWith<tsig::AnyOf>(1));
+  const tsig::SignalStats signal_stats = signal.GetStats();
+  EXPECT_EQ(signal_stats.num_emits, 2u);
+  ASSERT_EQ(signal_stats.handler_stats.size(), 2u);
+  EXPECT_EQ(signal_stats.handler_stats[0].num_calls, 2u);
+  // The second handler isn't called once the result is known
+  EXPECT_EQ(signal_stats.handler_stats[1].num_calls, 1u);
+}
+
+TEST(Instrumentation, EmitBatch)
+{
+  InstrumentedSignal signal;
+  const tsig::Sigcon sigcon = signal.Connect([](int) {});
+  const std::vector<std::tuple<int>> batch_args = {std::make_tuple(1), std::make_tuple(2)};
+  signal.EmitBatch(batch_args);
+  const tsig::SignalStats signal_stats = signal.GetStats();
+  EXPECT_EQ(signal_stats.num_emits, 2u);
+  ASSERT_EQ(signal_stats.handler_stats.size(), 1u);
+  EXPECT_EQ(signal_stats.handler_stats[0].num_calls, 2u);
+}
+
+TEST(Instrumentation, AllSignalStats)
+{
+  {
+    InstrumentedSignal signal1;
+    signal1.SetName("BLUE");
+    InstrumentedSignal signal2;
+    signal2.SetName("RED");
+    signal2.Emit(1);
+    const std::vector<tsig::SignalStats> all_signal_stats = tsig::GetAllSignalStats();
+    const tsig::SignalStats* const blue_stats_ptr = FindSignalStats(all_signal_stats, "BLUE");
+    const tsig::SignalStats* const red_stats_ptr = FindSignalStats(all_signal_stats, "RED");
+    ASSERT_NE(blue_stats_ptr, nullptr);
+    ASSERT_NE(red_stats_ptr, nullptr);
+    EXPECT_EQ(blue_stats_ptr->num_emits, 0u);
+    EXPECT_EQ(red_stats_ptr->num_emits, 1u);
+  }
+  // Destroyed signals are no longer part of the snapshot
+  const std::vector<tsig::SignalStats> all_signal_stats = tsig::GetAllSignalStats();
+  EXPECT_EQ(FindSignalStats(all_signal_stats, "BLUE"), nullptr);
+  EXPECT_EQ(FindSignalStats(all_signal_stats, "RED"), nullptr);
+}
+
+TEST(Instrumentation, Dump)
+{
+  InstrumentedSignal signal;
+  signal.SetName("BLUE");
+  const tsig::Sigcon sigcon = signal.Connect([](int) {});
+  signal.Emit(1);
+  std::ostringstream oss;
+  tsig::DumpAllSignalStats(oss);
+  EXPECT_NE(oss.str().find("signal BLUE: 1 emits, 1 handlers\n  handler 0: 1 calls"),
+            std::string::npos);
+}
+
+TEST(Instrumentation, EmitConcurrent)
+{
+  tsig::Signal<void(int), tsig::MultiThreaded, tsig::Instrumented> signal;
+  const tsig::Sigcon sigcon = signal.Connect([](int) {});
+  std::vector<std::thread> threads;
+  for (std::size_t ii = 0; ii < NUM_THREADS; ++ii) {
+    threads.emplace_back([&signal]() {
+      for (std::size_t jj = 0; jj < NUM_THREAD_EMITS; ++jj) {
+        signal.Emit(1);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  const tsig::SignalStats signal_stats = signal.GetStats();
+  EXPECT_EQ(signal_stats.num_emits, NUM_THREADS * NUM_THREAD_EMITS);
+  ASSERT_EQ(signal_stats.handler_stats.size(), 1u);
+  EXPECT_EQ(signal_stats.handler_stats[0].num_calls, NUM_THREADS * NUM_THREAD_EMITS);
+  EXPECT_EQ(SumLatencyBuckets(signal_stats.handler_stats[0]), NUM_THREADS * NUM_THREAD_EMITS);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
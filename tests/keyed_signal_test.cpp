@@ -0,0 +1,150 @@
+// Copyright (c) 2021 Tim Perkins
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <tsig/dispatcher.hpp>
+#include <tsig/keyed_signal.hpp>
+
+constexpr std::size_t NUM_KEYS = 10;
+constexpr std::size_t NUM_THREADS = 4;
+constexpr std::size_t NUM_THREAD_EMITS = 10000;
+
+using KeyedStringSignal = tsig::KeyedSignal<std::string, void(const std::string&, int)>;
+
+TEST(KeyedSignal, Construct)
+{
+  KeyedStringSignal signal;
+  signal.Emit("BLUE", "BLUE", 1);
+  KeyedStringSignal move_signal(std::move(signal));
+  move_signal.Emit("BLUE", "BLUE", 1);
+}
+
+TEST(KeyedSignal, Emit)
+{
+  KeyedStringSignal signal;
+  std::vector<std::string> called;
+  const auto handler = [&](const std::string& str, int x) {
+    called.push_back(str + std::to_string(x));
+  };
+  const tsig::Sigcon sigcon1 = signal.Connect("BLUE", handler);
+  const tsig::Sigcon sigcon2 = signal.Connect("RED", handler);
+  const tsig::Sigcon sigcon3 = signal.Connect("BLUE", handler);
+  signal.Emit("BLUE", "A", 1);
+  signal.Emit("RED", "B", 2);
+  signal.Emit("GREEN", "C", 3);
+  EXPECT_EQ(called, std::vector<std::string>({"A1", "A1", "B2"}));
+}
+
+TEST(KeyedSignal, EmitReset)
+{
+  KeyedStringSignal signal;
+  std::size_t num_calls = 0u;
+  tsig::Sigcon sigcon1 = signal.Connect("BLUE", [&](const std::string&, int) { ++num_calls; });
+  const tsig::Sigcon sigcon2 =
+      signal.Connect("BLUE", [&](const std::string&, int) { ++num_calls; });
+  signal.Emit("BLUE", "BLUE", 1);
+  EXPECT_EQ(num_calls, 2u);
+  sigcon1.Reset();
+  signal.Emit("BLUE", "BLUE", 1);
+  EXPECT_EQ(num_calls, 3u);
+}
+
+TEST(KeyedSignal, EmitDropped)
+{
+  std::size_t num_calls = 0u;
+  tsig::Sigcon sigcon;
+  {
+    KeyedStringSignal signal;
+    sigcon = signal.Connect("BLUE", [&](const std::string&, int) { ++num_calls; });
+  }
+  sigcon.Reset();
+  EXPECT_EQ(num_calls, 0u);
+}
+
+TEST(KeyedSignal, ConnectDuringEmit)
+{
+  tsig::KeyedSignal<int, void(int)> signal;
+  std::vector<tsig::Sigcon> sigcons;
+  std::size_t num_calls = 0u;
+  sigcons.push_back(signal.Connect(0, [&](int) {
+    // Adding a key while emitting must not disturb the emission
+    for (int key = 1; key < static_cast<int>(NUM_KEYS); ++key) {
+      sigcons.push_back(signal.Connect(key, [&](int) { ++num_calls; }));
+    }
+  }));
+  signal.Emit(0, 1);
+  for (int key = 1; key < static_cast<int>(NUM_KEYS); ++key) {
+    signal.Emit(key, 1);
+  }
+  EXPECT_EQ(num_calls, NUM_KEYS - 1u);
+}
+
+TEST(KeyedSignal, PruneKeys)
+{
+  tsig::KeyedSignal<int, void(int)> signal;
+  std::size_t num_calls = 0u;
+  const tsig::Sigcon sigcon = signal.Connect(0, [&](int) { ++num_calls; });
+  // Keys whose handlers are all disconnected are pruned as new keys come and go
+  for (int key = 1; key < 1000; ++key) {
+    const tsig::Sigcon key_sigcon = signal.Connect(key, [&](int) { ++num_calls; });
+  }
+  EXPECT_LE(signal.NumKeys(), 4u);
+  for (int key = 0; key < 1000; ++key) {
+    signal.Emit(key, 1);
+  }
+  EXPECT_EQ(num_calls, 1u);
+}
+
+TEST(KeyedSignal, EmitDispatched)
+{
+  tsig::EventLoopDispatcher dispatcher;
+  tsig::KeyedSignal<int, void(int), tsig::DispatchWith<tsig::EventLoopDispatcher>> signal(
+      dispatcher);
+  int total = 0;
+  const tsig::Sigcon sigcon = signal.Connect(1, [&](int x) { total += x; });
+  signal.Emit(1, 1);
+  signal.Emit(2, 2);
+  EXPECT_EQ(total, 0);
+  dispatcher.Poll();
+  EXPECT_EQ(total, 1);
+}
+
+TEST(KeyedSignal, EmitConcurrent)
+{
+  tsig::KeyedSignal<std::size_t, void(int), tsig::MultiThreaded> signal;
+  std::vector<std::atomic<int>> totals(NUM_KEYS);
+  std::vector<tsig::Sigcon> sigcons;
+  for (std::size_t key = 0; key < NUM_KEYS; ++key) {
+    totals[key].store(0);
+    sigcons.push_back(signal.Connect(key, [&totals, key](int x) { totals[key].fetch_add(x); }));
+  }
+  std::vector<std::thread> threads;
+  for (std::size_t ii = 0; ii < NUM_THREADS; ++ii) {
+    threads.emplace_back([&]() {
+      for (std::size_t jj = 0; jj < NUM_THREAD_EMITS; ++jj) {
+        signal.Emit(jj % NUM_KEYS, 1);
+      }
+    });
+  }
+  // Connecting new keys while emitting is fine too
+  for (std::size_t key = NUM_KEYS; key < 2u * NUM_KEYS; ++key) {
+    sigcons.push_back(signal.Connect(key, [](int) {}));
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  for (std::size_t key = 0; key < NUM_KEYS; ++key) {
+    EXPECT_EQ(totals[key].load(), static_cast<int>(NUM_THREADS * NUM_THREAD_EMITS / NUM_KEYS));
+  }
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,306 @@
+// Copyright (c) 2021 Tim Perkins
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include <tsig/signal.hpp>
+#include <tsig/tn/executor.hpp>
+#include <tsig/tn/message_pool.hpp>
+#include <tsig/tn/node.hpp>
+
+// GCC sees the replaced delete inlined but not the replaced new, and thinks they don't match
+#if defined(__GNUC__) && !defined(__clang__) && (__GNUC__ >= 11)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+namespace {
+
+// Executor threads allocate too
+std::atomic<std::size_t> num_allocations(0u);
+
+}  // namespace
+
+void* operator new(std::size_t size)
+{
+  num_allocations.fetch_add(1u, std::memory_order_relaxed);
+  void* const ptr = std::malloc(size != 0u ? size : 1u);
+  if (!ptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+constexpr std::size_t NUM_THREADS = 4;
+constexpr std::size_t NUM_CONSUMERS = 3;
+constexpr std::size_t NUM_FRAMES = 100;
+
+struct Blob {
+  std::vector<int> data;
+};
+
+using SharedBlob = tsig::tn::Shared<Blob>;
+using ProducerNode = tsig::tn::Node<tsig::tn::WithInputs<int>, tsig::tn::WithOutputs<SharedBlob>>;
+using ConsumerNode = tsig::tn::Node<tsig::tn::WithInputs<SharedBlob>, tsig::tn::WithoutOutputs>;
+using CopyNode = tsig::tn::Node<tsig::tn::WithInputs<Blob>, tsig::tn::WithOutputs<Blob>>;
+
+namespace {
+
+// Makes a blob of the given size
+class ProducerTask {
+ public:
+  tsig::tn::DataHandlerTuple<int> GetHandlers()
+  {
+    return {[this](const int& size) {
+      output_sink_(std::make_shared<const Blob>(Blob{std::vector<int>(size, 1)}));
+    }};
+  }
+
+  void SetSinks(const tsig::tn::DataSinkTuple<SharedBlob>& sinks)
+  {
+    output_sink_ = std::get<0>(sinks);
+  }
+
+ private:
+  tsig::tn::DataSink<SharedBlob> output_sink_;
+};
+
+// Fills a pooled blob of the given size
+class PooledProducerTask {
+ public:
+  tsig::tn::DataHandlerTuple<int> GetHandlers()
+  {
+    return {[this](const int& size) {
+      const std::shared_ptr<Blob> blob_ptr = output_sink_.Acquire();
+      blob_ptr->data.assign(static_cast<std::size_t>(size), 1);
+      output_sink_(blob_ptr);
+    }};
+  }
+
+  void SetSinks(const tsig::tn::DataSinkTuple<SharedBlob>& sinks)
+  {
+    output_sink_ = std::get<0>(sinks);
+  }
+
+ private:
+  tsig::tn::DataSink<SharedBlob> output_sink_;
+};
+
+// Keeps every blob it's given
+class ConsumerTask {
+ public:
+  tsig::tn::DataHandlerTuple<SharedBlob> GetHandlers()
+  {
+    return {[this](const std::shared_ptr<const Blob>& blob_ptr) {
+      blob_ptrs_.push_back(blob_ptr);
+    }};
+  }
+
+  void SetSinks(tsig::tn::DataSinkTuple<>)
+  {
+    // Do nothing
+  }
+
+  const std::vector<std::shared_ptr<const Blob>>& BlobPtrs() const
+  {
+    return blob_ptrs_;
+  }
+
+ private:
+  std::vector<std::shared_ptr<const Blob>> blob_ptrs_;
+};
+
+}  // namespace
+
+TEST(Node, SharedPort)
+{
+  tsig::Signal<void(const int&)> source;
+  std::vector<ConsumerTask> consumer_tasks(NUM_CONSUMERS);
+  std::vector<ConsumerNode> consumer_nodes;
+  for (ConsumerTask& consumer_task : consumer_tasks) {
+    consumer_nodes.push_back(tsig::tn::NodeBuilder<ConsumerNode>::Build(consumer_task));
+  }
+  // Nodes keep pointers to themselves in their sinks, so the producer is built in place
+  ProducerTask producer_task;
+  ProducerNode producer_node;
+  producer_node.RegisterHandler<0>(std::get<0>(producer_task.GetHandlers()));
+  producer_task.SetSinks(tsig::tn::DataSinkTuple<SharedBlob>(producer_node.GetSink<0>()));
+  producer_node.Accept<0>(source);
+  for (ConsumerNode& consumer_node : consumer_nodes) {
+    producer_node.Connect<0, 0>(consumer_node);
+  }
+  source.Emit(1000);
+  // Every consumer keeps the same blob, which is never copied
+  const std::shared_ptr<const Blob> blob_ptr = consumer_tasks.at(0).BlobPtrs().at(0);
+  EXPECT_EQ(blob_ptr->data.size(), 1000u);
+  for (const ConsumerTask& consumer_task : consumer_tasks) {
+    ASSERT_EQ(consumer_task.BlobPtrs().size(), 1u);
+    EXPECT_EQ(consumer_task.BlobPtrs().at(0), blob_ptr);
+  }
+  EXPECT_EQ(blob_ptr.use_count(), static_cast<long>(NUM_CONSUMERS + 1u));
+}
+
+TEST(Node, SharedPortExecutor)
+{
+  tsig::tn::Executor executor(NUM_THREADS);
+  tsig::Signal<void(const std::shared_ptr<const Blob>&)> source;
+  std::vector<ConsumerTask> consumer_tasks(NUM_CONSUMERS);
+  std::vector<std::unique_ptr<ConsumerNode>> consumer_nodes;
+  for (ConsumerTask& consumer_task : consumer_tasks) {
+    consumer_nodes.emplace_back(new ConsumerNode());
+    consumer_nodes.back()->RunOn(executor);
+    consumer_nodes.back()->RegisterHandler<0>(std::get<0>(consumer_task.GetHandlers()));
+    consumer_nodes.back()->Accept<0>(source);
+  }
+  const std::shared_ptr<const Blob> blob_ptr =
+      std::make_shared<const Blob>(Blob{std::vector<int>(1000, 1)});
+  source.Emit(blob_ptr);
+  executor.WaitIdle();
+  // Even the messages queued for the consumers only share the blob
+  for (const ConsumerTask& consumer_task : consumer_tasks) {
+    ASSERT_EQ(consumer_task.BlobPtrs().size(), 1u);
+    EXPECT_EQ(consumer_task.BlobPtrs().at(0), blob_ptr);
+  }
+}
+
+TEST(Node, CopyPort)
+{
+  tsig::Signal<void(const Blob&)> source;
+  CopyNode copy_node;
+  copy_node.RegisterHandler<0>([&copy_node](const Blob& blob) {
+    Blob bigger_blob = blob;
+    bigger_blob.data.push_back(2);
+    copy_node.GetSink<0>()(bigger_blob);
+  });
+  copy_node.Accept<0>(source);
+  std::vector<Blob> blobs;
+  const tsig::Sigcon sigcon =
+      copy_node.Connect<0>([&](const Blob& blob) { blobs.push_back(blob); });
+  source.Emit(Blob{{1}});
+  ASSERT_EQ(blobs.size(), 1u);
+  EXPECT_EQ(blobs.at(0).data, std::vector<int>({1, 2}));
+}
+
+TEST(MessagePool, Recycle)
+{
+  const tsig::tn::MessagePool<Blob> pool;
+  std::shared_ptr<Blob> blob_ptr = pool.Acquire();
+  blob_ptr->data.assign(1000u, 1);
+  const Blob* const blob_raw_ptr = blob_ptr.get();
+  EXPECT_EQ(pool.NumFree(), 0u);
+  blob_ptr = nullptr;
+  EXPECT_EQ(pool.NumFree(), 1u);
+  // The same blob comes back, still holding its data
+  blob_ptr = pool.Acquire();
+  EXPECT_EQ(blob_ptr.get(), blob_raw_ptr);
+  EXPECT_EQ(blob_ptr->data.size(), 1000u);
+}
+
+TEST(MessagePool, Reserve)
+{
+  const tsig::tn::MessagePool<Blob> pool;
+  pool.Reserve(NUM_CONSUMERS, [](Blob& blob) { blob.data.reserve(1000u); });
+  EXPECT_EQ(pool.NumFree(), NUM_CONSUMERS);
+  const std::shared_ptr<Blob> blob_ptr = pool.Acquire();
+  EXPECT_GE(blob_ptr->data.capacity(), 1000u);
+  EXPECT_EQ(pool.NumFree(), NUM_CONSUMERS - 1u);
+}
+
+TEST(MessagePool, MessageOutlivesPool)
+{
+  std::shared_ptr<const Blob> blob_ptr;
+  {
+    const tsig::tn::MessagePool<Blob> pool;
+    pool.Reserve(NUM_CONSUMERS);
+    blob_ptr = pool.Acquire();
+  }
+  // The pool is freed with the last message
+  EXPECT_TRUE(blob_ptr->data.empty());
+}
+
+TEST(MessagePool, NoAllocation)
+{
+  const tsig::tn::MessagePool<Blob> pool;
+  pool.Reserve(1u, [](Blob& blob) { blob.data.reserve(1000u); });
+  const std::size_t start_num_allocations = num_allocations.load();
+  for (std::size_t ii = 0; ii < NUM_FRAMES; ++ii) {
+    const std::shared_ptr<Blob> blob_ptr = pool.Acquire();
+    blob_ptr->data.assign(1000u, static_cast<int>(ii));
+    const std::shared_ptr<const Blob> shared_blob_ptr = blob_ptr;
+  }
+  EXPECT_EQ(num_allocations.load(), start_num_allocations);
+}
+
+TEST(Node, PooledSinkNoAllocation)
+{
+  tsig::Signal<void(const int&)> source;
+  PooledProducerTask producer_task;
+  ProducerNode producer_node;
+  producer_node.RegisterHandler<0>(std::get<0>(producer_task.GetHandlers()));
+  producer_task.SetSinks(tsig::tn::DataSinkTuple<SharedBlob>(producer_node.GetSink<0>()));
+  producer_node.Accept<0>(source);
+  // Only keeps the latest blob, so the blobs are recycled
+  std::shared_ptr<const Blob> latest_blob_ptr;
+  const tsig::Sigcon sigcon = producer_node.Connect<0>(
+      [&](const std::shared_ptr<const Blob>& blob_ptr) { latest_blob_ptr = blob_ptr; });
+  // Warm up the pool, then the frames don't allocate
+  source.Emit(1000);
+  source.Emit(1000);
+  const std::size_t start_num_allocations = num_allocations.load();
+  for (std::size_t ii = 0; ii < NUM_FRAMES; ++ii) {
+    source.Emit(1000);
+  }
+  EXPECT_EQ(num_allocations.load(), start_num_allocations);
+  EXPECT_EQ(latest_blob_ptr->data.size(), 1000u);
+}
+
+TEST(Node, PooledSinkExecutor)
+{
+  tsig::tn::Executor executor(NUM_THREADS);
+  tsig::Signal<void(const int&)> source;
+  PooledProducerTask producer_task;
+  ProducerNode producer_node;
+  producer_node.RegisterHandler<0>(std::get<0>(producer_task.GetHandlers()));
+  producer_task.SetSinks(tsig::tn::DataSinkTuple<SharedBlob>(producer_node.GetSink<0>()));
+  producer_node.Accept<0>(source);
+  // The consumers drop the blobs on the executor threads, returning them to the pool
+  std::vector<std::unique_ptr<ConsumerNode>> consumer_nodes;
+  std::vector<std::atomic<std::size_t>> totals(NUM_CONSUMERS);
+  for (std::atomic<std::size_t>& total : totals) {
+    total.store(0u);
+    consumer_nodes.emplace_back(new ConsumerNode());
+    consumer_nodes.back()->RunOn(executor);
+    consumer_nodes.back()->RegisterHandler<0>(
+        [&total](const std::shared_ptr<const Blob>& blob_ptr) {
+          total.fetch_add(blob_ptr->data.size());
+        });
+    producer_node.Connect<0, 0>(*consumer_nodes.back());
+  }
+  for (std::size_t ii = 0; ii < NUM_FRAMES; ++ii) {
+    source.Emit(static_cast<int>(ii));
+  }
+  executor.WaitIdle();
+  for (const std::atomic<std::size_t>& total : totals) {
+    EXPECT_EQ(total.load(), NUM_FRAMES * (NUM_FRAMES - 1u) / 2u);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
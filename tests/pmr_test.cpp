@@ -0,0 +1,130 @@
+// Copyright (c) 2021 Tim Perkins
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+#include <tsig/signal.hpp>
+
+constexpr std::size_t ARENA_SIZE = 64 * 1024;
+constexpr std::size_t NUM_SIGNALS = 100;
+
+template <typename Func, typename... Policies>
+using PmrSignal = tsig::Signal<Func, tsig::PmrAllocation, Policies...>;
+
+namespace {
+
+// An arena which can't fall back to the heap, so anything allocated elsewhere is caught
+class Arena {
+ public:
+  Arena() : resource_(buffer_.data(), buffer_.size(), std::pmr::null_memory_resource()) {}
+
+  std::pmr::memory_resource* Resource()
+  {
+    return &resource_;
+  }
+
+ private:
+  alignas(std::max_align_t) std::array<std::byte, ARENA_SIZE> buffer_;
+  std::pmr::monotonic_buffer_resource resource_;
+};
+
+}  // namespace
+
+TEST(PmrSignal, Emit)
+{
+  Arena arena;
+  PmrSignal<void(int)> signal(arena.Resource());
+  int total = 0;
+  tsig::Sigcon sigcon1 = signal.Connect([&total](int x) { total += x; });
+  const tsig::Sigcon sigcon2 = signal.Connect([&total](int x) { total += 2 * x; });
+  signal.Emit(1);
+  EXPECT_EQ(total, 3);
+  sigcon1.Reset();
+  signal.Emit(1);
+  EXPECT_EQ(total, 5);
+}
+
+TEST(PmrSignal, ConnectDuringEmit)
+{
+  Arena arena;
+  PmrSignal<void(int)> signal(arena.Resource());
+  std::vector<tsig::Sigcon> sigcons;
+  sigcons.reserve(10);
+  int total = 0;
+  sigcons.push_back(signal.Connect([&](int x) {
+    total += x;
+    // The snapshot is shared with this emission, so the copy is made in the arena too
+    if (sigcons.size() < 10) {
+      sigcons.push_back(signal.Connect([&total](int x) { total += x; }));
+    }
+  }));
+  signal.Emit(1);
+  signal.Emit(1);
+  EXPECT_EQ(total, 3);
+}
+
+TEST(PmrSignal, EmitBatch)
+{
+  Arena arena;
+  PmrSignal<void(int)> signal(arena.Resource());
+  int total = 0;
+  const tsig::Sigcon sigcon = signal.ConnectBatch([&total](const tsig::Batch<int>& batch) {
+    for (const std::tuple<int>& args : batch) {
+      total += std::get<0>(args);
+    }
+  });
+  signal.Emit(1);
+  EXPECT_EQ(total, 1);
+}
+
+TEST(PmrSignal, ResultSignal)
+{
+  Arena arena;
+  PmrSignal<int(int), tsig::SumResults> signal(arena.Resource());
+  const tsig::Sigcon sigcon1 = signal.Connect([](int x) { return x; });
+  const tsig::Sigcon sigcon2 = signal.Connect([](int x) { return 2 * x; });
+  EXPECT_EQ(signal.Emit(1), 3);
+}
+
+TEST(PmrSignal, MultiThreaded)
+{
+  Arena arena;
+  PmrSignal<void(int), tsig::MultiThreaded> signal(arena.Resource());
+  int total = 0;
+  tsig::Sigcon sigcon1 = signal.Connect([&total](int x) { total += x; });
+  const tsig::Sigcon sigcon2 = signal.Connect([&total](int x) { total += 2 * x; });
+  signal.Emit(1);
+  sigcon1.Reset();
+  signal.Emit(1);
+  EXPECT_EQ(total, 5);
+}
+
+TEST(PmrSignal, PoolTeardown)
+{
+  std::pmr::unsynchronized_pool_resource pool;
+  {
+    std::vector<PmrSignal<void(int)>> signals;
+    std::vector<tsig::Sigcon> sigcons;
+    int total = 0;
+    for (std::size_t ii = 0; ii < NUM_SIGNALS; ++ii) {
+      signals.emplace_back(&pool);
+      sigcons.push_back(signals.back().Connect([&total](int x) { total += x; }));
+    }
+    for (const PmrSignal<void(int)>& signal : signals) {
+      signal.Emit(1);
+    }
+    EXPECT_EQ(total, static_cast<int>(NUM_SIGNALS));
+  }
+  // Everything was given back to the pool, which can now be released in one shot
+  pool.release();
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,345 @@
+// Copyright (c) 2021 Tim Perkins
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <tsig/signal.hpp>
+#include <tsig/tn/executor.hpp>
+#include <tsig/tn/node.hpp>
+#include <tsig/tn/queue.hpp>
+
+constexpr std::size_t NUM_THREADS = 2;
+constexpr int NUM_EMITS = 10;
+
+using PassNode = tsig::tn::Node<tsig::tn::WithInputs<int>, tsig::tn::WithOutputs<int>>;
+using EndNode = tsig::tn::Node<tsig::tn::WithInputs<int>, tsig::tn::WithoutOutputs>;
+using Source = tsig::Signal<void(const int&), tsig::MultiThreaded>;
+
+namespace {
+
+// Blocks until opened
+class Gate {
+ public:
+  void Open()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    open_ = true;
+    condition_.notify_all();
+  }
+
+  void Wait()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait(lock, [this]() { return open_; });
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool open_ = false;
+};
+
+// Holds up the first value until the gate is opened, so the values after it are queued
+class SlowEnd {
+ public:
+  explicit SlowEnd(tsig::tn::Executor& executor) : node_(new EndNode())
+  {
+    node_->RunOn(executor);
+    node_->RegisterHandler<0>([this](const int& x) {
+      if (values_.empty()) {
+        entered_gate_.Open();
+        exit_gate_.Wait();
+      }
+      values_.push_back(x);
+    });
+  }
+
+  EndNode& GetNode()
+  {
+    return *node_;
+  }
+
+  void DestroyNode()
+  {
+    node_ = nullptr;
+  }
+
+  // Waits until the first value is being held up
+  void WaitEntered()
+  {
+    entered_gate_.Wait();
+  }
+
+  void Release()
+  {
+    exit_gate_.Open();
+  }
+
+  const std::vector<int>& GetValues() const
+  {
+    return values_;
+  }
+
+ private:
+  Gate entered_gate_;
+  Gate exit_gate_;
+  std::vector<int> values_;
+  std::unique_ptr<EndNode> node_;
+};
+
+std::vector<int> RunSlowEnd(const tsig::tn::QueueOptions& options, tsig::tn::QueueStats& stats)
+{
+  tsig::tn::Executor executor(NUM_THREADS);
+  Source source;
+  SlowEnd slow_end(executor);
+  slow_end.GetNode().Accept<0>(source, options);
+  source.Emit(0);
+  slow_end.WaitEntered();
+  for (int ii = 1; ii <= NUM_EMITS; ++ii) {
+    source.Emit(ii);
+  }
+  slow_end.Release();
+  executor.WaitIdle();
+  stats = slow_end.GetNode().GetQueueStats<0>();
+  return slow_end.GetValues();
+}
+
+}  // namespace
+
+TEST(BoundedQueue, DropOldest)
+{
+  tsig::tn::detail::BoundedQueue<int> queue(
+      tsig::tn::QueueOptions(tsig::tn::OverflowPolicy::DROP_OLDEST, 2u));
+  EXPECT_TRUE(queue.Push(1));
+  EXPECT_FALSE(queue.Push(2));
+  EXPECT_FALSE(queue.Push(3));
+  int value = 0;
+  EXPECT_TRUE(queue.Pop(value));
+  EXPECT_EQ(value, 2);
+  EXPECT_TRUE(queue.Pop(value));
+  EXPECT_EQ(value, 3);
+  EXPECT_FALSE(queue.Pop(value));
+  // Drained, so the next push needs draining again
+  EXPECT_TRUE(queue.Push(4));
+  const tsig::tn::QueueStats stats = queue.GetStats();
+  EXPECT_EQ(stats.capacity, 2u);
+  EXPECT_EQ(stats.size, 1u);
+  EXPECT_EQ(stats.high_water_mark, 2u);
+  EXPECT_EQ(stats.num_pushed, 4u);
+  EXPECT_EQ(stats.num_dropped, 1u);
+  EXPECT_EQ(stats.num_blocked, 0u);
+}
+
+TEST(BoundedQueue, DropNewest)
+{
+  tsig::tn::detail::BoundedQueue<int> queue(
+      tsig::tn::QueueOptions(tsig::tn::OverflowPolicy::DROP_NEWEST, 2u));
+  queue.Push(1);
+  queue.Push(2);
+  queue.Push(3);
+  int value = 0;
+  EXPECT_TRUE(queue.Pop(value));
+  EXPECT_EQ(value, 1);
+  EXPECT_TRUE(queue.Pop(value));
+  EXPECT_EQ(value, 2);
+  EXPECT_FALSE(queue.Pop(value));
+  EXPECT_EQ(queue.GetStats().num_pushed, 2u);
+  EXPECT_EQ(queue.GetStats().num_dropped, 1u);
+}
+
+TEST(BoundedQueue, KeepLatest)
+{
+  tsig::tn::detail::BoundedQueue<int> queue(
+      tsig::tn::QueueOptions(tsig::tn::OverflowPolicy::KEEP_LATEST, 8u));
+  queue.Push(1);
+  queue.Push(2);
+  queue.Push(3);
+  int value = 0;
+  EXPECT_TRUE(queue.Pop(value));
+  EXPECT_EQ(value, 3);
+  EXPECT_FALSE(queue.Pop(value));
+  EXPECT_EQ(queue.GetStats().capacity, 1u);
+  EXPECT_EQ(queue.GetStats().num_dropped, 2u);
+}
+
+TEST(BoundedQueue, Block)
+{
+  tsig::tn::detail::BoundedQueue<int> queue(
+      tsig::tn::QueueOptions(tsig::tn::OverflowPolicy::BLOCK, 1u));
+  queue.Push(1);
+  std::thread producer([&queue]() { queue.Push(2); });
+  while (queue.GetStats().num_blocked == 0u) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  int value = 0;
+  EXPECT_TRUE(queue.Pop(value));
+  EXPECT_EQ(value, 1);
+  producer.join();
+  EXPECT_TRUE(queue.Pop(value));
+  EXPECT_EQ(value, 2);
+  EXPECT_EQ(queue.GetStats().num_dropped, 0u);
+}
+
+TEST(BoundedQueue, CloseWakesBlocked)
+{
+  tsig::tn::detail::BoundedQueue<int> queue(
+      tsig::tn::QueueOptions(tsig::tn::OverflowPolicy::BLOCK, 1u));
+  queue.Push(1);
+  std::thread producer([&queue]() { queue.Push(2); });
+  while (queue.GetStats().num_blocked == 0u) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  queue.Close();
+  producer.join();
+  queue.Push(3);
+  EXPECT_EQ(queue.GetStats().num_pushed, 1u);
+  EXPECT_EQ(queue.GetStats().num_dropped, 2u);
+}
+
+TEST(NodeQueue, DropOldest)
+{
+  tsig::tn::QueueStats stats;
+  const std::vector<int> values =
+      RunSlowEnd(tsig::tn::QueueOptions(tsig::tn::OverflowPolicy::DROP_OLDEST, 4u), stats);
+  const std::vector<int> expected_values = {0, 7, 8, 9, 10};
+  EXPECT_EQ(values, expected_values);
+  EXPECT_EQ(stats.size, 0u);
+  EXPECT_EQ(stats.high_water_mark, 4u);
+  EXPECT_EQ(stats.num_pushed, 11u);
+  EXPECT_EQ(stats.num_dropped, 6u);
+}
+
+TEST(NodeQueue, DropNewest)
+{
+  tsig::tn::QueueStats stats;
+  const std::vector<int> values =
+      RunSlowEnd(tsig::tn::QueueOptions(tsig::tn::OverflowPolicy::DROP_NEWEST, 4u), stats);
+  const std::vector<int> expected_values = {0, 1, 2, 3, 4};
+  EXPECT_EQ(values, expected_values);
+  EXPECT_EQ(stats.num_pushed, 5u);
+  EXPECT_EQ(stats.num_dropped, 6u);
+}
+
+TEST(NodeQueue, KeepLatest)
+{
+  tsig::tn::QueueStats stats;
+  const std::vector<int> values =
+      RunSlowEnd(tsig::tn::QueueOptions(tsig::tn::OverflowPolicy::KEEP_LATEST), stats);
+  const std::vector<int> expected_values = {0, 10};
+  EXPECT_EQ(values, expected_values);
+  EXPECT_EQ(stats.high_water_mark, 1u);
+  EXPECT_EQ(stats.num_dropped, 9u);
+}
+
+TEST(NodeQueue, Block)
+{
+  tsig::tn::Executor executor(NUM_THREADS);
+  Source source;
+  SlowEnd slow_end(executor);
+  slow_end.GetNode().Accept<0>(source,
+                               tsig::tn::QueueOptions(tsig::tn::OverflowPolicy::BLOCK, 2u));
+  source.Emit(0);
+  slow_end.WaitEntered();
+  std::thread producer([&source]() {
+    for (int ii = 1; ii <= NUM_EMITS; ++ii) {
+      source.Emit(ii);
+    }
+  });
+  while (slow_end.GetNode().GetQueueStats<0>().num_blocked == 0u) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  slow_end.Release();
+  producer.join();
+  executor.WaitIdle();
+  std::vector<int> expected_values;
+  for (int ii = 0; ii <= NUM_EMITS; ++ii) {
+    expected_values.push_back(ii);
+  }
+  EXPECT_EQ(slow_end.GetValues(), expected_values);
+  const tsig::tn::QueueStats stats = slow_end.GetNode().GetQueueStats<0>();
+  EXPECT_EQ(stats.high_water_mark, 2u);
+  EXPECT_EQ(stats.num_pushed, 11u);
+  EXPECT_EQ(stats.num_dropped, 0u);
+}
+
+TEST(NodeQueue, DestroyWhileBlocked)
+{
+  tsig::tn::Executor executor(NUM_THREADS);
+  Source source;
+  SlowEnd slow_end(executor);
+  slow_end.GetNode().Accept<0>(source,
+                               tsig::tn::QueueOptions(tsig::tn::OverflowPolicy::BLOCK, 1u));
+  source.Emit(0);
+  slow_end.WaitEntered();
+  source.Emit(1);
+  std::thread producer([&source]() { source.Emit(2); });
+  while (slow_end.GetNode().GetQueueStats<0>().num_blocked == 0u) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  // Destroying the node unblocks the producer, then waits for the held up value
+  std::thread destroyer([&slow_end]() { slow_end.DestroyNode(); });
+  producer.join();
+  slow_end.Release();
+  destroyer.join();
+  // The queued value may still be received, but the blocked value is dropped
+  const std::vector<int>& values = slow_end.GetValues();
+  ASSERT_FALSE(values.empty());
+  EXPECT_EQ(values.front(), 0);
+  EXPECT_LE(values.size(), 2u);
+}
+
+TEST(NodeQueue, Connect)
+{
+  // Queues between nodes are set up when connecting
+  tsig::tn::Executor executor(NUM_THREADS);
+  Source source;
+  PassNode pass_node;
+  pass_node.RunOn(executor);
+  pass_node.RegisterHandler<0>(
+      [&pass_node](const int& x) { pass_node.GetSink<0>()(x + 1); });
+  pass_node.Accept<0>(source);
+  SlowEnd slow_end(executor);
+  pass_node.Connect<0, 0>(slow_end.GetNode(),
+                          tsig::tn::QueueOptions(tsig::tn::OverflowPolicy::KEEP_LATEST));
+  source.Emit(0);
+  slow_end.WaitEntered();
+  for (int ii = 1; ii <= NUM_EMITS; ++ii) {
+    source.Emit(ii);
+  }
+  // Wait for the pass node to pass everything on, before letting the end node go
+  while (slow_end.GetNode().GetQueueStats<0>().num_pushed != 11u) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  slow_end.Release();
+  executor.WaitIdle();
+  const std::vector<int> expected_values = {1, 11};
+  EXPECT_EQ(slow_end.GetValues(), expected_values);
+  EXPECT_EQ(pass_node.GetQueueStats<0>().num_pushed, 0u);
+}
+
+TEST(NodeQueue, Direct)
+{
+  // Nodes which aren't run on an executor call their handlers directly
+  Source source;
+  std::vector<int> values;
+  EndNode end_node;
+  end_node.RegisterHandler<0>([&values](const int& x) { values.push_back(x); });
+  end_node.Accept<0>(source, tsig::tn::QueueOptions(tsig::tn::OverflowPolicy::DROP_NEWEST, 1u));
+  for (int ii = 0; ii < NUM_EMITS; ++ii) {
+    source.Emit(ii);
+  }
+  EXPECT_EQ(values.size(), static_cast<std::size_t>(NUM_EMITS));
+  EXPECT_EQ(end_node.GetQueueStats<0>().capacity, 0u);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
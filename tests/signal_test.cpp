@@ -5,7 +5,19 @@
 
 #include <tsig/signal.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+
 constexpr std::size_t NUM_MULTI_TESTERS = 10;
+constexpr std::size_t NUM_THREADS = 4;
+constexpr std::size_t NUM_THREAD_EMITS = 10000;
 
 using VoidSignal = tsig::Signal<void(const std::string&, int, int)>;
 
@@ -324,6 +336,1157 @@ TEST(Signal, DropDuringEmit)
   }
 }
 
+TEST(Signal, ConnectDuringEmit)
+{
+  VoidSignal signal;
+  VoidSignalTester tester;
+  VoidSignalTester other_tester;
+  tsig::Sigcon other_sigcon;
+  tester.SetPostHandler([&]() {
+    if (tester.NumCalls() == 1u) {
+      other_sigcon = signal.Connect(std::ref(other_tester));
+    }
+  });
+  tsig::Sigcon sigcon = signal.Connect(std::ref(tester));
+  signal.Emit("BLUE", 1, 2);
+  ASSERT_EQ(tester.NumCalls(), 1u);
+  // The new handler is not part of the in-flight emission
+  EXPECT_EQ(other_tester.NumCalls(), 0u);
+  signal.Emit("RED", 3, 4);
+  ASSERT_EQ(tester.NumCalls(), 2u);
+  ASSERT_EQ(other_tester.NumCalls(), 1u);
+  EXPECT_EQ(other_tester.CalledArgs(0), VoidSignalArgs("RED", 3, 4));
+}
+
+TEST(Signal, DestroyDuringEmit)
+{
+  VoidSignal* signal_ptr = new VoidSignal();
+  VoidSignalTester tester;
+  VoidSignalTester other_tester;
+  tester.SetPostHandler([&]() {
+    delete signal_ptr;
+    signal_ptr = nullptr;
+  });
+  const tsig::Sigcon sigcon = signal_ptr->Connect(std::ref(tester));
+  const tsig::Sigcon other_sigcon = signal_ptr->Connect(std::ref(other_tester));
+  signal_ptr->Emit("BLUE", 1, 2);
+  EXPECT_EQ(signal_ptr, nullptr);
+  // The in-flight emission finishes, even though the signal is gone
+  ASSERT_EQ(tester.NumCalls(), 1u);
+  ASSERT_EQ(other_tester.NumCalls(), 1u);
+  EXPECT_EQ(other_tester.CalledArgs(0), VoidSignalArgs("BLUE", 1, 2));
+}
+
+TEST(Signal, EmitNoHandlerCopy)
+{
+  VoidSignal signal;
+  VoidSignalTester tester;
+  CopyMoveWrapper<VoidSignalTester> wrapper(tester);
+  const tsig::Sigcon sigcon = signal.Connect(wrapper);
+  wrapper.ResetCounts();
+  signal.Emit("BLUE", 1, 2);
+  signal.Emit("RED", 3, 4);
+  EXPECT_EQ(tester.NumCalls(), 2u);
+  EXPECT_EQ(wrapper.CopyCount(), 0u);
+  EXPECT_EQ(wrapper.MoveCount(), 0u);
+}
+
+TEST(Signal, ConnectDuringEmitNoHandlerCopy)
+{
+  VoidSignal signal;
+  VoidSignalTester tester;
+  CopyMoveWrapper<VoidSignalTester> wrapper(tester);
+  VoidSignalTester other_tester;
+  std::vector<tsig::Sigcon> other_sigcons;
+  const tsig::Sigcon sigcon = signal.Connect(wrapper);
+  // Each emission copies the snapshot, but the handlers are shared rather than copied
+  tester.SetPostHandler([&]() { other_sigcons.push_back(signal.Connect(std::ref(other_tester))); });
+  wrapper.ResetCounts();
+  signal.Emit("BLUE", 1, 2);
+  signal.Emit("RED", 3, 4);
+  EXPECT_EQ(tester.NumCalls(), 2u);
+  EXPECT_EQ(other_tester.NumCalls(), 1u);
+  EXPECT_EQ(wrapper.CopyCount(), 0u);
+  EXPECT_EQ(wrapper.MoveCount(), 0u);
+}
+
+TEST(Signal, EmitConnectionOrder)
+{
+  tsig::Signal<void(void)> signal;
+  std::vector<std::size_t> call_order;
+  std::vector<tsig::Sigcon> sigcons;
+  for (std::size_t ii = 0; ii < NUM_MULTI_TESTERS; ++ii) {
+    sigcons.push_back(signal.Connect([&, ii]() { call_order.push_back(ii); }));
+  }
+  // Disconnect the even handlers, then reconnect them into the freed slots
+  for (std::size_t ii = 0; ii < NUM_MULTI_TESTERS; ii += 2) {
+    sigcons.at(ii).Reset();
+  }
+  for (std::size_t ii = 0; ii < NUM_MULTI_TESTERS; ii += 2) {
+    sigcons.at(ii) = signal.Connect([&, ii]() { call_order.push_back(ii); });
+  }
+  signal.Emit();
+  std::vector<std::size_t> expected_order;
+  for (std::size_t ii = 1; ii < NUM_MULTI_TESTERS; ii += 2) {
+    expected_order.push_back(ii);
+  }
+  for (std::size_t ii = 0; ii < NUM_MULTI_TESTERS; ii += 2) {
+    expected_order.push_back(ii);
+  }
+  EXPECT_EQ(call_order, expected_order);
+}
+
+TEST(Signal, ConnectPriority)
+{
+  tsig::Signal<void(void)> signal;
+  std::vector<int> call_order;
+  std::vector<tsig::Sigcon> sigcons;
+  const std::vector<int> priorities = {0, 2, -1, 2, 1, 0};
+  for (std::size_t ii = 0; ii < priorities.size(); ++ii) {
+    const int priority = priorities.at(ii);
+    sigcons.push_back(signal.Connect(
+        [&call_order, priority, ii]() {
+          call_order.push_back(10 * priority + static_cast<int>(ii));
+        },
+        priority));
+  }
+  signal.Emit();
+  // Higher priorities first, then in connection order
+  EXPECT_EQ(call_order, std::vector<int>({21, 23, 14, 0, 5, -8}));
+}
+
+TEST(Signal, ConnectPriorityAfterDisconnect)
+{
+  tsig::Signal<void(void)> signal;
+  std::vector<std::size_t> call_order;
+  std::vector<tsig::Sigcon> sigcons;
+  for (std::size_t ii = 0; ii < NUM_MULTI_TESTERS; ++ii) {
+    const int priority = (ii % 2 == 0) ? 1 : 0;
+    sigcons.push_back(signal.Connect([&, ii]() { call_order.push_back(ii); }, priority));
+  }
+  // Disconnect most of the handlers (compacting them), then reconnect some between the others
+  for (std::size_t ii = 0; ii < NUM_MULTI_TESTERS; ++ii) {
+    if (ii != 0 && ii != NUM_MULTI_TESTERS - 1) {
+      sigcons.at(ii).Reset();
+    }
+  }
+  sigcons.at(1) = signal.Connect([&]() { call_order.push_back(1); }, 1);
+  sigcons.at(2) = signal.Connect([&]() { call_order.push_back(2); }, 2);
+  sigcons.at(3) = signal.Connect([&]() { call_order.push_back(3); }, 0);
+  signal.Emit();
+  const std::vector<std::size_t> expected_order = {2, 0, 1, NUM_MULTI_TESTERS - 1, 3};
+  EXPECT_EQ(call_order, expected_order);
+}
+
+TEST(Signal, ResetReusedSlot)
+{
+  VoidSignal signal;
+  VoidSignalTester tester;
+  VoidSignalTester other_tester;
+  tsig::Sigcon sigcon = signal.Connect(std::ref(tester));
+  sigcon.Reset();
+  // The new connection reuses the slot, but with a new generation
+  tsig::Sigcon other_sigcon = signal.Connect(std::ref(other_tester));
+  sigcon.Reset();
+  signal.Emit("BLUE", 1, 2);
+  EXPECT_EQ(tester.NumCalls(), 0u);
+  ASSERT_EQ(other_tester.NumCalls(), 1u);
+  EXPECT_EQ(other_tester.CalledArgs(0), VoidSignalArgs("BLUE", 1, 2));
+}
+
+TEST(Signal, EmitBatch)
+{
+  tsig::Signal<void(const std::string&, int)> signal;
+  std::vector<std::string> called;
+  const tsig::Sigcon sigcon1 = signal.Connect(
+      [&](const std::string& str, int x) { called.push_back("A" + str + std::to_string(x)); });
+  const tsig::Sigcon sigcon2 = signal.Connect(
+      [&](const std::string& str, int x) { called.push_back("B" + str + std::to_string(x)); });
+  const std::vector<std::tuple<std::string, int>> batch_args = {
+      std::make_tuple("BLUE", 1), std::make_tuple("RED", 2)};
+  signal.EmitBatch(batch_args);
+  // Each handler is called over the whole batch before moving on to the next handler
+  EXPECT_EQ(called, std::vector<std::string>({"ABLUE1", "ARED2", "BBLUE1", "BRED2"}));
+  called.clear();
+  signal.EmitBatch({batch_args.data(), 0u});
+  EXPECT_TRUE(called.empty());
+}
+
+TEST(Signal, ConnectBatch)
+{
+  tsig::Signal<void(const std::string&, int)> signal;
+  std::size_t num_calls = 0u;
+  const tsig::Sigcon sigcon1 =
+      signal.Connect([&](const std::string&, int) { ++num_calls; });
+  std::vector<std::size_t> batch_sizes;
+  int total = 0;
+  tsig::Sigcon sigcon2 =
+      signal.ConnectBatch([&](const tsig::Batch<const std::string&, int>& batch) {
+        batch_sizes.push_back(batch.size());
+        for (const auto& args : batch) {
+          total += std::get<1>(args);
+        }
+      });
+  const std::vector<std::tuple<std::string, int>> batch_args = {
+      std::make_tuple("BLUE", 1), std::make_tuple("RED", 2), std::make_tuple("GREEN", 3)};
+  signal.EmitBatch(batch_args);
+  // A single emission is a batch of one
+  signal.Emit("BLUE", 4);
+  EXPECT_EQ(num_calls, 4u);
+  EXPECT_EQ(batch_sizes, std::vector<std::size_t>({3u, 1u}));
+  EXPECT_EQ(total, 10);
+  sigcon2.Reset();
+  signal.Emit("BLUE", 4);
+  signal.EmitBatch(batch_args);
+  EXPECT_EQ(num_calls, 8u);
+  EXPECT_EQ(batch_sizes.size(), 2u);
+}
+
+TEST(Signal, ConnectBatchDropped)
+{
+  tsig::Sigcon sigcon;
+  {
+    tsig::Signal<void(int)> signal;
+    sigcon = signal.ConnectBatch([](const tsig::Batch<int>&) {});
+  }
+  // The batch handlers went with the signal
+  sigcon.Reset();
+}
+
+TEST(Signal, Block)
+{
+  VoidSignal signal;
+  VoidSignalTester tester;
+  tsig::Sigcon sigcon = signal.Connect(std::ref(tester));
+  EXPECT_FALSE(sigcon.IsBlocked());
+  sigcon.Block();
+  EXPECT_TRUE(sigcon.IsBlocked());
+  signal.Emit("BLUE", 1, 2);
+  EXPECT_EQ(tester.NumCalls(), 0u);
+  sigcon.Unblock();
+  EXPECT_FALSE(sigcon.IsBlocked());
+  signal.Emit("RED", 3, 4);
+  ASSERT_EQ(tester.NumCalls(), 1u);
+  EXPECT_EQ(tester.CalledArgs(0), VoidSignalArgs("RED", 3, 4));
+  // Blocking a reset sigcon does nothing
+  sigcon.Reset();
+  sigcon.Block();
+  EXPECT_FALSE(sigcon.IsBlocked());
+}
+
+TEST(Signal, BlockConnectionOrder)
+{
+  tsig::Signal<void(void)> signal;
+  std::vector<std::size_t> call_order;
+  std::vector<tsig::Sigcon> sigcons;
+  for (std::size_t ii = 0; ii < NUM_MULTI_TESTERS; ++ii) {
+    sigcons.push_back(signal.Connect([&, ii]() { call_order.push_back(ii); }));
+  }
+  // Block the even handlers, then disconnect some to compact the handlers
+  for (std::size_t ii = 0; ii < NUM_MULTI_TESTERS; ii += 2) {
+    sigcons.at(ii).Block();
+  }
+  for (std::size_t ii = 1; ii < NUM_MULTI_TESTERS; ii += 4) {
+    sigcons.at(ii).Reset();
+  }
+  signal.Emit();
+  std::vector<std::size_t> expected_order;
+  for (std::size_t ii = 3; ii < NUM_MULTI_TESTERS; ii += 4) {
+    expected_order.push_back(ii);
+  }
+  EXPECT_EQ(call_order, expected_order);
+  // Unblocked handlers keep their place
+  for (std::size_t ii = 0; ii < NUM_MULTI_TESTERS; ii += 2) {
+    sigcons.at(ii).Unblock();
+  }
+  call_order.clear();
+  signal.Emit();
+  expected_order.clear();
+  for (std::size_t ii = 0; ii < NUM_MULTI_TESTERS; ++ii) {
+    if (ii % 4 != 1) {
+      expected_order.push_back(ii);
+    }
+  }
+  EXPECT_EQ(call_order, expected_order);
+}
+
+TEST(Signal, BlockDuringEmit)
+{
+  VoidSignal signal;
+  VoidSignalTester tester;
+  VoidSignalTester other_tester;
+  tsig::Sigcon other_sigcon;
+  tester.SetPostHandler([&]() { other_sigcon.Block(); });
+  const tsig::Sigcon sigcon = signal.Connect(std::ref(tester));
+  other_sigcon = signal.Connect(std::ref(other_tester));
+  signal.Emit("BLUE", 1, 2);
+  EXPECT_EQ(tester.NumCalls(), 1u);
+  EXPECT_EQ(other_tester.NumCalls(), 0u);
+}
+
+TEST(Signal, SigconBlocker)
+{
+  VoidSignal signal;
+  VoidSignalTester tester;
+  tsig::Sigcon sigcon = signal.Connect(std::ref(tester));
+  {
+    const tsig::SigconBlocker blocker(sigcon);
+    {
+      // Nested blockers leave the sigcon blocked until the outer one is done
+      const tsig::SigconBlocker inner_blocker(sigcon);
+    }
+    EXPECT_TRUE(sigcon.IsBlocked());
+    signal.Emit("BLUE", 1, 2);
+    EXPECT_EQ(tester.NumCalls(), 0u);
+  }
+  EXPECT_FALSE(sigcon.IsBlocked());
+  signal.Emit("RED", 3, 4);
+  ASSERT_EQ(tester.NumCalls(), 1u);
+  EXPECT_EQ(tester.CalledArgs(0), VoidSignalArgs("RED", 3, 4));
+}
+
+TEST(Signal, BlockBatch)
+{
+  tsig::Signal<void(int)> signal;
+  std::size_t num_calls = 0u;
+  tsig::Sigcon sigcon =
+      signal.ConnectBatch([&](const tsig::Batch<int>& batch) { num_calls += batch.size(); });
+  sigcon.Block();
+  signal.Emit(1);
+  EXPECT_EQ(num_calls, 0u);
+  sigcon.Unblock();
+  signal.Emit(1);
+  EXPECT_EQ(num_calls, 1u);
+}
+
+TEST(Signal, ConnectTracked)
+{
+  VoidSignal signal;
+  auto tester_ptr = std::make_shared<VoidSignalTester>();
+  const auto token_ptr = std::make_shared<int>(0);
+  VoidSignalTester* const tester_raw_ptr = tester_ptr.get();
+  signal.Connect(std::weak_ptr<VoidSignalTester>(tester_ptr),
+                 [token_ptr, tester_raw_ptr](const std::string& str, int x, int y) {
+                   (*tester_raw_ptr)(str, x, y);
+                 });
+  signal.Emit("BLUE", 1, 2);
+  ASSERT_EQ(tester_ptr->NumCalls(), 1u);
+  EXPECT_EQ(tester_ptr->CalledArgs(0), VoidSignalArgs("BLUE", 1, 2));
+  EXPECT_EQ(token_ptr.use_count(), 2);
+  tester_ptr = nullptr;
+  // The expired handler isn't called (which would crash), and is removed by the emission
+  signal.Emit("RED", 3, 4);
+  EXPECT_EQ(token_ptr.use_count(), 1);
+}
+
+TEST(Signal, ConnectTrackedSharedPtr)
+{
+  tsig::Signal<void(int)> signal;
+  auto tracked_ptr = std::make_shared<int>(0);
+  signal.Connect(tracked_ptr, [&](int x) { *tracked_ptr += x; });
+  signal.Emit(1);
+  signal.Emit(2);
+  EXPECT_EQ(*tracked_ptr, 3);
+}
+
+TEST(Signal, ConnectTrackedExpiredDuringEmit)
+{
+  tsig::Signal<void(void)> signal;
+  std::vector<std::size_t> call_order;
+  std::vector<std::shared_ptr<int>> tracked_ptrs;
+  for (std::size_t ii = 0; ii < NUM_MULTI_TESTERS; ++ii) {
+    tracked_ptrs.push_back(std::make_shared<int>(0));
+    signal.Connect(tracked_ptrs.back(), [&, ii]() {
+      call_order.push_back(ii);
+      // The first handler drops every other tracked object
+      if (ii == 0) {
+        for (std::size_t jj = 1; jj < NUM_MULTI_TESTERS; jj += 2) {
+          tracked_ptrs.at(jj) = nullptr;
+        }
+      }
+    });
+  }
+  const tsig::Sigcon sigcon = signal.Connect([&]() { call_order.push_back(NUM_MULTI_TESTERS); });
+  signal.Emit();
+  signal.Emit();
+  const std::vector<std::size_t> expected_order = {
+      0, 2, 4, 6, 8, NUM_MULTI_TESTERS, 0, 2, 4, 6, 8, NUM_MULTI_TESTERS};
+  EXPECT_EQ(call_order, expected_order);
+}
+
+TEST(Signal, ConnectTrackedBatch)
+{
+  tsig::Signal<void(int)> signal;
+  auto tracked_ptr = std::make_shared<int>(0);
+  std::size_t num_calls = 0u;
+  signal.Connect(tracked_ptr, [&](int) { ++num_calls; });
+  const std::vector<std::tuple<int>> batch_args = {std::make_tuple(1), std::make_tuple(2)};
+  signal.EmitBatch(batch_args);
+  EXPECT_EQ(num_calls, 2u);
+  tracked_ptr = nullptr;
+  signal.EmitBatch(batch_args);
+  EXPECT_EQ(num_calls, 2u);
+}
+
+TEST(SigconGroup, Reset)
+{
+  VoidSignal signal;
+  VoidSignal other_signal;
+  std::vector<VoidSignalTester> testers(NUM_MULTI_TESTERS);
+  tsig::SigconGroup sigcon_group;
+  for (std::size_t ii = 0; ii < NUM_MULTI_TESTERS; ++ii) {
+    VoidSignal& some_signal = (ii % 2 == 0) ? signal : other_signal;
+    sigcon_group.Add(some_signal.Connect(std::ref(testers.at(ii))));
+  }
+  EXPECT_EQ(sigcon_group.NumSigcons(), NUM_MULTI_TESTERS);
+  signal.Emit("BLUE", 1, 2);
+  other_signal.Emit("BLUE", 1, 2);
+  sigcon_group.Reset();
+  EXPECT_EQ(sigcon_group.NumSigcons(), 0u);
+  signal.Emit("RED", 3, 4);
+  other_signal.Emit("RED", 3, 4);
+  for (VoidSignalTester& tester : testers) {
+    ASSERT_EQ(tester.NumCalls(), 1u);
+    EXPECT_EQ(tester.CalledArgs(0), VoidSignalArgs("BLUE", 1, 2));
+  }
+}
+
+TEST(SigconGroup, Dropped)
+{
+  VoidSignal signal;
+  VoidSignalTester tester;
+  VoidSignalTester other_tester;
+  const tsig::Sigcon other_sigcon = signal.Connect(std::ref(other_tester));
+  {
+    tsig::SigconGroup sigcon_group;
+    tsig::Sigcon sigcon = signal.Connect(std::ref(tester));
+    sigcon_group.Add(std::move(sigcon));
+    // The group owns the handler now
+    sigcon.Reset();
+    signal.Emit("BLUE", 1, 2);
+  }
+  signal.Emit("RED", 3, 4);
+  EXPECT_EQ(tester.NumCalls(), 1u);
+  EXPECT_EQ(other_tester.NumCalls(), 2u);
+}
+
+TEST(SigconGroup, Move)
+{
+  VoidSignal signal;
+  VoidSignalTester tester;
+  VoidSignalTester other_tester;
+  tsig::SigconGroup sigcon_group;
+  sigcon_group.Add(signal.Connect(std::ref(tester)));
+  tsig::SigconGroup other_sigcon_group(std::move(sigcon_group));
+  EXPECT_EQ(sigcon_group.NumSigcons(), 0u);
+  EXPECT_EQ(other_sigcon_group.NumSigcons(), 1u);
+  sigcon_group.Add(signal.Connect(std::ref(other_tester)));
+  // Assigning removes the handlers the group had
+  other_sigcon_group = std::move(sigcon_group);
+  signal.Emit("BLUE", 1, 2);
+  EXPECT_EQ(tester.NumCalls(), 0u);
+  EXPECT_EQ(other_tester.NumCalls(), 1u);
+}
+
+TEST(SigconGroup, SignalDropped)
+{
+  tsig::SigconGroup sigcon_group;
+  {
+    VoidSignal signal;
+    sigcon_group.Add(signal.Connect([](const std::string&, int, int) {}));
+    sigcon_group.Add(signal.ConnectBatch([](const tsig::Batch<const std::string&, int, int>&) {}));
+  }
+  // The handlers went with the signal
+  sigcon_group.Reset();
+}
+
+TEST(SigconGroup, ResetDuringEmit)
+{
+  VoidSignal signal;
+  VoidSignalTester tester;
+  tsig::SigconGroup sigcon_group;
+  // Empty sigcons are ignored
+  sigcon_group.Add(tsig::Sigcon());
+  EXPECT_EQ(sigcon_group.NumSigcons(), 0u);
+  // The first handler removes itself and the second one
+  sigcon_group.Add(
+      signal.Connect([&](const std::string&, int, int) { sigcon_group.Reset(); }));
+  sigcon_group.Add(signal.Connect(std::ref(tester)));
+  signal.Emit("BLUE", 1, 2);
+  EXPECT_EQ(sigcon_group.NumSigcons(), 0u);
+  // Like a sigcon reset, the removed handler is still part of the in-flight emission
+  EXPECT_EQ(tester.NumCalls(), 1u);
+  // The freed slots can be reused
+  const tsig::Sigcon sigcon = signal.Connect(std::ref(tester));
+  signal.Emit("RED", 3, 4);
+  ASSERT_EQ(tester.NumCalls(), 2u);
+  EXPECT_EQ(tester.CalledArgs(1), VoidSignalArgs("RED", 3, 4));
+}
+
+TEST(MultiThreadedSignal, DropDuringEmit)
+{
+  tsig::Signal<void(const std::string&, int, int), tsig::MultiThreaded> signal;
+  std::vector<VoidSignalTester> testers(NUM_MULTI_TESTERS);
+  std::vector<tsig::Sigcon> sigcons;
+  for (std::size_t ii = 0; ii < NUM_MULTI_TESTERS; ++ii) {
+    // Each even tester is rigged to disconnect the next one
+    VoidSignalTester& tester = testers.at(ii);
+    if (ii % 2 == 0) {
+      tester.SetPostHandler([&, ii]() { sigcons.at(ii + 1).Reset(); });
+    }
+    sigcons.push_back(signal.Connect(std::ref(tester)));
+  }
+  signal.Emit("BLUE", 1, 2);
+  // Unlike a single threaded signal, a handler is never called after its disconnect returns
+  for (std::size_t ii = 0; ii < NUM_MULTI_TESTERS; ++ii) {
+    EXPECT_EQ(testers.at(ii).NumCalls(), ii % 2 == 0 ? 1u : 0u);
+  }
+}
+
+TEST(MultiThreadedSignal, DestroyDuringEmit)
+{
+  using MultiThreadedSignal = tsig::Signal<void(void), tsig::MultiThreaded>;
+  MultiThreadedSignal* signal_ptr = new MultiThreadedSignal();
+  std::size_t num_calls = 0u;
+  const tsig::Sigcon sigcon = signal_ptr->Connect([&]() {
+    ++num_calls;
+    delete signal_ptr;
+  });
+  const tsig::Sigcon other_sigcon = signal_ptr->Connect([&]() { ++num_calls; });
+  signal_ptr->Emit();
+  // Unlike disconnecting, destroying the signal doesn't stop the emission
+  EXPECT_EQ(num_calls, 2u);
+}
+
+TEST(MultiThreadedSignal, DisconnectSelf)
+{
+  tsig::Signal<void(void), tsig::MultiThreaded> signal;
+  std::size_t num_calls = 0u;
+  tsig::Sigcon sigcon;
+  sigcon = signal.Connect([&]() {
+    ++num_calls;
+    sigcon.Reset();
+  });
+  signal.Emit();
+  signal.Emit();
+  EXPECT_EQ(num_calls, 1u);
+}
+
+TEST(MultiThreadedSignal, FreeRetiredAfterEmit)
+{
+  tsig::Signal<void(void), tsig::MultiThreaded> signal;
+  const std::shared_ptr<int> token = std::make_shared<int>(0);
+  tsig::Sigcon other_sigcon;
+  const tsig::Sigcon sigcon = signal.Connect([&]() { other_sigcon.Reset(); });
+  other_sigcon = signal.Connect([token]() { ++*token; });
+  // The emission still holds the snapshot when the handler is disconnected, so it's freed
+  // when the emission leaves (rather than on some later connection)
+  signal.Emit();
+  EXPECT_EQ(*token, 0);
+  EXPECT_EQ(token.use_count(), 1);
+}
+
+TEST(MultiThreadedSignal, EmitConcurrent)
+{
+  tsig::Signal<void(int), tsig::MultiThreaded> signal;
+  std::vector<std::atomic<int>> totals(NUM_MULTI_TESTERS);
+  std::vector<tsig::Sigcon> sigcons;
+  for (std::atomic<int>& total : totals) {
+    total.store(0);
+    sigcons.push_back(signal.Connect([&total](int x) { total.fetch_add(x); }));
+  }
+  std::vector<std::thread> threads;
+  for (std::size_t ii = 0; ii < NUM_THREADS; ++ii) {
+    threads.emplace_back([&]() {
+      for (std::size_t jj = 0; jj < NUM_THREAD_EMITS; ++jj) {
+        signal.Emit(1);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  for (const std::atomic<int>& total : totals) {
+    EXPECT_EQ(total.load(), static_cast<int>(NUM_THREADS * NUM_THREAD_EMITS));
+  }
+}
+
+TEST(MultiThreadedSignal, EmitBatchConcurrent)
+{
+  tsig::Signal<void(int), tsig::MultiThreaded> signal;
+  std::atomic<int> total(0);
+  std::atomic<int> batch_total(0);
+  const tsig::Sigcon sigcon1 = signal.Connect([&](int x) { total.fetch_add(x); });
+  const std::vector<std::tuple<int>> batch_args(10u, std::make_tuple(1));
+  std::vector<std::thread> threads;
+  for (std::size_t ii = 0; ii < NUM_THREADS; ++ii) {
+    threads.emplace_back([&]() {
+      for (std::size_t jj = 0; jj < NUM_THREAD_EMITS / 10u; ++jj) {
+        signal.EmitBatch(batch_args);
+      }
+    });
+  }
+  // Connecting a batch handler while emitting is fine too
+  const tsig::Sigcon sigcon2 = signal.ConnectBatch([&](const tsig::Batch<int>& batch) {
+    batch_total.fetch_add(static_cast<int>(batch.size()));
+  });
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(total.load(), static_cast<int>(NUM_THREADS * NUM_THREAD_EMITS));
+  EXPECT_LE(batch_total.load(), total.load());
+}
+
+TEST(MultiThreadedSignal, NoCallAfterDisconnect)
+{
+  tsig::Signal<void(void), tsig::MultiThreaded> signal;
+  std::atomic<bool> done(false);
+  std::vector<std::thread> threads;
+  for (std::size_t ii = 0; ii < NUM_THREADS; ++ii) {
+    threads.emplace_back([&]() {
+      while (!done.load()) {
+        signal.Emit();
+      }
+    });
+  }
+  std::atomic<std::size_t> num_late_calls(0u);
+  for (std::size_t ii = 0; ii < NUM_THREAD_EMITS / 10; ++ii) {
+    std::atomic<bool> disconnected(false);
+    tsig::Sigcon sigcon = signal.Connect([&]() {
+      if (disconnected.load()) {
+        num_late_calls.fetch_add(1u);
+      }
+    });
+    std::this_thread::yield();
+    sigcon.Reset();
+    disconnected.store(true);
+  }
+  done.store(true);
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(num_late_calls.load(), 0u);
+}
+
+TEST(MultiThreadedSignal, SigconGroupNoCallAfterReset)
+{
+  tsig::Signal<void(void), tsig::MultiThreaded> signal;
+  std::atomic<bool> done(false);
+  std::vector<std::thread> threads;
+  for (std::size_t ii = 0; ii < NUM_THREADS; ++ii) {
+    threads.emplace_back([&]() {
+      while (!done.load()) {
+        signal.Emit();
+      }
+    });
+  }
+  std::atomic<std::size_t> num_late_calls(0u);
+  for (std::size_t ii = 0; ii < NUM_THREAD_EMITS / 100; ++ii) {
+    std::atomic<bool> disconnected(false);
+    tsig::SigconGroup sigcon_group;
+    for (std::size_t jj = 0; jj < NUM_MULTI_TESTERS; ++jj) {
+      sigcon_group.Add(signal.Connect([&]() {
+        if (disconnected.load()) {
+          num_late_calls.fetch_add(1u);
+        }
+      }));
+    }
+    std::this_thread::yield();
+    sigcon_group.Reset();
+    disconnected.store(true);
+  }
+  done.store(true);
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(num_late_calls.load(), 0u);
+}
+
+TEST(MultiThreadedSignal, BlockConcurrent)
+{
+  tsig::Signal<void(void), tsig::MultiThreaded> signal;
+  std::atomic<std::size_t> num_calls(0u);
+  tsig::Sigcon sigcon = signal.Connect([&]() { num_calls.fetch_add(1u); });
+  std::atomic<bool> done(false);
+  std::vector<std::thread> threads;
+  for (std::size_t ii = 0; ii < NUM_THREADS; ++ii) {
+    threads.emplace_back([&]() {
+      while (!done.load()) {
+        signal.Emit();
+      }
+    });
+  }
+  for (std::size_t ii = 0; ii < NUM_THREAD_EMITS; ++ii) {
+    const tsig::SigconBlocker blocker(sigcon);
+  }
+  sigcon.Block();
+  done.store(true);
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  // Once blocked (and the emissions are done), the handler isn't called again
+  const std::size_t num_blocked_calls = num_calls.load();
+  signal.Emit();
+  EXPECT_EQ(num_calls.load(), num_blocked_calls);
+}
+
+TEST(MultiThreadedSignal, ConnectTrackedConcurrent)
+{
+  using Counter = std::atomic<std::size_t>;
+  tsig::Signal<void(void), tsig::MultiThreaded> signal;
+  std::vector<std::shared_ptr<Counter>> counter_ptrs;
+  std::vector<std::weak_ptr<Counter>> counter_wptrs;
+  for (std::size_t ii = 0; ii < NUM_MULTI_TESTERS; ++ii) {
+    counter_ptrs.push_back(std::make_shared<Counter>(0u));
+    counter_wptrs.push_back(counter_ptrs.back());
+    // The raw pointer is only used while the handler keeps the counter alive
+    Counter* const counter_raw_ptr = counter_ptrs.back().get();
+    signal.Connect(counter_ptrs.back(), [counter_raw_ptr]() { counter_raw_ptr->fetch_add(1u); });
+  }
+  std::atomic<bool> done(false);
+  std::vector<std::thread> threads;
+  for (std::size_t ii = 0; ii < NUM_THREADS; ++ii) {
+    threads.emplace_back([&]() {
+      while (!done.load()) {
+        signal.Emit();
+      }
+    });
+  }
+  // Drop the counters one at a time, while the handlers are being called
+  for (std::shared_ptr<Counter>& counter_ptr : counter_ptrs) {
+    while (counter_ptr->load() < NUM_THREAD_EMITS / NUM_MULTI_TESTERS) {
+      std::this_thread::yield();
+    }
+    counter_ptr = nullptr;
+  }
+  done.store(true);
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  for (const std::weak_ptr<Counter>& counter_wptr : counter_wptrs) {
+    EXPECT_TRUE(counter_wptr.expired());
+  }
+}
+
+TEST(AtomicSnapshot, FreeRetiredWhileReadersOverlap)
+{
+  using Snapshot = tsig::detail::AtomicSnapshot<std::vector<std::size_t>>;
+  Snapshot snapshot;
+  snapshot.Stage().assign(NUM_MULTI_TESTERS, 0u);
+  snapshot.Commit();
+  std::atomic<bool> done(false);
+  std::atomic<std::size_t> num_started(0u);
+  std::atomic<std::size_t> num_torn(0u);
+  std::vector<std::thread> threads;
+  for (std::size_t ii = 0; ii < NUM_THREADS; ++ii) {
+    threads.emplace_back([&]() {
+      // Each reader registers before the last one leaves, so there's always a reader
+      std::unique_ptr<Snapshot::Reader> reader_ptr(new Snapshot::Reader(snapshot));
+      num_started.fetch_add(1u);
+      while (!done.load()) {
+        std::unique_ptr<Snapshot::Reader> next_reader_ptr(new Snapshot::Reader(snapshot));
+        const std::vector<std::size_t>& values = **next_reader_ptr;
+        if (static_cast<std::size_t>(std::count(values.begin(), values.end(), values.front()))
+            != NUM_MULTI_TESTERS) {
+          num_torn.fetch_add(1u);
+        }
+        reader_ptr = std::move(next_reader_ptr);
+      }
+    });
+  }
+  while (num_started.load() != NUM_THREADS) {
+    std::this_thread::yield();
+  }
+  for (std::size_t ii = 1; ii <= NUM_THREAD_EMITS; ++ii) {
+    snapshot.Stage().assign(NUM_MULTI_TESTERS, ii);
+    snapshot.Commit();
+  }
+  // The retired snapshots are freed while the readers still overlap
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (snapshot.NumRetired() != 0u && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::yield();
+  }
+  EXPECT_EQ(snapshot.NumRetired(), 0u);
+  done.store(true);
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(num_torn.load(), 0u);
+}
+
+TEST(ResultSignal, EmitNoConnection)
+{
+  tsig::Signal<int(int)> signal;
+  EXPECT_EQ(signal.Emit(1), 0);
+  EXPECT_FALSE(signal.EmitWith<tsig::AnyOf>(1));
+  EXPECT_TRUE(signal.EmitWith<tsig::AllOf>(1));
+}
+
+TEST(ResultSignal, EmitPriority)
+{
+  tsig::Signal<int(int)> signal;
+  const tsig::Sigcon sigcon1 = signal.Connect([](int x) { return x + 1; }, 1);
+  const tsig::Sigcon sigcon2 = signal.Connect([](int x) { return x + 2; }, 2);
+  // The last result is from the lowest priority handler
+  EXPECT_EQ(signal.Emit(1), 2);
+  EXPECT_EQ(signal.EmitWith<tsig::FirstResult>(1), 3);
+}
+
+TEST(ResultSignal, Block)
+{
+  tsig::Signal<int(int)> signal;
+  const tsig::Sigcon sigcon1 = signal.Connect([](int x) { return x + 1; });
+  tsig::Sigcon sigcon2 = signal.Connect([](int x) { return x + 2; });
+  sigcon2.Block();
+  // Blocked handlers aren't combined
+  EXPECT_EQ(signal.Emit(1), 2);
+  sigcon2.Unblock();
+  EXPECT_EQ(signal.Emit(1), 3);
+}
+
+TEST(ResultSignal, DestroyDuringEmit)
+{
+  tsig::Signal<int(int)>* signal_ptr = new tsig::Signal<int(int)>();
+  const tsig::Sigcon sigcon1 = signal_ptr->Connect([&](int x) {
+    delete signal_ptr;
+    return x + 1;
+  });
+  const tsig::Sigcon sigcon2 = signal_ptr->Connect([](int x) { return x + 2; });
+  EXPECT_EQ(signal_ptr->EmitWith<tsig::SumResults>(1), 5);
+}
+
+TEST(ResultSignal, Emit)
+{
+  tsig::Signal<int(int)> signal;
+  const tsig::Sigcon sigcon1 = signal.Connect([](int x) { return x + 1; });
+  const tsig::Sigcon sigcon2 = signal.Connect([](int x) { return x + 2; });
+  EXPECT_EQ(signal.Emit(1), 3);
+  EXPECT_EQ(signal.EmitWith<tsig::FirstResult>(1), 2);
+  EXPECT_EQ(signal.EmitWith<tsig::LastResult>(1), 3);
+  EXPECT_EQ(signal.EmitWith<tsig::SumResults>(1), 5);
+  tsig::Signal<int(int), tsig::SumResults> sum_signal;
+  const tsig::Sigcon sigcon3 = sum_signal.Connect([](int x) { return x + 1; });
+  const tsig::Sigcon sigcon4 = sum_signal.Connect([](int x) { return x + 2; });
+  EXPECT_EQ(sum_signal.Emit(1), 5);
+}
+
+TEST(ResultSignal, EmitShortCircuit)
+{
+  tsig::Signal<bool(int)> signal;
+  std::vector<int> called;
+  const tsig::Sigcon sigcon1 = signal.Connect([&](int x) {
+    called.push_back(1);
+    return x > 1;
+  });
+  const tsig::Sigcon sigcon2 = signal.Connect([&](int x) {
+    called.push_back(2);
+    return x > 2;
+  });
+  // The first result is enough to know the answer, so the second handler isn't called
+  EXPECT_TRUE(signal.EmitWith<tsig::AnyOf>(2));
+  EXPECT_EQ(called, std::vector<int>({1}));
+  called.clear();
+  EXPECT_FALSE(signal.EmitWith<tsig::AllOf>(1));
+  EXPECT_EQ(called, std::vector<int>({1}));
+  called.clear();
+  EXPECT_FALSE(signal.EmitWith<tsig::AllOf>(2));
+  EXPECT_EQ(called, std::vector<int>({1, 2}));
+  called.clear();
+  EXPECT_TRUE(signal.EmitWith<tsig::FirstResult>(2));
+  EXPECT_EQ(called, std::vector<int>({1}));
+}
+
+TEST(ResultSignal, EmitInto)
+{
+  tsig::Signal<std::string(const std::string&)> signal;
+  const tsig::Sigcon sigcon1 = signal.Connect([](const std::string& str) { return str + "1"; });
+  tsig::Sigcon sigcon2 = signal.Connect([](const std::string& str) { return str + "2"; });
+  std::vector<std::string> results;
+  EXPECT_EQ(signal.EmitInto(tsig::CollectInto(results), "BLUE"), 2u);
+  sigcon2.Reset();
+  EXPECT_EQ(signal.EmitInto(tsig::CollectInto(results), "RED"), 1u);
+  EXPECT_EQ(results, std::vector<std::string>({"BLUE1", "BLUE2", "RED1"}));
+}
+
+TEST(ResultSignal, SignalConnector)
+{
+  tsig::Signal<int(int)> signal;
+  auto signal_connector = tsig::MakeSignalConnector(signal);
+  const tsig::Sigcon sigcon = signal_connector([](int x) { return 2 * x; });
+  EXPECT_EQ(signal.Emit(2), 4);
+}
+
+TEST(ResultSignal, MultiThreaded)
+{
+  tsig::Signal<int(int), tsig::MultiThreaded, tsig::SumResults> signal;
+  std::vector<tsig::Sigcon> sigcons;
+  for (std::size_t ii = 0; ii < NUM_MULTI_TESTERS; ++ii) {
+    sigcons.push_back(signal.Connect([](int x) { return x; }));
+  }
+  std::vector<std::thread> threads;
+  std::atomic<std::size_t> num_wrong(0u);
+  for (std::size_t ii = 0; ii < NUM_THREADS; ++ii) {
+    threads.emplace_back([&]() {
+      for (std::size_t jj = 0; jj < NUM_THREAD_EMITS; ++jj) {
+        if (signal.Emit(1) != static_cast<int>(NUM_MULTI_TESTERS)) {
+          ++num_wrong;
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(num_wrong.load(), 0u);
+}
+
+namespace {
+
+// Records the message of each caught exception
+struct ErrorRecorder {
+  void operator()(std::exception_ptr error_ptr) const
+  {
+    try {
+      std::rethrow_exception(error_ptr);
+    }
+    catch (const std::exception& error) {
+      messages.push_back(error.what());
+    }
+  }
+
+  static std::vector<std::string> messages;
+};
+
+std::vector<std::string> ErrorRecorder::messages;
+
+}  // namespace
+
+TEST(SignalErrors, PropagateErrors)
+{
+  tsig::Signal<void(int)> signal;
+  std::vector<int> called;
+  const tsig::Sigcon sigcon1 = signal.Connect([&](int x) { called.push_back(x); });
+  const tsig::Sigcon sigcon2 = signal.Connect([](int) { throw std::runtime_error("BLUE"); });
+  const tsig::Sigcon sigcon3 = signal.Connect([&](int x) { called.push_back(x); });
+  EXPECT_THROW(signal.Emit(1), std::runtime_error);
+  EXPECT_EQ(called, std::vector<int>({1}));
+}
+
+TEST(SignalErrors, CatchErrors)
+{
+  ErrorRecorder::messages.clear();
+  tsig::Signal<void(int), tsig::CatchErrors<ErrorRecorder>> signal;
+  std::vector<int> called;
+  const tsig::Sigcon sigcon1 = signal.Connect([&](int x) { called.push_back(x); });
+  const tsig::Sigcon sigcon2 = signal.Connect([](int) { throw std::runtime_error("BLUE"); });
+  const tsig::Sigcon sigcon3 = signal.Connect([&](int x) { called.push_back(x); });
+  signal.Emit(1);
+  const std::vector<std::tuple<int>> batch_args = {std::make_tuple(2), std::make_tuple(3)};
+  signal.EmitBatch(batch_args);
+  EXPECT_EQ(called, std::vector<int>({1, 1, 2, 3, 2, 3}));
+  EXPECT_EQ(ErrorRecorder::messages, std::vector<std::string>({"BLUE", "BLUE", "BLUE"}));
+}
+
+TEST(SignalErrors, CatchErrorsResult)
+{
+  ErrorRecorder::messages.clear();
+  tsig::Signal<int(int), tsig::CatchErrors<ErrorRecorder>, tsig::SumResults> signal;
+  const tsig::Sigcon sigcon1 = signal.Connect([](int x) { return x; });
+  const tsig::Sigcon sigcon2 = signal.Connect([](int) -> int { throw std::runtime_error("RED"); });
+  const tsig::Sigcon sigcon3 = signal.Connect([](int x) { return 2 * x; });
+  // The result of the throwing handler is left out
+  EXPECT_EQ(signal.Emit(1), 3);
+  EXPECT_EQ(ErrorRecorder::messages, std::vector<std::string>({"RED"}));
+}
+
+namespace {
+
+// Sums the results, but refuses negative ones
+struct PositiveSum {
+  using Result = int;
+
+  bool Combine(int&& ret)
+  {
+    if (ret < 0) {
+      throw std::domain_error("NEGATIVE");
+    }
+    sum += ret;
+    return true;
+  }
+
+  Result Finish()
+  {
+    return sum;
+  }
+
+  int sum = 0;
+};
+
+}  // namespace
+
+TEST(SignalErrors, PropagateErrorsCombiner)
+{
+  tsig::Signal<int(int)> signal;
+  std::vector<int> called;
+  const tsig::Sigcon sigcon1 = signal.Connect([](int x) { return -x; });
+  const tsig::Sigcon sigcon2 = signal.Connect([&](int x) {
+    called.push_back(x);
+    return x;
+  });
+  EXPECT_THROW(signal.EmitInto(PositiveSum(), 1), std::domain_error);
+  EXPECT_TRUE(called.empty());
+}
+
+TEST(SignalErrors, CatchErrorsCombiner)
+{
+  ErrorRecorder::messages.clear();
+  tsig::Signal<int(int), tsig::CatchErrors<ErrorRecorder>> signal;
+  const tsig::Sigcon sigcon1 = signal.Connect([](int x) { return x; });
+  const tsig::Sigcon sigcon2 = signal.Connect([](int) -> int { throw std::runtime_error("RED"); });
+  const tsig::Sigcon sigcon3 = signal.Connect([](int x) { return -x; });
+  // Only errors from the handlers are caught, errors from the combiner are passed on
+  EXPECT_THROW(signal.EmitInto(PositiveSum(), 1), std::domain_error);
+  EXPECT_EQ(ErrorRecorder::messages, std::vector<std::string>({"RED"}));
+}
+
+TEST(SignalErrors, TerminateOnError)
+{
+  tsig::Signal<void(int), tsig::TerminateOnError> signal;
+  int total = 0;
+  const tsig::Sigcon sigcon1 = signal.Connect([&](int x) { total += x; });
+  signal.Emit(1);
+  EXPECT_EQ(total, 1);
+  const tsig::Sigcon sigcon2 = signal.Connect([](int) { throw std::runtime_error("GREEN"); });
+  EXPECT_DEATH(signal.Emit(1), "");
+}
+
+TEST(SignalErrors, TerminateOnErrorCombiner)
+{
+  tsig::Signal<int(int), tsig::TerminateOnError> signal;
+  const tsig::Sigcon sigcon1 = signal.Connect([](int x) { return x; });
+  EXPECT_EQ(signal.EmitInto(PositiveSum(), 1), 1);
+  // Emitting is noexcept, so errors from the combiner terminate too
+  const tsig::Sigcon sigcon2 = signal.Connect([](int x) { return -x; });
+  EXPECT_DEATH(signal.EmitInto(PositiveSum(), 1), "");
+}
+
+namespace {
+
+// Counts the bytes it has allocated and not yet deallocated
+template <typename T>
+class CountingAllocator {
+ public:
+  using value_type = T;
+
+  CountingAllocator() = default;
+  explicit CountingAllocator(std::size_t* num_bytes_ptr) : num_bytes_ptr_(num_bytes_ptr) {}
+  template <typename U>
+  CountingAllocator(const CountingAllocator<U>& allocator)
+      : num_bytes_ptr_(allocator.num_bytes_ptr_)
+  {
+    // Do nothing
+  }
+
+  T* allocate(std::size_t num_objects)
+  {
+    if (num_bytes_ptr_) {
+      *num_bytes_ptr_ += num_objects * sizeof(T);
+    }
+    return std::allocator<T>().allocate(num_objects);
+  }
+
+  void deallocate(T* ptr, std::size_t num_objects)
+  {
+    if (num_bytes_ptr_) {
+      *num_bytes_ptr_ -= num_objects * sizeof(T);
+    }
+    std::allocator<T>().deallocate(ptr, num_objects);
+  }
+
+  template <typename U>
+  bool operator==(const CountingAllocator<U>& allocator) const
+  {
+    return num_bytes_ptr_ == allocator.num_bytes_ptr_;
+  }
+
+  template <typename U>
+  bool operator!=(const CountingAllocator<U>& allocator) const
+  {
+    return num_bytes_ptr_ != allocator.num_bytes_ptr_;
+  }
+
+  std::size_t* num_bytes_ptr_ = nullptr;
+};
+
+}  // namespace
+
+TEST(SignalAllocator, AllocateWith)
+{
+  using Allocation = tsig::AllocateWith<CountingAllocator<char>>;
+  std::size_t num_bytes = 0u;
+  const CountingAllocator<char> allocator(&num_bytes);
+  {
+    tsig::Signal<void(int), Allocation> signal(allocator);
+    // The signal data is allocated up front
+    const std::size_t num_idle_bytes = num_bytes;
+    EXPECT_GT(num_idle_bytes, 0u);
+    int total = 0;
+    tsig::Sigcon sigcon1 = signal.Connect([&total](int x) { total += x; });
+    const tsig::Sigcon sigcon2 = signal.ConnectBatch(
+        [&total](const tsig::Batch<int>& batch) { total += static_cast<int>(batch.size()); });
+    EXPECT_GT(num_bytes, num_idle_bytes);
+    signal.Emit(1);
+    EXPECT_EQ(total, 2);
+    sigcon1.Reset();
+    signal.Emit(1);
+    EXPECT_EQ(total, 3);
+  }
+  EXPECT_EQ(num_bytes, 0u);
+}
+
+TEST(SignalAllocator, AllocateWithMultiThreaded)
+{
+  using Allocation = tsig::AllocateWith<CountingAllocator<char>>;
+  std::size_t num_bytes = 0u;
+  const CountingAllocator<char> allocator(&num_bytes);
+  {
+    tsig::Signal<int(int), tsig::MultiThreaded, Allocation> signal(allocator);
+    const std::size_t num_idle_bytes = num_bytes;
+    const tsig::Sigcon sigcon1 = signal.Connect([](int x) { return x; });
+    tsig::Sigcon sigcon2 = signal.Connect([](int x) { return 2 * x; });
+    EXPECT_GT(num_bytes, num_idle_bytes);
+    EXPECT_EQ(signal.Emit(1), 2);
+    sigcon2.Reset();
+    EXPECT_EQ(signal.Emit(1), 1);
+  }
+  EXPECT_EQ(num_bytes, 0u);
+}
+
+TEST(SignalAllocator, BlockNoAllocation)
+{
+  using Allocation = tsig::AllocateWith<CountingAllocator<char>>;
+  std::size_t num_bytes = 0u;
+  const CountingAllocator<char> allocator(&num_bytes);
+  {
+    tsig::Signal<void(int), Allocation> signal(allocator);
+    std::vector<tsig::Sigcon> sigcons;
+    for (std::size_t ii = 0; ii < NUM_MULTI_TESTERS; ++ii) {
+      sigcons.push_back(signal.Connect([](int) {}));
+    }
+    // Blocking and unblocking doesn't copy the handlers
+    const std::size_t num_connected_bytes = num_bytes;
+    for (tsig::Sigcon& sigcon : sigcons) {
+      sigcon.Block();
+    }
+    signal.Emit(1);
+    for (tsig::Sigcon& sigcon : sigcons) {
+      sigcon.Unblock();
+    }
+    EXPECT_EQ(num_bytes, num_connected_bytes);
+  }
+  EXPECT_EQ(num_bytes, 0u);
+}
+
 TEST(SignalConnector, Construct)
 {
   VoidSignal signal;
@@ -359,6 +1522,17 @@ TEST(SignalConnector, ConnectHandlerMove)
   EXPECT_EQ(wrapper.MoveCount(), 2u);
 }
 
+TEST(SignalConnector, ConnectPriority)
+{
+  tsig::Signal<void(void)> signal;
+  auto connector = tsig::MakeSignalConnector(signal);
+  std::vector<int> call_order;
+  const tsig::Sigcon sigcon1 = connector.Connect([&]() { call_order.push_back(1); });
+  const tsig::Sigcon sigcon2 = connector.Connect([&]() { call_order.push_back(2); }, 1);
+  signal.Emit();
+  EXPECT_EQ(call_order, std::vector<int>({2, 1}));
+}
+
 TEST(SignalConnector, MakeSignalConnector)
 {
   VoidSignal signal;
@@ -0,0 +1,77 @@
+// Copyright (c) 2021 Tim Perkins
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <tsig/static_signal.hpp>
+
+namespace {
+
+struct Counter {
+  void operator()(const std::string&, int x)
+  {
+    total += x;
+  }
+
+  int total = 0;
+};
+
+struct Recorder {
+  void operator()(const std::string& str, int x)
+  {
+    called_ptr->push_back(str + std::to_string(x));
+  }
+
+  std::vector<std::string>* called_ptr;
+};
+
+}  // namespace
+
+TEST(StaticSignal, Construct)
+{
+  tsig::StaticSignal<void(int)> signal;
+  signal.Emit(1);
+  tsig::StaticSignal<void(const std::string&, int), Counter> counter_signal;
+  EXPECT_EQ(counter_signal.GetHandler<0>().total, 0);
+}
+
+TEST(StaticSignal, Emit)
+{
+  tsig::StaticSignal<void(const std::string&, int), Counter, Counter> signal;
+  signal.Emit("BLUE", 1);
+  signal.Emit("RED", 2);
+  EXPECT_EQ(signal.GetHandler<0>().total, 3);
+  EXPECT_EQ(signal.GetHandler<1>().total, 3);
+}
+
+TEST(StaticSignal, EmitOrder)
+{
+  std::vector<std::string> called;
+  auto signal = tsig::MakeStaticSignal<void(const std::string&, int)>(
+      [&](const std::string& str, int x) { called.push_back("A" + str + std::to_string(x)); },
+      Recorder{&called},
+      [&](const std::string& str, int x) { called.push_back("B" + str + std::to_string(x)); });
+  signal.Emit("BLUE", 1);
+  EXPECT_EQ(called, std::vector<std::string>({"ABLUE1", "BLUE1", "BBLUE1"}));
+}
+
+TEST(StaticSignal, EmitBatch)
+{
+  std::vector<std::string> called;
+  auto signal = tsig::MakeStaticSignal<void(const std::string&, int)>(
+      [&](const std::string& str, int x) { called.push_back("A" + str + std::to_string(x)); },
+      [&](const std::string& str, int x) { called.push_back("B" + str + std::to_string(x)); });
+  const std::vector<std::tuple<std::string, int>> batch_args = {std::make_tuple("BLUE", 1),
+                                                                std::make_tuple("RED", 2)};
+  signal.EmitBatch(batch_args);
+  EXPECT_EQ(called, std::vector<std::string>({"ABLUE1", "ARED2", "BBLUE1", "BRED2"}));
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
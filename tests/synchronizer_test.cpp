@@ -0,0 +1,296 @@
+// Copyright (c) 2021 Tim Perkins
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <vector>
+
+#include <tsig/signal.hpp>
+#include <tsig/tn/node.hpp>
+#include <tsig/tn/synchronizer.hpp>
+
+// GCC sees the replaced delete inlined but not the replaced new, and thinks they don't match
+#if defined(__GNUC__) && !defined(__clang__) && (__GNUC__ >= 11)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+namespace {
+
+std::size_t num_allocations = 0u;
+
+}  // namespace
+
+void* operator new(std::size_t size)
+{
+  ++num_allocations;
+  void* const ptr = std::malloc(size != 0u ? size : 1u);
+  if (!ptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+struct Scan {
+  int stamp;
+  int value;
+};
+
+struct Frame {
+  std::size_t seq;
+  std::vector<int> data;
+};
+
+struct TimedScan {
+  std::chrono::steady_clock::time_point stamp;
+};
+
+// Frames are stamped by their sequence number
+struct SeqOf {
+  std::size_t operator()(const Frame& frame) const
+  {
+    return frame.seq;
+  }
+};
+
+using ScanPair = std::pair<int, int>;
+
+template <typename Policy>
+class ScanPairTask {
+ public:
+  explicit ScanPairTask(const Policy& policy = Policy())
+      : sync_([this](const Scan& scan_a, const Scan& scan_b) { OnScans_(scan_a, scan_b); },
+              policy)
+  {
+    // Do nothing
+  }
+
+  tsig::tn::DataHandlerTuple<Scan, Scan> GetHandlers()
+  {
+    return sync_.GetHandlers();
+  }
+
+  const tsig::tn::Synchronizer<Policy, Scan, Scan>& GetSync() const
+  {
+    return sync_;
+  }
+
+  const std::vector<ScanPair>& GetStampPairs() const
+  {
+    return stamp_pairs_;
+  }
+
+ private:
+  void OnScans_(const Scan& scan_a, const Scan& scan_b)
+  {
+    stamp_pairs_.emplace_back(scan_a.stamp, scan_b.stamp);
+  }
+
+  tsig::tn::Synchronizer<Policy, Scan, Scan> sync_;
+  std::vector<ScanPair> stamp_pairs_;
+};
+
+using ExactScanPairTask = ScanPairTask<tsig::tn::ExactTime<>>;
+using ApproximateScanPairTask = ScanPairTask<tsig::tn::ApproximateTime<int>>;
+
+TEST(Synchronizer, ExactTime)
+{
+  ExactScanPairTask task;
+  auto handlers = task.GetHandlers();
+  std::get<0>(handlers)(Scan{1, 0});
+  std::get<0>(handlers)(Scan{2, 0});
+  std::get<1>(handlers)(Scan{2, 0});
+  std::get<1>(handlers)(Scan{3, 0});
+  std::get<1>(handlers)(Scan{4, 0});
+  std::get<0>(handlers)(Scan{4, 0});
+  const std::vector<ScanPair> expected_stamp_pairs = {{2, 2}, {4, 4}};
+  EXPECT_EQ(task.GetStampPairs(), expected_stamp_pairs);
+  EXPECT_EQ(task.GetSync().NumMatched(), 2u);
+  // The scans with stamps 1 and 3 were never matched
+  EXPECT_EQ(task.GetSync().NumDropped(), 2u);
+}
+
+TEST(Synchronizer, ExactTimeQueueFull)
+{
+  ExactScanPairTask task;
+  auto handlers = task.GetHandlers();
+  const int num_scans = static_cast<int>(tsig::tn::DEFAULT_SYNC_QUEUE_SIZE) + 2;
+  for (int ii = 0; ii < num_scans; ++ii) {
+    std::get<0>(handlers)(Scan{ii, 0});
+  }
+  EXPECT_EQ(task.GetSync().NumDropped(), 2u);
+  // The first two scans were pushed out of the queue
+  std::get<1>(handlers)(Scan{0, 0});
+  std::get<1>(handlers)(Scan{2, 0});
+  const std::vector<ScanPair> expected_stamp_pairs = {{2, 2}};
+  EXPECT_EQ(task.GetStampPairs(), expected_stamp_pairs);
+  EXPECT_EQ(task.GetSync().NumDropped(), 3u);
+}
+
+TEST(Synchronizer, ApproximateTime)
+{
+  ApproximateScanPairTask task(tsig::tn::ApproximateTime<int>(2));
+  auto handlers = task.GetHandlers();
+  std::get<0>(handlers)(Scan{10, 0});
+  std::get<1>(handlers)(Scan{5, 0});
+  std::get<1>(handlers)(Scan{9, 0});
+  std::get<0>(handlers)(Scan{20, 0});
+  std::get<1>(handlers)(Scan{21, 0});
+  std::get<0>(handlers)(Scan{30, 0});
+  std::get<1>(handlers)(Scan{40, 0});
+  // The scan with stamp 5 is skipped for the closer scan with stamp 9
+  const std::vector<ScanPair> expected_stamp_pairs = {{10, 9}, {20, 21}};
+  EXPECT_EQ(task.GetStampPairs(), expected_stamp_pairs);
+  EXPECT_EQ(task.GetSync().NumMatched(), 2u);
+  // The scans with stamps 5 and 30 are dropped, and 40 is still waiting
+  EXPECT_EQ(task.GetSync().NumDropped(), 2u);
+}
+
+TEST(Synchronizer, ApproximateTimeChrono)
+{
+  using Policy = tsig::tn::ApproximateTime<std::chrono::milliseconds>;
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<std::chrono::milliseconds> offsets;
+  tsig::tn::Synchronizer<Policy, TimedScan, TimedScan> sync(
+      [&](const TimedScan& scan_a, const TimedScan& scan_b) {
+        offsets.push_back(
+            std::chrono::duration_cast<std::chrono::milliseconds>(scan_b.stamp - scan_a.stamp));
+      },
+      Policy(std::chrono::milliseconds(5)));
+  sync.Handle<0>(TimedScan{start});
+  sync.Handle<1>(TimedScan{start + std::chrono::milliseconds(3)});
+  sync.Handle<0>(TimedScan{start + std::chrono::milliseconds(100)});
+  sync.Handle<1>(TimedScan{start + std::chrono::milliseconds(110)});
+  const std::vector<std::chrono::milliseconds> expected_offsets = {std::chrono::milliseconds(3)};
+  EXPECT_EQ(offsets, expected_offsets);
+}
+
+TEST(Synchronizer, StampOf)
+{
+  using Policy = tsig::tn::ExactTime<4u, SeqOf>;
+  std::vector<std::size_t> seqs;
+  tsig::tn::Synchronizer<Policy, Frame, Frame, Frame> sync(
+      [&](const Frame& frame_a, const Frame& frame_b, const Frame& frame_c) {
+        EXPECT_EQ(frame_a.seq, frame_b.seq);
+        EXPECT_EQ(frame_a.seq, frame_c.seq);
+        seqs.push_back(frame_a.seq);
+      });
+  for (std::size_t ii = 0; ii < 3u; ++ii) {
+    sync.Handle<2>(Frame{ii, {}});
+    sync.Handle<1>(Frame{ii, {}});
+    sync.Handle<0>(Frame{ii, {}});
+  }
+  const std::vector<std::size_t> expected_seqs = {0u, 1u, 2u};
+  EXPECT_EQ(seqs, expected_seqs);
+}
+
+TEST(Synchronizer, SharedReleased)
+{
+  using SharedScan = tsig::tn::Shared<Scan>;
+  std::size_t num_matched = 0u;
+  tsig::tn::Synchronizer<tsig::tn::ExactTime<>, SharedScan, SharedScan> sync(
+      [&](const std::shared_ptr<const Scan>& scan_a_ptr,
+          const std::shared_ptr<const Scan>& scan_b_ptr) {
+        EXPECT_EQ(scan_a_ptr->value, 1);
+        EXPECT_EQ(scan_b_ptr->value, 2);
+        ++num_matched;
+      });
+  std::shared_ptr<const Scan> old_scan_ptr = std::make_shared<const Scan>(Scan{1, 0});
+  std::shared_ptr<const Scan> scan_a_ptr = std::make_shared<const Scan>(Scan{2, 1});
+  std::shared_ptr<const Scan> scan_b_ptr = std::make_shared<const Scan>(Scan{2, 2});
+  sync.Handle<0>(old_scan_ptr);
+  sync.Handle<0>(scan_a_ptr);
+  EXPECT_EQ(scan_a_ptr.use_count(), 2);
+  sync.Handle<1>(scan_b_ptr);
+  EXPECT_EQ(num_matched, 1u);
+  // Neither matched nor dropped data is kept
+  EXPECT_EQ(old_scan_ptr.use_count(), 1);
+  EXPECT_EQ(scan_a_ptr.use_count(), 1);
+  EXPECT_EQ(scan_b_ptr.use_count(), 1);
+}
+
+TEST(Synchronizer, Latest)
+{
+  std::vector<ScanPair> value_pairs;
+  tsig::tn::Synchronizer<tsig::tn::Latest, Scan, Scan> sync(
+      [&](const Scan& scan_a, const Scan& scan_b) {
+        value_pairs.emplace_back(scan_a.value, scan_b.value);
+      });
+  sync.Handle<0>(Scan{0, 1});
+  sync.Handle<0>(Scan{0, 2});
+  sync.Handle<1>(Scan{0, 3});
+  sync.Handle<1>(Scan{0, 4});
+  sync.Handle<0>(Scan{0, 5});
+  const std::vector<ScanPair> expected_value_pairs = {{2, 3}, {2, 4}, {5, 4}};
+  EXPECT_EQ(value_pairs, expected_value_pairs);
+  EXPECT_EQ(sync.NumMatched(), 3u);
+  EXPECT_EQ(sync.NumDropped(), 1u);
+}
+
+TEST(Synchronizer, Node)
+{
+  using ScanPairNode =
+      tsig::tn::Node<tsig::tn::WithInputs<Scan, Scan>, tsig::tn::WithoutOutputs>;
+  ExactScanPairTask task;
+  ScanPairNode node;
+  tsig::tn::DataHandlerTuple<Scan, Scan> handlers = task.GetHandlers();
+  node.RegisterHandler<0>(std::get<0>(handlers));
+  node.RegisterHandler<1>(std::get<1>(handlers));
+  tsig::Signal<void(const Scan&)> source_a;
+  tsig::Signal<void(const Scan&)> source_b;
+  node.Accept<0>(source_a);
+  node.Accept<1>(source_b);
+  for (int ii = 0; ii < 100; ++ii) {
+    source_a.Emit(Scan{ii, 0});
+    if (ii % 2 == 0) {
+      source_b.Emit(Scan{ii, 0});
+    }
+  }
+  EXPECT_EQ(task.GetSync().NumMatched(), 50u);
+  // The last odd scan is still waiting
+  EXPECT_EQ(task.GetSync().NumDropped(), 49u);
+}
+
+TEST(Synchronizer, NoAllocation)
+{
+  using Policy = tsig::tn::ExactTime<4u, SeqOf>;
+  std::size_t num_matched = 0u;
+  tsig::tn::Synchronizer<Policy, Frame, Frame> sync(
+      [&](const Frame&, const Frame&) { ++num_matched; });
+  Frame frame{0u, std::vector<int>(1000u, 0)};
+  // Fill the queues once, so the frames in them have room for the data
+  for (std::size_t ii = 0; ii < 4u; ++ii) {
+    frame.seq = ii;
+    sync.Handle<0>(frame);
+    sync.Handle<1>(frame);
+  }
+  const std::size_t start_num_allocations = num_allocations;
+  for (std::size_t ii = 4u; ii < 1004u; ++ii) {
+    frame.seq = ii;
+    sync.Handle<0>(frame);
+    if (ii % 3u != 0u) {
+      sync.Handle<1>(frame);
+    }
+  }
+  EXPECT_EQ(num_allocations, start_num_allocations);
+  EXPECT_EQ(num_matched, 4u + 667u);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,268 @@
+// Copyright (c) 2021 Tim Perkins
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// “Software”), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TSIG_COALESCING_SIGNAL_HPP
+#define TSIG_COALESCING_SIGNAL_HPP
+
+#include <tsig/signal.hpp>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+#if defined(__GNUC__) && (__GNUC__ >= 4)
+#define TSIG_CHECK_RESULT __attribute__((warn_unused_result))
+#elif defined(_MSC_VER) && (_MSC_VER >= 1700)
+#define TSIG_CHECK_RESULT _Check_return_
+#else
+#define TSIG_CHECK_RESULT
+#endif
+
+namespace tsig {
+namespace detail {
+
+template <typename T, typename... Policies>
+class CoalescingSigdat;
+
+}  // namespace detail
+
+// A signal which only keeps the latest value, and calls the handlers with it when flushed, so a
+// fast producer costs as many handler calls as the consumer has flushes (the value type must be
+// default constructible). With a dispatcher, the first emission after each flush queues a flush,
+// and any emissions made before the dispatcher runs it are coalesced.
+template <typename T, typename... Policies>
+class CoalescingSignal
+    : private detail::SelectPolicy<detail::DispatchPolicyKind, DirectDispatch,
+                                   Policies...>::type {
+ public:
+  using HandlerPolicy =
+      typename detail::SelectPolicy<detail::HandlerPolicyKind, FunctionHandlers, Policies...>::type;
+  using DispatchPolicy =
+      typename detail::SelectPolicy<detail::DispatchPolicyKind, DirectDispatch, Policies...>::type;
+  using Handler = typename HandlerPolicy::template Handler<void(const T&)>;
+
+  CoalescingSignal();
+  template <typename Dispatcher, typename = typename std::enable_if<
+                                     !std::is_same<Dispatcher, CoalescingSignal>::value>::type>
+  explicit CoalescingSignal(Dispatcher& dispatcher);
+  CoalescingSignal(const CoalescingSignal&) = delete;
+  CoalescingSignal(CoalescingSignal&& signal) = default;
+
+  CoalescingSignal& operator=(const CoalescingSignal&) = delete;
+  CoalescingSignal& operator=(CoalescingSignal&& signal) = default;
+
+  TSIG_CHECK_RESULT Sigcon Connect(const Handler& handler,
+                                   int priority = DEFAULT_HANDLER_PRIORITY);
+  TSIG_CHECK_RESULT Sigcon Connect(Handler&& handler, int priority = DEFAULT_HANDLER_PRIORITY);
+  // Assigns over the pending value, so emitting doesn't allocate (unless assigning does)
+  void Emit(const T& value);
+  void Emit(T&& value);
+  // Calls the handlers with the pending value, returning false if there wasn't one (only one
+  // thread may flush at a time, and flushing from a handler does nothing)
+  bool Flush();
+  bool IsPending() const;
+
+ private:
+  using CoalescingSigdatType = detail::CoalescingSigdat<T, Policies...>;
+
+  const std::shared_ptr<CoalescingSigdatType>& GetCoalescingSigdat_();
+  void ScheduleFlush_(std::true_type /* direct */);
+  void ScheduleFlush_(std::false_type /* direct */);
+
+  // Allocated up front, since emitting always needs somewhere to keep the value
+  std::shared_ptr<CoalescingSigdatType> coalescing_sigdat_ptr_;
+};
+
+namespace detail {
+
+// Keeps the pending value, next to the handlers
+template <typename T, typename... Policies>
+class CoalescingSigdat {
+ public:
+  using SigdatType = Sigdat<void(const T&), Policies...>;
+  using ThreadingPolicy =
+      typename SelectPolicy<ThreadingPolicyKind, SingleThreaded, Policies...>::type;
+
+  // Returns true if there was no pending value, so a flush is due
+  template <typename Value>
+  bool Store(Value&& value);
+  // Flushes the pending value (named like a sigdat, so it can be dispatched like an emission)
+  bool CallHandlers();
+  bool IsPending();
+
+  SigdatType sigdat;
+
+ private:
+  // Guards the pending value (does nothing if single threaded)
+  typename ThreadingPolicy::Mutex mutex_;
+  // Flushing swaps the values, so once they're big enough neither one reallocates
+  T pending_value_;
+  T flushing_value_;
+  bool pending_ = false;
+  std::atomic<bool> flushing_{false};
+};
+
+}  // namespace detail
+
+template <typename T, typename... Policies>
+CoalescingSignal<T, Policies...>::CoalescingSignal()
+    : coalescing_sigdat_ptr_(std::make_shared<CoalescingSigdatType>())
+{
+  // Do nothing
+}
+
+template <typename T, typename... Policies>
+template <typename Dispatcher, typename>
+CoalescingSignal<T, Policies...>::CoalescingSignal(Dispatcher& dispatcher)
+    : DispatchPolicy(dispatcher), coalescing_sigdat_ptr_(std::make_shared<CoalescingSigdatType>())
+{
+  // Do nothing
+}
+
+template <typename T, typename... Policies>
+Sigcon CoalescingSignal<T, Policies...>::Connect(const Handler& handler, int priority)
+{
+  return Connect(Handler(handler), priority);
+}
+
+template <typename T, typename... Policies>
+Sigcon CoalescingSignal<T, Policies...>::Connect(Handler&& handler, int priority)
+{
+  const std::shared_ptr<CoalescingSigdatType>& coalescing_sigdat_ptr = GetCoalescingSigdat_();
+  // The sigdat shares ownership with the rest of the coalescing data
+  const std::shared_ptr<typename CoalescingSigdatType::SigdatType> sigdat_ptr(
+      coalescing_sigdat_ptr, &coalescing_sigdat_ptr->sigdat);
+  const std::size_t handler_id = sigdat_ptr->AddHandler(std::move(handler), priority);
+  return Sigcon(sigdat_ptr, handler_id);
+}
+
+template <typename T, typename... Policies>
+void CoalescingSignal<T, Policies...>::Emit(const T& value)
+{
+  if (GetCoalescingSigdat_()->Store(value)) {
+    ScheduleFlush_(std::is_same<DispatchPolicy, DirectDispatch>());
+  }
+}
+
+template <typename T, typename... Policies>
+void CoalescingSignal<T, Policies...>::Emit(T&& value)
+{
+  if (GetCoalescingSigdat_()->Store(std::move(value))) {
+    ScheduleFlush_(std::is_same<DispatchPolicy, DirectDispatch>());
+  }
+}
+
+template <typename T, typename... Policies>
+bool CoalescingSignal<T, Policies...>::Flush()
+{
+  // Nothing was ever emitted (e.g., moved from)
+  if (!coalescing_sigdat_ptr_) {
+    return false;
+  }
+  return coalescing_sigdat_ptr_->CallHandlers();
+}
+
+template <typename T, typename... Policies>
+bool CoalescingSignal<T, Policies...>::IsPending() const
+{
+  return coalescing_sigdat_ptr_ && coalescing_sigdat_ptr_->IsPending();
+}
+
+template <typename T, typename... Policies>
+const std::shared_ptr<typename CoalescingSignal<T, Policies...>::CoalescingSigdatType>&
+CoalescingSignal<T, Policies...>::GetCoalescingSigdat_()
+{
+  if (!coalescing_sigdat_ptr_) {
+    coalescing_sigdat_ptr_ = std::make_shared<CoalescingSigdatType>();
+  }
+  return coalescing_sigdat_ptr_;
+}
+
+template <typename T, typename... Policies>
+void CoalescingSignal<T, Policies...>::ScheduleFlush_(std::true_type /* direct */)
+{
+  // Without a dispatcher, the owner flushes explicitly
+}
+
+template <typename T, typename... Policies>
+void CoalescingSignal<T, Policies...>::ScheduleFlush_(std::false_type /* direct */)
+{
+  // The queued flush holds the data weakly, so it's dropped if the signal is destroyed first
+  DispatchPolicy::Emit(coalescing_sigdat_ptr_);
+}
+
+namespace detail {
+
+template <typename T, typename... Policies>
+template <typename Value>
+bool CoalescingSigdat<T, Policies...>::Store(Value&& value)
+{
+  std::lock_guard<typename ThreadingPolicy::Mutex> lock(mutex_);
+  pending_value_ = std::forward<Value>(value);
+  const bool was_pending = pending_;
+  pending_ = true;
+  return !was_pending;
+}
+
+template <typename T, typename... Policies>
+bool CoalescingSigdat<T, Policies...>::CallHandlers()
+{
+  if (flushing_.exchange(true)) {
+    return false;
+  }
+  struct FlushGuard {
+    ~FlushGuard()
+    {
+      flushing.store(false);
+    }
+
+    std::atomic<bool>& flushing;
+  } flush_guard{flushing_};
+  {
+    std::lock_guard<typename ThreadingPolicy::Mutex> lock(mutex_);
+    if (!pending_) {
+      return false;
+    }
+    // Producers can keep emitting into the other value while the handlers are called
+    using std::swap;
+    swap(pending_value_, flushing_value_);
+    pending_ = false;
+  }
+  sigdat.CallHandlers(flushing_value_);
+  return true;
+}
+
+template <typename T, typename... Policies>
+bool CoalescingSigdat<T, Policies...>::IsPending()
+{
+  std::lock_guard<typename ThreadingPolicy::Mutex> lock(mutex_);
+  return pending_;
+}
+
+}  // namespace detail
+}  // namespace tsig
+
+#undef TSIG_CHECK_RESULT
+
+#endif  // TSIG_COALESCING_SIGNAL_HPP
@@ -0,0 +1,124 @@
+// Copyright (c) 2021 Tim Perkins
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// “Software”), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TSIG_CORO_HPP
+#define TSIG_CORO_HPP
+
+#if __cplusplus < 202002L
+#error "Awaiting signals needs C++20 coroutines"
+#endif
+
+#include <tsig/signal.hpp>
+
+#include <coroutine>
+#include <memory>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+
+namespace tsig {
+namespace detail {
+
+// Suspends the awaiting coroutine until the next emission, then resumes it with a copy of the
+// arguments (on the emitting thread). The waiter lives in the coroutine frame, so waiting doesn't
+// allocate. A coroutine waiting on a dropped signal is never resumed.
+template <typename SigdatType, typename... Param>
+class NextAwaiter final : private EmitWaiter<Param...> {
+ public:
+  using Args = std::tuple<std::decay_t<Param>...>;
+
+  explicit NextAwaiter(const std::shared_ptr<SigdatType>& sigdat_ptr);
+  NextAwaiter(const NextAwaiter&) = delete;
+  ~NextAwaiter();
+
+  NextAwaiter& operator=(const NextAwaiter&) = delete;
+
+  bool await_ready() const noexcept;
+  void await_suspend(std::coroutine_handle<> handle);
+  Args await_resume();
+
+ private:
+  void Wake(const std::decay_t<Param>&... param) final;
+
+  // Keeps the waiter list alive while waiting, even if the signal is dropped
+  std::shared_ptr<SigdatType> sigdat_ptr_;
+  std::coroutine_handle<> handle_;
+  std::optional<Args> args_;
+};
+
+}  // namespace detail
+
+template <typename... Param, typename... Policies>
+detail::NextAwaiter<detail::Sigdat<void(Param...), Policies...>, Param...>
+Signal<void(Param...), Policies...>::Next()
+{
+  return detail::NextAwaiter<SigdatType, Param...>(GetSigdat_());
+}
+
+namespace detail {
+
+template <typename SigdatType, typename... Param>
+NextAwaiter<SigdatType, Param...>::NextAwaiter(const std::shared_ptr<SigdatType>& sigdat_ptr)
+    : sigdat_ptr_(sigdat_ptr)
+{
+  // Do nothing
+}
+
+template <typename SigdatType, typename... Param>
+NextAwaiter<SigdatType, Param...>::~NextAwaiter()
+{
+  // The coroutine was destroyed while waiting
+  sigdat_ptr_->RemoveWaiter(this);
+}
+
+template <typename SigdatType, typename... Param>
+bool NextAwaiter<SigdatType, Param...>::await_ready() const noexcept
+{
+  return false;
+}
+
+template <typename SigdatType, typename... Param>
+void NextAwaiter<SigdatType, Param...>::await_suspend(std::coroutine_handle<> handle)
+{
+  handle_ = handle;
+  // Another thread can resume the coroutine as soon as it's added, so do nothing after
+  sigdat_ptr_->AddWaiter(this);
+}
+
+template <typename SigdatType, typename... Param>
+typename NextAwaiter<SigdatType, Param...>::Args NextAwaiter<SigdatType, Param...>::await_resume()
+{
+  return std::move(*args_);
+}
+
+template <typename SigdatType, typename... Param>
+void NextAwaiter<SigdatType, Param...>::Wake(const std::decay_t<Param>&... param)
+{
+  args_.emplace(param...);
+  // Resuming may destroy the awaiter, so do nothing after
+  handle_.resume();
+}
+
+}  // namespace detail
+}  // namespace tsig
+
+#endif  // TSIG_CORO_HPP
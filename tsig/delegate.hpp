@@ -0,0 +1,425 @@
+// Copyright (c) 2021 Tim Perkins
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// “Software”), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TSIG_DELEGATE_HPP
+#define TSIG_DELEGATE_HPP
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace tsig {
+
+// Big enough for a member function pointer bound to an object (e.g., std::bind with this)
+static constexpr std::size_t DEFAULT_DELEGATE_INLINE_SIZE = 4u * sizeof(void*);
+
+template <typename Func, std::size_t InlineSize = DEFAULT_DELEGATE_INLINE_SIZE>
+class Delegate;
+
+namespace detail {
+
+// Like std::function, only callables taking the parameters (and returning something convertible
+// to the result, unless it's void) make delegates
+template <typename Callable, typename Ret, typename... Param>
+class IsDelegateCallable {
+  template <typename C, typename R = decltype(std::declval<C&>()(std::declval<Param>()...))>
+  static std::integral_constant<bool, std::is_void<Ret>::value || std::is_convertible<R, Ret>::value>
+  Check_(int);
+  template <typename C>
+  static std::false_type Check_(...);
+
+ public:
+  static constexpr bool value = decltype(Check_<Callable>(0))::value;
+};
+
+}  // namespace detail
+
+// Like std::function, but callables up to InlineSize bytes never allocate
+template <typename Ret, typename... Param, std::size_t InlineSize>
+class Delegate<Ret(Param...), InlineSize> {
+ public:
+  Delegate() noexcept;
+  Delegate(std::nullptr_t) noexcept;
+  template <typename Callable,
+            typename = typename std::enable_if<
+                !std::is_same<typename std::decay<Callable>::type, Delegate>::value
+                && detail::IsDelegateCallable<typename std::decay<Callable>::type, Ret,
+                                              Param...>::value>::type>
+  Delegate(Callable&& callable);
+  template <typename T>
+  Delegate(T* object, Ret (T::*method)(Param...));
+  template <typename T>
+  Delegate(const T* object, Ret (T::*method)(Param...) const);
+  Delegate(const Delegate& delegate);
+  Delegate(Delegate&& delegate) noexcept;
+  ~Delegate();
+
+  Delegate& operator=(const Delegate& delegate);
+  Delegate& operator=(Delegate&& delegate) noexcept;
+  Delegate& operator=(std::nullptr_t) noexcept;
+
+  // Bind a member function known at compile time, storing only the object pointer
+  template <typename T, Ret (T::*method)(Param...)>
+  static Delegate Bind(T* object) noexcept;
+  template <typename T, Ret (T::*method)(Param...) const>
+  static Delegate Bind(const T* object) noexcept;
+
+  Ret operator()(Param... param) const;
+  explicit operator bool() const noexcept;
+
+ private:
+  enum class Operation { COPY, MOVE, DESTROY };
+
+  union Storage {
+    typename std::aligned_storage<InlineSize, alignof(std::max_align_t)>::type buffer;
+    void* heap_ptr;
+  };
+
+  using Invoker = Ret (*)(Storage& storage, Param&&... param);
+  using Manager = void (*)(Operation operation, Storage& storage, Storage* other_storage);
+
+  template <typename Callable>
+  using FitsInline =
+      std::integral_constant<bool, sizeof(Callable) <= sizeof(Storage)
+                                       && alignof(Callable) <= alignof(Storage)
+                                       && std::is_nothrow_move_constructible<Callable>::value>;
+
+  template <typename T, typename Method>
+  struct MemberCallable {
+    Ret operator()(Param&&... param) const
+    {
+      return (object->*method)(std::forward<Param>(param)...);
+    }
+
+    T* object;
+    Method method;
+  };
+
+  // Function pointers and functions can be null, other callables are never empty
+  template <typename Callable>
+  struct IsNullable : std::is_pointer<Callable> {};
+  template <typename Func>
+  struct IsNullable<std::function<Func>> : std::true_type {};
+  template <typename Func, std::size_t OtherInlineSize>
+  struct IsNullable<Delegate<Func, OtherInlineSize>> : std::true_type {};
+
+  template <typename Callable>
+  static bool IsNull_(const Callable& callable, std::true_type /* nullable */) noexcept;
+  template <typename Callable>
+  static bool IsNull_(const Callable& callable, std::false_type /* nullable */) noexcept;
+  template <typename Callable>
+  void Store_(Callable&& callable, std::true_type /* fits_inline */);
+  template <typename Callable>
+  void Store_(Callable&& callable, std::false_type /* fits_inline */);
+  void Reset_() noexcept;
+
+  template <typename Callable>
+  static Ret InvokeInline_(Storage& storage, Param&&... param);
+  template <typename Callable>
+  static Ret InvokeHeap_(Storage& storage, Param&&... param);
+  template <typename T, Ret (T::*method)(Param...)>
+  static Ret InvokeMethod_(Storage& storage, Param&&... param);
+  template <typename T, Ret (T::*method)(Param...) const>
+  static Ret InvokeConstMethod_(Storage& storage, Param&&... param);
+
+  template <typename Callable>
+  static void ManageInline_(Operation operation, Storage& storage, Storage* other_storage);
+  template <typename Callable>
+  static void ManageHeap_(Operation operation, Storage& storage, Storage* other_storage);
+
+  // Mutable like std::function, the callable is invoked as non-const
+  mutable Storage storage_;
+  Invoker invoker_;
+  // A null manager means the storage is trivial (e.g., a bound object pointer)
+  Manager manager_;
+};
+
+template <typename Ret, typename... Param, std::size_t InlineSize>
+Delegate<Ret(Param...), InlineSize>::Delegate() noexcept : invoker_(nullptr), manager_(nullptr)
+{
+  // Do nothing
+}
+
+template <typename Ret, typename... Param, std::size_t InlineSize>
+Delegate<Ret(Param...), InlineSize>::Delegate(std::nullptr_t) noexcept
+    : invoker_(nullptr), manager_(nullptr)
+{
+  // Do nothing
+}
+
+template <typename Ret, typename... Param, std::size_t InlineSize>
+template <typename Callable, typename>
+Delegate<Ret(Param...), InlineSize>::Delegate(Callable&& callable)
+    : invoker_(nullptr), manager_(nullptr)
+{
+  using StoredCallable = typename std::decay<Callable>::type;
+  // Like std::function, a null function pointer or an empty function makes an empty delegate
+  if (IsNull_<StoredCallable>(callable, IsNullable<StoredCallable>())) {
+    return;
+  }
+  Store_(std::forward<Callable>(callable), FitsInline<StoredCallable>());
+}
+
+template <typename Ret, typename... Param, std::size_t InlineSize>
+template <typename T>
+Delegate<Ret(Param...), InlineSize>::Delegate(T* object, Ret (T::*method)(Param...))
+    : invoker_(nullptr), manager_(nullptr)
+{
+  using StoredCallable = MemberCallable<T, Ret (T::*)(Param...)>;
+  Store_(StoredCallable{object, method}, FitsInline<StoredCallable>());
+}
+
+template <typename Ret, typename... Param, std::size_t InlineSize>
+template <typename T>
+Delegate<Ret(Param...), InlineSize>::Delegate(const T* object,
+                                              Ret (T::*method)(Param...) const)
+    : invoker_(nullptr), manager_(nullptr)
+{
+  using StoredCallable = MemberCallable<const T, Ret (T::*)(Param...) const>;
+  Store_(StoredCallable{object, method}, FitsInline<StoredCallable>());
+}
+
+template <typename Ret, typename... Param, std::size_t InlineSize>
+Delegate<Ret(Param...), InlineSize>::Delegate(const Delegate& delegate)
+    : storage_(delegate.storage_), invoker_(delegate.invoker_), manager_(delegate.manager_)
+{
+  if (manager_) {
+    manager_(Operation::COPY, storage_, &delegate.storage_);
+  }
+}
+
+template <typename Ret, typename... Param, std::size_t InlineSize>
+Delegate<Ret(Param...), InlineSize>::Delegate(Delegate&& delegate) noexcept
+    : storage_(delegate.storage_), invoker_(delegate.invoker_), manager_(delegate.manager_)
+{
+  if (manager_) {
+    manager_(Operation::MOVE, storage_, &delegate.storage_);
+  }
+  delegate.invoker_ = nullptr;
+  delegate.manager_ = nullptr;
+}
+
+template <typename Ret, typename... Param, std::size_t InlineSize>
+Delegate<Ret(Param...), InlineSize>::~Delegate()
+{
+  Reset_();
+}
+
+template <typename Ret, typename... Param, std::size_t InlineSize>
+Delegate<Ret(Param...), InlineSize>& Delegate<Ret(Param...), InlineSize>::operator=(
+    const Delegate& delegate)
+{
+  if (this != &delegate) {
+    Delegate copy_delegate(delegate);
+    *this = std::move(copy_delegate);
+  }
+  return *this;
+}
+
+template <typename Ret, typename... Param, std::size_t InlineSize>
+Delegate<Ret(Param...), InlineSize>& Delegate<Ret(Param...), InlineSize>::operator=(
+    Delegate&& delegate) noexcept
+{
+  if (this != &delegate) {
+    Reset_();
+    storage_ = delegate.storage_;
+    invoker_ = delegate.invoker_;
+    manager_ = delegate.manager_;
+    if (manager_) {
+      manager_(Operation::MOVE, storage_, &delegate.storage_);
+    }
+    delegate.invoker_ = nullptr;
+    delegate.manager_ = nullptr;
+  }
+  return *this;
+}
+
+template <typename Ret, typename... Param, std::size_t InlineSize>
+Delegate<Ret(Param...), InlineSize>& Delegate<Ret(Param...), InlineSize>::operator=(
+    std::nullptr_t) noexcept
+{
+  Reset_();
+  return *this;
+}
+
+template <typename Ret, typename... Param, std::size_t InlineSize>
+template <typename T, Ret (T::*method)(Param...)>
+Delegate<Ret(Param...), InlineSize> Delegate<Ret(Param...), InlineSize>::Bind(
+    T* object) noexcept
+{
+  Delegate delegate;
+  delegate.storage_.heap_ptr = object;
+  delegate.invoker_ = &InvokeMethod_<T, method>;
+  return delegate;
+}
+
+template <typename Ret, typename... Param, std::size_t InlineSize>
+template <typename T, Ret (T::*method)(Param...) const>
+Delegate<Ret(Param...), InlineSize> Delegate<Ret(Param...), InlineSize>::Bind(
+    const T* object) noexcept
+{
+  Delegate delegate;
+  delegate.storage_.heap_ptr = const_cast<T*>(object);
+  delegate.invoker_ = &InvokeConstMethod_<T, method>;
+  return delegate;
+}
+
+template <typename Ret, typename... Param, std::size_t InlineSize>
+Ret Delegate<Ret(Param...), InlineSize>::operator()(Param... param) const
+{
+  if (!invoker_) {
+    throw std::bad_function_call();
+  }
+  return invoker_(storage_, std::forward<Param>(param)...);
+}
+
+template <typename Ret, typename... Param, std::size_t InlineSize>
+Delegate<Ret(Param...), InlineSize>::operator bool() const noexcept
+{
+  return invoker_ != nullptr;
+}
+
+template <typename Ret, typename... Param, std::size_t InlineSize>
+template <typename Callable>
+bool Delegate<Ret(Param...), InlineSize>::IsNull_(const Callable& callable,
+                                                  std::true_type /* nullable */) noexcept
+{
+  return !callable;
+}
+
+template <typename Ret, typename... Param, std::size_t InlineSize>
+template <typename Callable>
+bool Delegate<Ret(Param...), InlineSize>::IsNull_(const Callable&,
+                                                  std::false_type /* nullable */) noexcept
+{
+  return false;
+}
+
+template <typename Ret, typename... Param, std::size_t InlineSize>
+template <typename Callable>
+void Delegate<Ret(Param...), InlineSize>::Store_(Callable&& callable,
+                                                 std::true_type /* fits_inline */)
+{
+  using StoredCallable = typename std::decay<Callable>::type;
+  ::new (static_cast<void*>(&storage_.buffer)) StoredCallable(std::forward<Callable>(callable));
+  invoker_ = &InvokeInline_<StoredCallable>;
+  manager_ = &ManageInline_<StoredCallable>;
+}
+
+template <typename Ret, typename... Param, std::size_t InlineSize>
+template <typename Callable>
+void Delegate<Ret(Param...), InlineSize>::Store_(Callable&& callable,
+                                                 std::false_type /* fits_inline */)
+{
+  using StoredCallable = typename std::decay<Callable>::type;
+  storage_.heap_ptr = new StoredCallable(std::forward<Callable>(callable));
+  invoker_ = &InvokeHeap_<StoredCallable>;
+  manager_ = &ManageHeap_<StoredCallable>;
+}
+
+template <typename Ret, typename... Param, std::size_t InlineSize>
+void Delegate<Ret(Param...), InlineSize>::Reset_() noexcept
+{
+  if (manager_) {
+    manager_(Operation::DESTROY, storage_, nullptr);
+  }
+  invoker_ = nullptr;
+  manager_ = nullptr;
+}
+
+template <typename Ret, typename... Param, std::size_t InlineSize>
+template <typename Callable>
+Ret Delegate<Ret(Param...), InlineSize>::InvokeInline_(Storage& storage, Param&&... param)
+{
+  // Cast, so callables returning something can still be stored in a void delegate
+  return static_cast<Ret>(
+      (*reinterpret_cast<Callable*>(&storage.buffer))(std::forward<Param>(param)...));
+}
+
+template <typename Ret, typename... Param, std::size_t InlineSize>
+template <typename Callable>
+Ret Delegate<Ret(Param...), InlineSize>::InvokeHeap_(Storage& storage, Param&&... param)
+{
+  return static_cast<Ret>(
+      (*static_cast<Callable*>(storage.heap_ptr))(std::forward<Param>(param)...));
+}
+
+template <typename Ret, typename... Param, std::size_t InlineSize>
+template <typename T, Ret (T::*method)(Param...)>
+Ret Delegate<Ret(Param...), InlineSize>::InvokeMethod_(Storage& storage, Param&&... param)
+{
+  return (static_cast<T*>(storage.heap_ptr)->*method)(std::forward<Param>(param)...);
+}
+
+template <typename Ret, typename... Param, std::size_t InlineSize>
+template <typename T, Ret (T::*method)(Param...) const>
+Ret Delegate<Ret(Param...), InlineSize>::InvokeConstMethod_(Storage& storage, Param&&... param)
+{
+  return (static_cast<const T*>(storage.heap_ptr)->*method)(std::forward<Param>(param)...);
+}
+
+template <typename Ret, typename... Param, std::size_t InlineSize>
+template <typename Callable>
+void Delegate<Ret(Param...), InlineSize>::ManageInline_(Operation operation, Storage& storage,
+                                                        Storage* other_storage)
+{
+  Callable* const callable_ptr = reinterpret_cast<Callable*>(&storage.buffer);
+  switch (operation) {
+  case Operation::COPY:
+    ::new (static_cast<void*>(callable_ptr))
+        Callable(*reinterpret_cast<const Callable*>(&other_storage->buffer));
+    break;
+  case Operation::MOVE: {
+    Callable* const other_callable_ptr = reinterpret_cast<Callable*>(&other_storage->buffer);
+    ::new (static_cast<void*>(callable_ptr)) Callable(std::move(*other_callable_ptr));
+    other_callable_ptr->~Callable();
+    break;
+  }
+  case Operation::DESTROY:
+    callable_ptr->~Callable();
+    break;
+  }
+}
+
+template <typename Ret, typename... Param, std::size_t InlineSize>
+template <typename Callable>
+void Delegate<Ret(Param...), InlineSize>::ManageHeap_(Operation operation, Storage& storage,
+                                                      Storage* other_storage)
+{
+  switch (operation) {
+  case Operation::COPY:
+    storage.heap_ptr = new Callable(*static_cast<const Callable*>(other_storage->heap_ptr));
+    break;
+  case Operation::MOVE:
+    // The pointer was already transferred with the storage
+    break;
+  case Operation::DESTROY:
+    delete static_cast<Callable*>(storage.heap_ptr);
+    break;
+  }
+}
+
+}  // namespace tsig
+
+#endif  // TSIG_DELEGATE_HPP
@@ -0,0 +1,262 @@
+// Copyright (c) 2021 Tim Perkins
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// “Software”), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TSIG_DISPATCHER_HPP
+#define TSIG_DISPATCHER_HPP
+
+#include <tsig/delegate.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace tsig {
+
+// Big enough for a queued emission of a few small arguments
+static constexpr std::size_t DISPATCHER_TASK_INLINE_SIZE = 8u * sizeof(void*);
+
+// The default number of emissions an event loop can queue
+static constexpr std::size_t DEFAULT_DISPATCHER_CAPACITY = 1024u;
+
+// Runs each emission immediately, on the emitting thread
+class ImmediateDispatcher {
+ public:
+  template <typename Task>
+  void Dispatch(Task&& task);
+};
+
+// Queues emissions from any thread, and runs them on the thread polling the event loop (only
+// one thread may poll at a time)
+class EventLoopDispatcher {
+ public:
+  using Task = Delegate<void(void), DISPATCHER_TASK_INLINE_SIZE>;
+
+  // The capacity is rounded up to a power of two
+  explicit EventLoopDispatcher(std::size_t capacity = DEFAULT_DISPATCHER_CAPACITY);
+  EventLoopDispatcher(const EventLoopDispatcher&) = delete;
+  EventLoopDispatcher(EventLoopDispatcher&&) = delete;
+
+  EventLoopDispatcher& operator=(const EventLoopDispatcher&) = delete;
+  EventLoopDispatcher& operator=(EventLoopDispatcher&&) = delete;
+
+  // Blocks while the queue is full (from the loop thread, runs queued tasks instead)
+  void Dispatch(Task&& task);
+  // Returns false if the queue is full
+  bool TryDispatch(Task&& task);
+
+  // Runs the queued tasks on the calling thread, returning how many were run. Anything thrown
+  // by a task is passed on, and the tasks after it stay queued for the next poll
+  std::size_t Poll();
+  // Runs queued tasks on the calling thread until stopped (returns at once if stopped before),
+  // or until a task throws
+  void Run();
+  void Stop();
+  // Clears a stop, so the loop can run again
+  void Reset();
+
+ private:
+  struct Cell {
+    std::atomic<std::size_t> sequence;
+    Task task;
+  };
+
+  // Used to keep the producer and consumer positions on separate cache lines
+  static constexpr std::size_t CACHE_LINE_SIZE = 64u;
+
+  bool TryPush_(Task& task);
+  bool TryPop_(Task& task);
+  bool IsEmpty_() const;
+  void Notify_();
+
+  std::size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+  char pad0_[CACHE_LINE_SIZE];
+  std::atomic<std::size_t> enqueue_pos_;
+  char pad1_[CACHE_LINE_SIZE];
+  std::size_t dequeue_pos_;
+  std::atomic<std::thread::id> loop_thread_id_;
+  std::atomic<bool> sleeping_;
+  std::atomic<bool> stopped_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+};
+
+template <typename Task>
+void ImmediateDispatcher::Dispatch(Task&& task)
+{
+  task();
+}
+
+inline EventLoopDispatcher::EventLoopDispatcher(std::size_t capacity)
+    : enqueue_pos_(0u),
+      dequeue_pos_(0u),
+      loop_thread_id_(std::thread::id()),
+      sleeping_(false),
+      stopped_(false)
+{
+  std::size_t pow2_capacity = 2u;
+  while (pow2_capacity < capacity) {
+    pow2_capacity *= 2u;
+  }
+  mask_ = pow2_capacity - 1u;
+  cells_.reset(new Cell[pow2_capacity]);
+  for (std::size_t ii = 0; ii < pow2_capacity; ++ii) {
+    cells_[ii].sequence.store(ii, std::memory_order_relaxed);
+  }
+}
+
+inline void EventLoopDispatcher::Dispatch(Task&& task)
+{
+  while (!TryPush_(task)) {
+    if (loop_thread_id_.load() == std::this_thread::get_id()) {
+      // Waiting on ourselves would never finish, so make some room
+      Poll();
+    }
+    else {
+      std::this_thread::yield();
+    }
+  }
+  Notify_();
+}
+
+inline bool EventLoopDispatcher::TryDispatch(Task&& task)
+{
+  if (!TryPush_(task)) {
+    return false;
+  }
+  Notify_();
+  return true;
+}
+
+inline std::size_t EventLoopDispatcher::Poll()
+{
+  // Restored even if a task throws, or other threads could mistake themselves for the loop
+  struct LoopThreadGuard {
+    ~LoopThreadGuard()
+    {
+      loop_thread_id.store(prev_thread_id);
+    }
+
+    std::atomic<std::thread::id>& loop_thread_id;
+    std::thread::id prev_thread_id;
+  } loop_thread_guard{loop_thread_id_, loop_thread_id_.exchange(std::this_thread::get_id())};
+  std::size_t num_tasks = 0u;
+  Task task;
+  while (TryPop_(task)) {
+    task();
+    task = nullptr;
+    ++num_tasks;
+  }
+  return num_tasks;
+}
+
+inline void EventLoopDispatcher::Run()
+{
+  while (!stopped_.load()) {
+    if (Poll() != 0u) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    // Producers check this after publishing, so either they notify or we see the task
+    sleeping_.store(true);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    condition_.wait(lock, [this]() { return stopped_.load() || !IsEmpty_(); });
+    sleeping_.store(false);
+  }
+}
+
+inline void EventLoopDispatcher::Stop()
+{
+  stopped_.store(true);
+  std::lock_guard<std::mutex> lock(mutex_);
+  condition_.notify_all();
+}
+
+inline void EventLoopDispatcher::Reset()
+{
+  stopped_.store(false);
+}
+
+inline bool EventLoopDispatcher::TryPush_(Task& task)
+{
+  // Bounded MPSC ring, where each cell's sequence says whose turn it is
+  std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+  Cell* cell_ptr;
+  while (true) {
+    cell_ptr = &cells_[pos & mask_];
+    const std::size_t sequence = cell_ptr->sequence.load(std::memory_order_acquire);
+    const std::intptr_t diff =
+        static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos);
+    if (diff == 0) {
+      if (enqueue_pos_.compare_exchange_weak(pos, pos + 1u, std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    else if (diff < 0) {
+      return false;
+    }
+    else {
+      pos = enqueue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+  cell_ptr->task = std::move(task);
+  cell_ptr->sequence.store(pos + 1u, std::memory_order_release);
+  return true;
+}
+
+inline bool EventLoopDispatcher::TryPop_(Task& task)
+{
+  Cell& cell = cells_[dequeue_pos_ & mask_];
+  const std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+  if (sequence != dequeue_pos_ + 1u) {
+    return false;
+  }
+  task = std::move(cell.task);
+  cell.sequence.store(dequeue_pos_ + mask_ + 1u, std::memory_order_release);
+  ++dequeue_pos_;
+  return true;
+}
+
+inline bool EventLoopDispatcher::IsEmpty_() const
+{
+  const Cell& cell = cells_[dequeue_pos_ & mask_];
+  return cell.sequence.load(std::memory_order_acquire) != dequeue_pos_ + 1u;
+}
+
+inline void EventLoopDispatcher::Notify_()
+{
+  // Pairs with the loop setting sleeping before checking the queue
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (sleeping_.load()) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    condition_.notify_one();
+  }
+}
+
+}  // namespace tsig
+
+#endif  // TSIG_DISPATCHER_HPP
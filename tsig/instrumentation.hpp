@@ -0,0 +1,435 @@
+// Copyright (c) 2021 Tim Perkins
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// “Software”), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TSIG_INSTRUMENTATION_HPP
+#define TSIG_INSTRUMENTATION_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace tsig {
+
+// Handler latencies are counted in power of two buckets of nanoseconds
+static constexpr std::size_t NUM_LATENCY_BUCKETS = 32u;
+
+// The statistics of a handler, at the time of the snapshot
+struct HandlerStats {
+  std::uint64_t num_calls;
+  std::uint64_t total_latency_ns;
+  // Bucket 0 counts calls under 1 ns, bucket N counts calls under 2^N ns (but at least 2^(N-1)
+  // ns), and the last bucket also counts anything longer
+  std::array<std::uint64_t, NUM_LATENCY_BUCKETS> latency_buckets;
+};
+
+// The statistics of a signal, at the time of the snapshot
+struct SignalStats {
+  std::string name;
+  std::uint64_t num_emits;
+  std::size_t num_handlers;
+  // In call order (by priority, then connection order)
+  std::vector<HandlerStats> handler_stats;
+};
+
+namespace detail {
+
+// Used to tag instrumentation policies
+struct InstrumentationPolicyKind {
+  // Empty
+};
+
+// A handler recorder which records nothing
+class NullHandlerRecorder {
+ public:
+  template <typename Call>
+  void RecordCall(Call&& call) const;
+};
+
+// A signal recorder which records nothing
+class NullSignalRecorder {
+ public:
+  using HandlerRecorder = NullHandlerRecorder;
+
+  void SetName(const std::string& name);
+  SignalStats GetStats() const;
+
+  void RecordEmits(std::size_t num_emits) const;
+  HandlerRecorder RecordConnect(std::size_t handler_id, int priority);
+  void RecordDisconnect(std::size_t handler_id);
+};
+
+// Lock free counters for a handler, shared between its recorder and its signal recorder
+class HandlerCounters {
+ public:
+  HandlerCounters(std::size_t handler_id, int priority);
+  HandlerCounters(const HandlerCounters&) = delete;
+
+  HandlerCounters& operator=(const HandlerCounters&) = delete;
+
+  std::size_t HandlerId() const;
+  int Priority() const;
+  HandlerStats GetStats() const;
+
+  void RecordLatency(std::uint64_t latency_ns);
+
+ private:
+  std::size_t handler_id_;
+  int priority_;
+  std::atomic<std::uint64_t> num_calls_;
+  std::atomic<std::uint64_t> total_latency_ns_;
+  std::array<std::atomic<std::uint64_t>, NUM_LATENCY_BUCKETS> latency_buckets_;
+};
+
+// Times each call of a handler
+class HandlerRecorder {
+ public:
+  explicit HandlerRecorder(const std::shared_ptr<HandlerCounters>& counters_ptr);
+
+  template <typename Call>
+  void RecordCall(Call&& call) const;
+
+ private:
+  std::shared_ptr<HandlerCounters> counters_ptr_;
+};
+
+// Counts the emissions of a signal, and keeps the counters of its handlers for snapshots
+class SignalRecorder {
+ public:
+  using HandlerRecorder = detail::HandlerRecorder;
+
+  // Registered for as long as it lives, so it's part of every snapshot
+  SignalRecorder();
+  SignalRecorder(const SignalRecorder&) = delete;
+  ~SignalRecorder();
+
+  SignalRecorder& operator=(const SignalRecorder&) = delete;
+
+  void SetName(const std::string& name);
+  SignalStats GetStats() const;
+
+  void RecordEmits(std::size_t num_emits) const;
+  HandlerRecorder RecordConnect(std::size_t handler_id, int priority);
+  void RecordDisconnect(std::size_t handler_id);
+
+ private:
+  mutable std::atomic<std::uint64_t> num_emits_;
+  // Guards everything but the emit counter
+  mutable std::mutex mutex_;
+  std::string name_;
+  // Ordered the same way as the handlers of the signal
+  std::vector<std::shared_ptr<HandlerCounters>> handler_counters_ptrs_;
+};
+
+// Keeps track of every live signal recorder
+class InstrumentationRegistry {
+ public:
+  static InstrumentationRegistry& Get();
+
+  void Register(const SignalRecorder* recorder_ptr);
+  void Unregister(const SignalRecorder* recorder_ptr);
+  std::vector<SignalStats> GetAllStats() const;
+
+ private:
+  InstrumentationRegistry() = default;
+
+  mutable std::mutex mutex_;
+  std::vector<const SignalRecorder*> recorder_ptrs_;
+};
+
+// The bucket counting a latency
+std::size_t GetLatencyBucket(std::uint64_t latency_ns);
+
+// The upper bound of the bucket where a fraction of the calls are counted
+std::uint64_t GetLatencyPercentile(const HandlerStats& handler_stats, double fraction);
+
+}  // namespace detail
+
+// Records nothing, and costs nothing (the default)
+struct NoInstrumentation {
+  using PolicyKind = detail::InstrumentationPolicyKind;
+  static constexpr bool ENABLED = false;
+  using SignalRecorder = detail::NullSignalRecorder;
+};
+
+// Records emit counts, handler counts, and handler latencies, without locking or allocating on
+// emission (signals allocate their data up front, so that idle signals are counted too)
+struct Instrumented {
+  using PolicyKind = detail::InstrumentationPolicyKind;
+  static constexpr bool ENABLED = true;
+  using SignalRecorder = detail::SignalRecorder;
+};
+
+// Snapshots the statistics of every live instrumented signal
+std::vector<SignalStats> GetAllSignalStats();
+
+// Writes the statistics of every live instrumented signal, in a human readable form
+void DumpAllSignalStats(std::ostream& os);
+
+namespace detail {
+
+template <typename Call>
+void NullHandlerRecorder::RecordCall(Call&& call) const
+{
+  call();
+}
+
+inline void NullSignalRecorder::SetName(const std::string&)
+{
+  // Do nothing
+}
+
+inline SignalStats NullSignalRecorder::GetStats() const
+{
+  return SignalStats();
+}
+
+inline void NullSignalRecorder::RecordEmits(std::size_t) const
+{
+  // Do nothing
+}
+
+inline NullSignalRecorder::HandlerRecorder NullSignalRecorder::RecordConnect(std::size_t, int)
+{
+  return HandlerRecorder();
+}
+
+inline void NullSignalRecorder::RecordDisconnect(std::size_t)
+{
+  // Do nothing
+}
+
+inline HandlerCounters::HandlerCounters(std::size_t handler_id, int priority)
+    : handler_id_(handler_id), priority_(priority), num_calls_(0u), total_latency_ns_(0u)
+{
+  for (std::atomic<std::uint64_t>& latency_bucket : latency_buckets_) {
+    latency_bucket.store(0u, std::memory_order_relaxed);
+  }
+}
+
+inline std::size_t HandlerCounters::HandlerId() const
+{
+  return handler_id_;
+}
+
+inline int HandlerCounters::Priority() const
+{
+  return priority_;
+}
+
+inline HandlerStats HandlerCounters::GetStats() const
+{
+  // The counters are read one by one, so they could be slightly out of step with each other
+  HandlerStats handler_stats;
+  handler_stats.num_calls = num_calls_.load(std::memory_order_relaxed);
+  handler_stats.total_latency_ns = total_latency_ns_.load(std::memory_order_relaxed);
+  for (std::size_t ii = 0; ii < NUM_LATENCY_BUCKETS; ++ii) {
+    handler_stats.latency_buckets[ii] = latency_buckets_[ii].load(std::memory_order_relaxed);
+  }
+  return handler_stats;
+}
+
+inline void HandlerCounters::RecordLatency(std::uint64_t latency_ns)
+{
+  num_calls_.fetch_add(1u, std::memory_order_relaxed);
+  total_latency_ns_.fetch_add(latency_ns, std::memory_order_relaxed);
+  latency_buckets_[GetLatencyBucket(latency_ns)].fetch_add(1u, std::memory_order_relaxed);
+}
+
+inline HandlerRecorder::HandlerRecorder(const std::shared_ptr<HandlerCounters>& counters_ptr)
+    : counters_ptr_(counters_ptr)
+{
+  // Do nothing
+}
+
+template <typename Call>
+void HandlerRecorder::RecordCall(Call&& call) const
+{
+  // Recorded when the guard is destroyed, so calls which throw are recorded too
+  struct RecordGuard {
+    ~RecordGuard()
+    {
+      const std::chrono::steady_clock::duration latency =
+          std::chrono::steady_clock::now() - start_time;
+      counters.RecordLatency(static_cast<std::uint64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count()));
+    }
+
+    HandlerCounters& counters;
+    std::chrono::steady_clock::time_point start_time;
+  } record_guard{*counters_ptr_, std::chrono::steady_clock::now()};
+  call();
+}
+
+inline SignalRecorder::SignalRecorder() : num_emits_(0u)
+{
+  InstrumentationRegistry::Get().Register(this);
+}
+
+inline SignalRecorder::~SignalRecorder()
+{
+  InstrumentationRegistry::Get().Unregister(this);
+}
+
+inline void SignalRecorder::SetName(const std::string& name)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  name_ = name;
+}
+
+inline SignalStats SignalRecorder::GetStats() const
+{
+  SignalStats signal_stats;
+  signal_stats.num_emits = num_emits_.load(std::memory_order_relaxed);
+  std::lock_guard<std::mutex> lock(mutex_);
+  signal_stats.name = name_;
+  signal_stats.num_handlers = handler_counters_ptrs_.size();
+  signal_stats.handler_stats.reserve(handler_counters_ptrs_.size());
+  for (const std::shared_ptr<HandlerCounters>& handler_counters_ptr : handler_counters_ptrs_) {
+    signal_stats.handler_stats.push_back(handler_counters_ptr->GetStats());
+  }
+  return signal_stats;
+}
+
+inline void SignalRecorder::RecordEmits(std::size_t num_emits) const
+{
+  num_emits_.fetch_add(num_emits, std::memory_order_relaxed);
+}
+
+inline SignalRecorder::HandlerRecorder SignalRecorder::RecordConnect(std::size_t handler_id,
+                                                                     int priority)
+{
+  const std::shared_ptr<HandlerCounters> handler_counters_ptr =
+      std::make_shared<HandlerCounters>(handler_id, priority);
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Goes after every handler with the same or a higher priority, like the handler itself
+  auto iter = handler_counters_ptrs_.end();
+  while (iter != handler_counters_ptrs_.begin() && (*(iter - 1))->Priority() < priority) {
+    --iter;
+  }
+  handler_counters_ptrs_.insert(iter, handler_counters_ptr);
+  return HandlerRecorder(handler_counters_ptr);
+}
+
+inline void SignalRecorder::RecordDisconnect(std::size_t handler_id)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto iter = handler_counters_ptrs_.begin(); iter != handler_counters_ptrs_.end(); ++iter) {
+    if ((*iter)->HandlerId() == handler_id) {
+      handler_counters_ptrs_.erase(iter);
+      return;
+    }
+  }
+}
+
+inline InstrumentationRegistry& InstrumentationRegistry::Get()
+{
+  // Made by the first recorder, so it outlives all of them
+  static InstrumentationRegistry registry;
+  return registry;
+}
+
+inline void InstrumentationRegistry::Register(const SignalRecorder* recorder_ptr)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  recorder_ptrs_.push_back(recorder_ptr);
+}
+
+inline void InstrumentationRegistry::Unregister(const SignalRecorder* recorder_ptr)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto iter = recorder_ptrs_.begin(); iter != recorder_ptrs_.end(); ++iter) {
+    if (*iter == recorder_ptr) {
+      recorder_ptrs_.erase(iter);
+      return;
+    }
+  }
+}
+
+inline std::vector<SignalStats> InstrumentationRegistry::GetAllStats() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<SignalStats> all_signal_stats;
+  all_signal_stats.reserve(recorder_ptrs_.size());
+  for (const SignalRecorder* recorder_ptr : recorder_ptrs_) {
+    all_signal_stats.push_back(recorder_ptr->GetStats());
+  }
+  return all_signal_stats;
+}
+
+inline std::size_t GetLatencyBucket(std::uint64_t latency_ns)
+{
+  std::size_t bucket = 0u;
+  while (latency_ns != 0u && bucket < NUM_LATENCY_BUCKETS - 1u) {
+    latency_ns >>= 1u;
+    ++bucket;
+  }
+  return bucket;
+}
+
+inline std::uint64_t GetLatencyPercentile(const HandlerStats& handler_stats, double fraction)
+{
+  const double num_calls = static_cast<double>(handler_stats.num_calls) * fraction;
+  std::uint64_t cumulative_num_calls = 0u;
+  for (std::size_t ii = 0; ii < NUM_LATENCY_BUCKETS; ++ii) {
+    cumulative_num_calls += handler_stats.latency_buckets[ii];
+    if (static_cast<double>(cumulative_num_calls) >= num_calls) {
+      return std::uint64_t(1u) << ii;
+    }
+  }
+  return std::uint64_t(1u) << (NUM_LATENCY_BUCKETS - 1u);
+}
+
+}  // namespace detail
+
+inline std::vector<SignalStats> GetAllSignalStats()
+{
+  return detail::InstrumentationRegistry::Get().GetAllStats();
+}
+
+inline void DumpAllSignalStats(std::ostream& os)
+{
+  for (const SignalStats& signal_stats : GetAllSignalStats()) {
+    os << "signal " << (signal_stats.name.empty() ? "(unnamed)" : signal_stats.name) << ": "
+       << signal_stats.num_emits << " emits, " << signal_stats.num_handlers << " handlers\n";
+    for (std::size_t ii = 0; ii < signal_stats.handler_stats.size(); ++ii) {
+      const HandlerStats& handler_stats = signal_stats.handler_stats[ii];
+      const std::uint64_t mean_latency_ns =
+          handler_stats.num_calls != 0u ? handler_stats.total_latency_ns / handler_stats.num_calls
+                                        : 0u;
+      os << "  handler " << ii << ": " << handler_stats.num_calls << " calls, mean "
+         << mean_latency_ns << " ns, p50 < "
+         << detail::GetLatencyPercentile(handler_stats, 0.5) << " ns, p99 < "
+         << detail::GetLatencyPercentile(handler_stats, 0.99) << " ns\n";
+    }
+  }
+}
+
+}  // namespace tsig
+
+#endif  // TSIG_INSTRUMENTATION_HPP
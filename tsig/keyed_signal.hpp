@@ -0,0 +1,266 @@
+// Copyright (c) 2021 Tim Perkins
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// “Software”), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TSIG_KEYED_SIGNAL_HPP
+#define TSIG_KEYED_SIGNAL_HPP
+
+#include <tsig/signal.hpp>
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#if defined(__GNUC__) && (__GNUC__ >= 4)
+#define TSIG_CHECK_RESULT __attribute__((warn_unused_result))
+#elif defined(_MSC_VER) && (_MSC_VER >= 1700)
+#define TSIG_CHECK_RESULT _Check_return_
+#else
+#define TSIG_CHECK_RESULT
+#endif
+
+namespace tsig {
+namespace detail {
+
+template <typename Key, typename Func, typename... Policies>
+class KeyedSigdat;
+
+}  // namespace detail
+
+// A signal which only calls the handlers connected under the emitted key
+template <typename Key, typename... Param, typename... Policies>
+class KeyedSignal<Key, void(Param...), Policies...>
+    : private detail::SelectPolicy<detail::DispatchPolicyKind, DirectDispatch,
+                                   Policies...>::type {
+ public:
+  using HandlerPolicy =
+      typename detail::SelectPolicy<detail::HandlerPolicyKind, FunctionHandlers, Policies...>::type;
+  using DispatchPolicy =
+      typename detail::SelectPolicy<detail::DispatchPolicyKind, DirectDispatch, Policies...>::type;
+  using ThreadingPolicy =
+      typename detail::SelectPolicy<detail::ThreadingPolicyKind, SingleThreaded, Policies...>::type;
+  using Handler = typename HandlerPolicy::template Handler<void(Param...)>;
+
+  KeyedSignal();
+  template <typename Dispatcher, typename = typename std::enable_if<
+                                     !std::is_same<Dispatcher, KeyedSignal>::value>::type>
+  explicit KeyedSignal(Dispatcher& dispatcher);
+  KeyedSignal(const KeyedSignal&) = delete;
+  KeyedSignal(KeyedSignal&& signal) = default;
+
+  KeyedSignal& operator=(const KeyedSignal&) = delete;
+  KeyedSignal& operator=(KeyedSignal&& signal) = default;
+
+  TSIG_CHECK_RESULT Sigcon Connect(const Key& key, const Handler& handler);
+  TSIG_CHECK_RESULT Sigcon Connect(const Key& key, Handler&& handler);
+  void Emit(const Key& key, Param&&... param) const;
+  // Keys with no handlers left are only pruned when more keys are connected, so they may count
+  std::size_t NumKeys() const;
+
+ private:
+  using KeyedSigdatType = detail::KeyedSigdat<Key, void(Param...), Policies...>;
+
+  KeyedSigdatType& GetKeyedSigdat_();
+
+  // Null until the first connection (if lazy), so idle signals never allocate
+  std::unique_ptr<KeyedSigdatType> keyed_sigdat_ptr_;
+};
+
+namespace detail {
+
+// Indexes the handlers of each key, every key has its own sigdat
+template <typename Key, typename... Param, typename... Policies>
+class KeyedSigdat<Key, void(Param...), Policies...> {
+ public:
+  using SigdatType = Sigdat<void(Param...), Policies...>;
+  using ThreadingPolicy =
+      typename SelectPolicy<ThreadingPolicyKind, SingleThreaded, Policies...>::type;
+
+  // Returns the key's sigdat along with the handler ID
+  std::pair<std::shared_ptr<SigdatType>, std::size_t> AddHandler(
+      const Key& key, typename SigdatType::Handler&& handler);
+  template <typename DispatchPolicy, typename... Arg>
+  void Emit(const DispatchPolicy& dispatch_policy, const Key& key, Arg&&... arg) const;
+  std::size_t NumKeys() const;
+
+ private:
+  using Index = std::unordered_map<Key, std::shared_ptr<SigdatType>>;
+
+  std::shared_ptr<SigdatType> GetSigdat_(const Key& key);
+  void PruneKeys_(Index& index);
+
+  // Guards modifying the index (does nothing if single threaded)
+  mutable typename ThreadingPolicy::Mutex mutex_;
+  // A snapshot of the index, shared with any emissions in flight
+  typename ThreadingPolicy::template Snapshot<Index> index_snapshot_;
+  // Keys with no handlers are pruned once the index grows to this size, so it's amortized
+  std::size_t prune_size_ = 0u;
+};
+
+}  // namespace detail
+
+template <typename Key, typename... Param, typename... Policies>
+KeyedSignal<Key, void(Param...), Policies...>::KeyedSignal()
+    : keyed_sigdat_ptr_(ThreadingPolicy::LAZY_SIGDAT ? nullptr : new KeyedSigdatType())
+{
+  // Do nothing
+}
+
+template <typename Key, typename... Param, typename... Policies>
+template <typename Dispatcher, typename>
+KeyedSignal<Key, void(Param...), Policies...>::KeyedSignal(Dispatcher& dispatcher)
+    : DispatchPolicy(dispatcher),
+      keyed_sigdat_ptr_(ThreadingPolicy::LAZY_SIGDAT ? nullptr : new KeyedSigdatType())
+{
+  // Do nothing
+}
+
+template <typename Key, typename... Param, typename... Policies>
+Sigcon KeyedSignal<Key, void(Param...), Policies...>::Connect(const Key& key,
+                                                              const Handler& handler)
+{
+  return Connect(key, Handler(handler));
+}
+
+template <typename Key, typename... Param, typename... Policies>
+Sigcon KeyedSignal<Key, void(Param...), Policies...>::Connect(const Key& key, Handler&& handler)
+{
+  const auto sigdat_handler = GetKeyedSigdat_().AddHandler(key, std::move(handler));
+  return Sigcon(sigdat_handler.first, sigdat_handler.second);
+}
+
+template <typename Key, typename... Param, typename... Policies>
+void KeyedSignal<Key, void(Param...), Policies...>::Emit(const Key& key, Param&&... param) const
+{
+  // Nothing was ever connected
+  if (!keyed_sigdat_ptr_) {
+    return;
+  }
+  keyed_sigdat_ptr_->Emit(static_cast<const DispatchPolicy&>(*this), key,
+                          std::forward<Param>(param)...);
+}
+
+template <typename Key, typename... Param, typename... Policies>
+std::size_t KeyedSignal<Key, void(Param...), Policies...>::NumKeys() const
+{
+  return keyed_sigdat_ptr_ ? keyed_sigdat_ptr_->NumKeys() : 0u;
+}
+
+template <typename Key, typename... Param, typename... Policies>
+typename KeyedSignal<Key, void(Param...), Policies...>::KeyedSigdatType&
+KeyedSignal<Key, void(Param...), Policies...>::GetKeyedSigdat_()
+{
+  if (!keyed_sigdat_ptr_) {
+    keyed_sigdat_ptr_.reset(new KeyedSigdatType());
+  }
+  return *keyed_sigdat_ptr_;
+}
+
+namespace detail {
+
+template <typename Key, typename... Param, typename... Policies>
+std::pair<std::shared_ptr<typename KeyedSigdat<Key, void(Param...), Policies...>::SigdatType>,
+          std::size_t>
+KeyedSigdat<Key, void(Param...), Policies...>::AddHandler(const Key& key,
+                                                          typename SigdatType::Handler&& handler)
+{
+  // Connect while holding the lock, so the key can't be pruned before it has the handler
+  std::lock_guard<typename ThreadingPolicy::Mutex> lock(mutex_);
+  std::shared_ptr<SigdatType> sigdat_ptr = GetSigdat_(key);
+  const std::size_t handler_id = sigdat_ptr->AddHandler(std::move(handler));
+  return std::make_pair(std::move(sigdat_ptr), handler_id);
+}
+
+template <typename Key, typename... Param, typename... Policies>
+template <typename DispatchPolicy, typename... Arg>
+void KeyedSigdat<Key, void(Param...), Policies...>::Emit(const DispatchPolicy& dispatch_policy,
+                                                         const Key& key, Arg&&... arg) const
+{
+  // Hold the snapshot, so in-flight modifications will make a copy
+  const auto index_reader = index_snapshot_.Read();
+  if (!index_reader) {
+    return;
+  }
+  const typename Index::const_iterator index_iter = (*index_reader).find(key);
+  if (index_iter == (*index_reader).end()) {
+    return;
+  }
+  dispatch_policy.Emit(index_iter->second, std::forward<Arg>(arg)...);
+}
+
+template <typename Key, typename... Param, typename... Policies>
+std::size_t KeyedSigdat<Key, void(Param...), Policies...>::NumKeys() const
+{
+  std::lock_guard<typename ThreadingPolicy::Mutex> lock(mutex_);
+  const auto index_reader = index_snapshot_.Read();
+  return index_reader ? (*index_reader).size() : 0u;
+}
+
+template <typename Key, typename... Param, typename... Policies>
+std::shared_ptr<typename KeyedSigdat<Key, void(Param...), Policies...>::SigdatType>
+KeyedSigdat<Key, void(Param...), Policies...>::GetSigdat_(const Key& key)
+{
+  Index* const index_ptr = index_snapshot_.Get();
+  if (index_ptr) {
+    const typename Index::const_iterator index_iter = index_ptr->find(key);
+    if (index_iter != index_ptr->end()) {
+      return index_iter->second;
+    }
+  }
+  // A new key, so modify the index (or a copy, if an emission could be in flight)
+  Index* modify_index_ptr = index_ptr;
+  if (!index_ptr || index_snapshot_.IsShared()) {
+    modify_index_ptr = &index_snapshot_.Stage();
+    if (index_ptr) {
+      *modify_index_ptr = *index_ptr;
+    }
+  }
+  // Before adding the key, which has no handlers yet
+  if (modify_index_ptr->size() >= prune_size_) {
+    PruneKeys_(*modify_index_ptr);
+  }
+  const std::shared_ptr<SigdatType> sigdat_ptr = std::make_shared<SigdatType>();
+  modify_index_ptr->emplace(key, sigdat_ptr);
+  index_snapshot_.Commit();
+  return sigdat_ptr;
+}
+
+template <typename Key, typename... Param, typename... Policies>
+void KeyedSigdat<Key, void(Param...), Policies...>::PruneKeys_(Index& index)
+{
+  for (typename Index::iterator index_iter = index.begin(); index_iter != index.end();) {
+    if (index_iter->second->HasHandlers()) {
+      ++index_iter;
+    }
+    else {
+      index_iter = index.erase(index_iter);
+    }
+  }
+  prune_size_ = 2u * index.size() + 1u;
+}
+
+}  // namespace detail
+}  // namespace tsig
+
+#undef TSIG_CHECK_RESULT
+
+#endif  // TSIG_KEYED_SIGNAL_HPP
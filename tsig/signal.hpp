@@ -23,12 +23,30 @@
 #ifndef TSIG_SIGNAL_HPP
 #define TSIG_SIGNAL_HPP
 
+#include <tsig/delegate.hpp>
+#include <tsig/instrumentation.hpp>
+#include <tsig/threading.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <functional>
 #include <limits>
-#include <map>
 #include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+// GCC 7 and 8 have C++17 but not <memory_resource>
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define TSIG_HAS_MEMORY_RESOURCE
+#endif
+#endif
+
 #if defined(__GNUC__) && (__GNUC__ >= 4)
 #define TSIG_CHECK_RESULT __attribute__((warn_unused_result))
 #elif defined(_MSC_VER) && (_MSC_VER >= 1700)
@@ -39,33 +57,308 @@
 
 namespace tsig {
 
-// template <typename Dispatcher>
-// class SignalFactory;
+template <typename Dispatcher>
+class SignalFactory;
 
 class Sigcon;
 
-template <typename Func>
+template <typename Func, typename... Policies>
 class Signal;
 
-template <typename Func>
+template <typename Func, typename... Policies>
 class SignalConnector;
 
+template <typename Key, typename Func, typename... Policies>
+class KeyedSignal;
+
+template <typename T, typename... Policies>
+class CoalescingSignal;
+
+// Handlers with higher priorities are called first, equal priorities in connection order
+static constexpr int DEFAULT_HANDLER_PRIORITY = 0;
+
 namespace detail {
 
 static constexpr std::size_t INVALID_HANDLER_ID = std::numeric_limits<std::size_t>::max();
 
 class SigdatBase;
 
-template <typename Func>
+template <typename Func, typename... Policies>
 class Sigdat;
 
+// Used to tag the kind of each policy
+struct HandlerPolicyKind {
+  // Empty
+};
+
+// Used to tag dispatch policies
+struct DispatchPolicyKind {
+  // Empty
+};
+
+// Used to tag combiner policies
+struct CombinerPolicyKind {
+  // Empty
+};
+
+// Used to tag error policies
+struct ErrorPolicyKind {
+  // Empty
+};
+
+// Used to tag allocator policies
+struct AllocatorPolicyKind {
+  // Empty
+};
+
+template <std::size_t...>
+struct IndexSequence;
+
+// Used to call the handlers of a dispatched emission
+template <typename SigdatType, typename... Param>
+class DeferredEmit;
+
+// Used to wait for the next emission, without connecting a handler
+template <typename... Param>
+struct EmitWaiter;
+
+// Used to await the next emission from a coroutine (see coro.hpp)
+template <typename SigdatType, typename... Param>
+class NextAwaiter;
+
+// Used to select the first policy of a kind (or the default)
+template <typename PolicyKind, typename DefaultPolicy, typename... Policies>
+struct SelectPolicy;
+
 }  // namespace detail
 
-class Sigcon {
+// Store handlers in std::function (the default)
+struct FunctionHandlers {
+  using PolicyKind = detail::HandlerPolicyKind;
   template <typename Func>
-  friend class Signal;
+  using Handler = std::function<Func>;
+};
+
+// Store handlers in tsig::Delegate, so small handlers never allocate
+template <std::size_t InlineSize = DEFAULT_DELEGATE_INLINE_SIZE>
+struct DelegateHandlers {
+  using PolicyKind = detail::HandlerPolicyKind;
   template <typename Func>
+  using Handler = Delegate<Func, InlineSize>;
+};
+
+// Call handlers directly from Emit (the default)
+struct DirectDispatch {
+  using PolicyKind = detail::DispatchPolicyKind;
+
+  template <typename SigdatType, typename... Param>
+  void Emit(const std::shared_ptr<SigdatType>& sigdat_ptr, Param&&... param) const;
+};
+
+// Queue emissions on a dispatcher, which calls the handlers later (e.g., on its own thread)
+template <typename Dispatcher>
+class DispatchWith {
+ public:
+  using PolicyKind = detail::DispatchPolicyKind;
+
+  DispatchWith();
+  explicit DispatchWith(Dispatcher& dispatcher);
+
+  template <typename SigdatType, typename... Param>
+  void Emit(const std::shared_ptr<SigdatType>& sigdat_ptr, Param&&... param) const;
+
+ private:
+  Dispatcher* dispatcher_ptr_;
+};
+
+// Allocate from the global heap (the default)
+struct DefaultAllocation {
+  using PolicyKind = detail::AllocatorPolicyKind;
+  // Signals allocate their data on the first connection
+  static constexpr bool LAZY_SIGDAT = true;
+  using Allocator = std::allocator<char>;
+};
+
+// Allocate the signal data and handler storage with an allocator (e.g., from an arena), which
+// signals use up front, so they don't need to keep it (moved from signals use a default one)
+template <typename SignalAllocator>
+struct AllocateWith {
+  using PolicyKind = detail::AllocatorPolicyKind;
+  static constexpr bool LAZY_SIGDAT = false;
+  using Allocator = SignalAllocator;
+};
+
+#ifdef TSIG_HAS_MEMORY_RESOURCE
+// Allocate from a std::pmr::memory_resource
+using PmrAllocation = AllocateWith<std::pmr::polymorphic_allocator<char>>;
+#endif
+
+// Exceptions from a handler propagate out of Emit, so later handlers aren't called (the default)
+struct PropagateErrors {
+  using PolicyKind = detail::ErrorPolicyKind;
+  static constexpr bool NOEXCEPT = false;
+
+  template <typename HandlerCall>
+  static void CallHandler(HandlerCall&& handler_call);
+};
+
+// Exceptions from a handler are passed to a default constructed error handler (which is called
+// with the std::exception_ptr), then the later handlers are called as usual
+template <typename ErrorHandler>
+struct CatchErrors {
+  using PolicyKind = detail::ErrorPolicyKind;
+  static constexpr bool NOEXCEPT = false;
+
+  template <typename HandlerCall>
+  static void CallHandler(HandlerCall&& handler_call);
+};
+
+// Exceptions from a handler call std::terminate, so handlers are called without unwind paths
+struct TerminateOnError {
+  using PolicyKind = detail::ErrorPolicyKind;
+  static constexpr bool NOEXCEPT = true;
+
+  template <typename HandlerCall>
+  static void CallHandler(HandlerCall&& handler_call);
+};
+
+// Combiners see each handler result in turn, and return false once the result is known (so the
+// remaining handlers aren't called)
+
+// Results in the first handler result (or a default constructed result if there are no handlers)
+struct FirstResult {
+  using PolicyKind = detail::CombinerPolicyKind;
+
+  template <typename Ret>
+  class Combiner {
+   public:
+    using Result = Ret;
+
+    bool Combine(Ret&& ret);
+    Result Finish();
+
+   private:
+    Result result_{};
+  };
+};
+
+// Results in the last handler result (the default)
+struct LastResult {
+  using PolicyKind = detail::CombinerPolicyKind;
+
+  template <typename Ret>
+  class Combiner {
+   public:
+    using Result = Ret;
+
+    bool Combine(Ret&& ret);
+    Result Finish();
+
+   private:
+    Result result_{};
+  };
+};
+
+// Results in true if any handler result is true (stops at the first true result)
+struct AnyOf {
+  using PolicyKind = detail::CombinerPolicyKind;
+
+  template <typename Ret>
+  class Combiner {
+   public:
+    using Result = bool;
+
+    bool Combine(Ret&& ret);
+    Result Finish();
+
+   private:
+    Result result_ = false;
+  };
+};
+
+// Results in true if all handler results are true (stops at the first false result)
+struct AllOf {
+  using PolicyKind = detail::CombinerPolicyKind;
+
+  template <typename Ret>
+  class Combiner {
+   public:
+    using Result = bool;
+
+    bool Combine(Ret&& ret);
+    Result Finish();
+
+   private:
+    Result result_ = true;
+  };
+};
+
+// Results in the sum of the handler results
+struct SumResults {
+  using PolicyKind = detail::CombinerPolicyKind;
+
+  template <typename Ret>
+  class Combiner {
+   public:
+    using Result = Ret;
+
+    bool Combine(Ret&& ret);
+    Result Finish();
+
+   private:
+    Result result_{};
+  };
+};
+
+// Appends the handler results to a container owned by the caller, resulting in how many
+template <typename Container>
+class ResultCollector {
+ public:
+  using Result = std::size_t;
+
+  explicit ResultCollector(Container& container);
+
+  template <typename Ret>
+  bool Combine(Ret&& ret);
+  Result Finish();
+
+ private:
+  Container* container_ptr_;
+  Result num_results_;
+};
+
+template <typename Container>
+ResultCollector<Container> CollectInto(Container& container);
+
+// A contiguous batch of argument packs, emitted together
+template <typename... Param>
+class Batch {
+ public:
+  using Args = std::tuple<typename std::decay<Param>::type...>;
+
+  Batch(const Args* args_ptr, std::size_t num_args);
+  Batch(const std::vector<Args>& args);
+
+  const Args* begin() const;
+  const Args* end() const;
+  std::size_t size() const;
+  const Args& operator[](std::size_t index) const;
+
+ private:
+  const Args* args_ptr_;
+  std::size_t num_args_;
+};
+
+class Sigcon {
+  template <typename Func, typename... Policies>
+  friend class Signal;
+  template <typename Func, typename... Policies>
   friend class SignalConnector;
+  template <typename Key, typename Func, typename... Policies>
+  friend class KeyedSignal;
+  template <typename T, typename... Policies>
+  friend class CoalescingSignal;
+  friend class SigconGroup;
 
  public:
   Sigcon();
@@ -78,6 +371,12 @@ class Sigcon {
 
   void Reset();
 
+  // Blocked handlers stay connected (in order) but are skipped by emissions, blocking is just a
+  // store, so it's much cheaper than disconnecting and reconnecting
+  void Block();
+  void Unblock();
+  bool IsBlocked() const;
+
  private:
   Sigcon(const std::weak_ptr<detail::SigdatBase>& sigdat_wptr, std::size_t handler_id);
 
@@ -85,100 +384,492 @@ class Sigcon {
   std::size_t handler_id_;
 };
 
-template <typename... Param>
-class Signal<void(Param...)> {
-  friend class SignalConnector<void(Param...)>;
+// Blocks a sigcon for its lifetime, then restores the previous block state
+class SigconBlocker {
+ public:
+  explicit SigconBlocker(Sigcon& sigcon);
+  SigconBlocker(const SigconBlocker&) = delete;
+  ~SigconBlocker();
+
+  SigconBlocker& operator=(const SigconBlocker&) = delete;
+
+ private:
+  Sigcon& sigcon_;
+  bool was_blocked_;
+};
+
+// Owns many sigcons (to any signals), and removes their handlers a signal at a time, so tearing
+// down a group is one lock and one new snapshot per signal, rather than per handler
+class SigconGroup {
+ public:
+  SigconGroup() = default;
+  SigconGroup(const SigconGroup&) = delete;
+  SigconGroup(SigconGroup&& sigcon_group);
+  ~SigconGroup();
+
+  SigconGroup& operator=(const SigconGroup&) = delete;
+  SigconGroup& operator=(SigconGroup&& sigcon_group);
+
+  void Add(Sigcon&& sigcon);
+  std::size_t NumSigcons() const;
+  void Reset();
+
+ private:
+  // The handler IDs of the sigcons to one signal
+  struct SigdatHandlers {
+    std::weak_ptr<detail::SigdatBase> sigdat_wptr;
+    std::vector<std::size_t> handler_ids;
+  };
+
+  std::vector<SigdatHandlers> sigdat_handlers_;
+};
+
+template <typename... Param, typename... Policies>
+class Signal<void(Param...), Policies...>
+    : private detail::SelectPolicy<detail::DispatchPolicyKind, DirectDispatch,
+                                   Policies...>::type {
+  friend class SignalConnector<void(Param...), Policies...>;
 
  public:
-  using Handler = std::function<void(Param...)>;
+  using HandlerPolicy =
+      typename detail::SelectPolicy<detail::HandlerPolicyKind, FunctionHandlers, Policies...>::type;
+  using DispatchPolicy =
+      typename detail::SelectPolicy<detail::DispatchPolicyKind, DirectDispatch, Policies...>::type;
+  using ThreadingPolicy =
+      typename detail::SelectPolicy<detail::ThreadingPolicyKind, SingleThreaded, Policies...>::type;
+  using InstrumentationPolicy = typename detail::SelectPolicy<detail::InstrumentationPolicyKind,
+                                                              NoInstrumentation, Policies...>::type;
+  using AllocatorPolicy = typename detail::SelectPolicy<detail::AllocatorPolicyKind,
+                                                        DefaultAllocation, Policies...>::type;
+  using Allocator = typename AllocatorPolicy::Allocator;
+  using Handler = typename HandlerPolicy::template Handler<void(Param...)>;
+  using BatchHandler = typename HandlerPolicy::template Handler<void(const Batch<Param...>&)>;
 
   Signal();
+  explicit Signal(const Allocator& allocator);
+  template <typename Dispatcher,
+            typename = typename std::enable_if<
+                !std::is_same<Dispatcher, Signal>::value
+                && !std::is_convertible<Dispatcher&, const Allocator&>::value>::type>
+  explicit Signal(Dispatcher& dispatcher);
+  template <typename Dispatcher>
+  Signal(Dispatcher& dispatcher, const Allocator& allocator);
   Signal(const Signal&) = delete;
   Signal(Signal&& signal) = default;
 
   Signal& operator=(const Signal&) = delete;
   Signal& operator=(Signal&& signal) = default;
 
-  TSIG_CHECK_RESULT Sigcon Connect(const Handler& handler);
-  TSIG_CHECK_RESULT Sigcon Connect(Handler&& handler);
+  TSIG_CHECK_RESULT Sigcon Connect(const Handler& handler,
+                                   int priority = DEFAULT_HANDLER_PRIORITY);
+  TSIG_CHECK_RESULT Sigcon Connect(Handler&& handler, int priority = DEFAULT_HANDLER_PRIORITY);
+  // Batch handlers are called once per batch (and with a batch of one for each Emit)
+  TSIG_CHECK_RESULT Sigcon ConnectBatch(const BatchHandler& batch_handler);
+  TSIG_CHECK_RESULT Sigcon ConnectBatch(BatchHandler&& batch_handler);
+  // Tracked handlers are only called while the tracked object is alive (multi threaded signals
+  // keep it alive while called), once it's gone they're removed by the next emission, so they
+  // need no sigcon
+  template <typename Tracked, typename Callable>
+  void Connect(const std::weak_ptr<Tracked>& tracked_wptr, Callable&& callable,
+               int priority = DEFAULT_HANDLER_PRIORITY);
+  template <typename Tracked, typename Callable>
+  void Connect(const std::shared_ptr<Tracked>& tracked_ptr, Callable&& callable,
+               int priority = DEFAULT_HANDLER_PRIORITY);
   void Emit(Param&&... param) const;
+  // Calls each handler over the whole batch in turn, then each batch handler once
+  void EmitBatch(const Batch<Param...>& batch) const;
+  // Awaits the next emission from a coroutine (needs coro.hpp, and C++20)
+  detail::NextAwaiter<detail::Sigdat<void(Param...), Policies...>, Param...> Next();
+
+  // Names the signal in its statistics (which are only recorded if instrumented)
+  void SetName(const std::string& name);
+  SignalStats GetStats() const;
+
+ private:
+  using SigdatType = detail::Sigdat<void(Param...), Policies...>;
+  using BatchSigdat = detail::Sigdat<void(const Batch<Param...>&), Policies...>;
+
+  // Instrumented signals are counted even when idle
+  static constexpr bool LAZY_SIGDAT = ThreadingPolicy::LAZY_SIGDAT
+                                      && !InstrumentationPolicy::ENABLED
+                                      && AllocatorPolicy::LAZY_SIGDAT;
+
+  static std::shared_ptr<SigdatType> MakeSigdat_(const Allocator& allocator);
+
+  const std::shared_ptr<SigdatType>& GetSigdat_();
+
+  void EmitBatchHandlers_(const std::shared_ptr<SigdatType>& sigdat_ptr,
+                          const BatchSigdat& batch_sigdat, Param&... param,
+                          std::true_type /* copyable */) const;
+  void EmitBatchHandlers_(const std::shared_ptr<SigdatType>& sigdat_ptr,
+                          const BatchSigdat& batch_sigdat, Param&... param,
+                          std::false_type /* copyable */) const;
+  void EmitBatch_(const std::shared_ptr<SigdatType>& sigdat_ptr, const Batch<Param...>& batch,
+                  std::true_type /* direct */) const;
+  void EmitBatch_(const std::shared_ptr<SigdatType>& sigdat_ptr, const Batch<Param...>& batch,
+                  std::false_type /* direct */) const;
+  template <std::size_t... indices>
+  void EmitArgs_(const std::shared_ptr<SigdatType>& sigdat_ptr,
+                 const typename Batch<Param...>::Args& args,
+                 detail::IndexSequence<indices...>) const;
+
+  // Null until the first connection (if lazy), so idle signals never allocate
+  std::shared_ptr<SigdatType> sigdat_ptr_;
+};
+
+template <typename Ret, typename... Param, typename... Policies>
+class Signal<Ret(Param...), Policies...> {
+  friend class SignalConnector<Ret(Param...), Policies...>;
+
+ public:
+  using HandlerPolicy =
+      typename detail::SelectPolicy<detail::HandlerPolicyKind, FunctionHandlers, Policies...>::type;
+  using CombinerPolicy =
+      typename detail::SelectPolicy<detail::CombinerPolicyKind, LastResult, Policies...>::type;
+  using ThreadingPolicy =
+      typename detail::SelectPolicy<detail::ThreadingPolicyKind, SingleThreaded, Policies...>::type;
+  using InstrumentationPolicy = typename detail::SelectPolicy<detail::InstrumentationPolicyKind,
+                                                              NoInstrumentation, Policies...>::type;
+  using AllocatorPolicy = typename detail::SelectPolicy<detail::AllocatorPolicyKind,
+                                                        DefaultAllocation, Policies...>::type;
+  using Allocator = typename AllocatorPolicy::Allocator;
+  using Handler = typename HandlerPolicy::template Handler<Ret(Param...)>;
+  using Result = typename CombinerPolicy::template Combiner<Ret>::Result;
+
+  static_assert(std::is_same<typename detail::SelectPolicy<detail::DispatchPolicyKind,
+                                                           DirectDispatch, Policies...>::type,
+                             DirectDispatch>::value,
+                "Signals with results can't be dispatched");
+
+  Signal();
+  explicit Signal(const Allocator& allocator);
+  Signal(const Signal&) = delete;
+  Signal(Signal&& signal) = default;
+
+  Signal& operator=(const Signal&) = delete;
+  Signal& operator=(Signal&& signal) = default;
+
+  TSIG_CHECK_RESULT Sigcon Connect(const Handler& handler,
+                                   int priority = DEFAULT_HANDLER_PRIORITY);
+  TSIG_CHECK_RESULT Sigcon Connect(Handler&& handler, int priority = DEFAULT_HANDLER_PRIORITY);
+  // Combines the results with the combiner policy
+  Result Emit(Param&&... param) const;
+  template <typename OtherCombinerPolicy>
+  typename OtherCombinerPolicy::template Combiner<Ret>::Result EmitWith(Param&&... param) const;
+  // Combines the results with a combiner owned by the caller (e.g., from CollectInto)
+  template <typename Combiner>
+  typename std::decay<Combiner>::type::Result EmitInto(Combiner&& combiner,
+                                                      Param&&... param) const;
+
+  // Names the signal in its statistics (which are only recorded if instrumented)
+  void SetName(const std::string& name);
+  SignalStats GetStats() const;
 
  private:
-  std::shared_ptr<detail::Sigdat<void(Param...)>> sigdat_ptr_;
+  using SigdatType = detail::Sigdat<Ret(Param...), Policies...>;
+
+  // Instrumented signals are counted even when idle
+  static constexpr bool LAZY_SIGDAT = ThreadingPolicy::LAZY_SIGDAT
+                                      && !InstrumentationPolicy::ENABLED
+                                      && AllocatorPolicy::LAZY_SIGDAT;
+
+  static std::shared_ptr<SigdatType> MakeSigdat_(const Allocator& allocator);
+
+  const std::shared_ptr<SigdatType>& GetSigdat_();
+
+  // Null until the first connection (if lazy), so idle signals never allocate
+  std::shared_ptr<SigdatType> sigdat_ptr_;
 };
 
-// template <typename Ret, typename ...Param>
-// class Signal<Ret(Param...)> : private SignalBase {
-// };
+// Makes signals which queue their emissions on a dispatcher
+template <typename Dispatcher>
+class SignalFactory {
+ public:
+  explicit SignalFactory(Dispatcher& dispatcher);
+
+  template <typename Func, typename... Policies>
+  Signal<Func, DispatchWith<Dispatcher>, Policies...> MakeSignal() const;
 
-template <typename Func>
+ private:
+  Dispatcher* dispatcher_ptr_;
+};
+
+template <typename Func, typename... Policies>
 class SignalConnector {
  public:
-  using Handler = typename Signal<Func>::Handler;
+  using Handler = typename Signal<Func, Policies...>::Handler;
 
-  explicit SignalConnector(Signal<Func>& signal);
+  explicit SignalConnector(Signal<Func, Policies...>& signal);
   SignalConnector(const SignalConnector&) = default;
   SignalConnector(SignalConnector&&) = default;
 
   SignalConnector& operator=(const SignalConnector&) = default;
   SignalConnector& operator=(SignalConnector&&) = default;
 
-  TSIG_CHECK_RESULT Sigcon Connect(const Handler& handler);
-  TSIG_CHECK_RESULT Sigcon Connect(Handler&& handler);
+  TSIG_CHECK_RESULT Sigcon Connect(const Handler& handler,
+                                   int priority = DEFAULT_HANDLER_PRIORITY);
+  TSIG_CHECK_RESULT Sigcon Connect(Handler&& handler, int priority = DEFAULT_HANDLER_PRIORITY);
 
   TSIG_CHECK_RESULT Sigcon operator()(const Handler& handler);
   TSIG_CHECK_RESULT Sigcon operator()(Handler&& handler);
 
  private:
-  std::weak_ptr<detail::Sigdat<Func>> sigdat_wptr_;
+  std::weak_ptr<detail::Sigdat<Func, Policies...>> sigdat_wptr_;
 };
 
-template <typename Func>
-SignalConnector<Func> MakeSignalConnector(Signal<Func>& signal);
+template <typename Func, typename... Policies>
+SignalConnector<Func, Policies...> MakeSignalConnector(Signal<Func, Policies...>& signal);
 
 namespace detail {
 
+template <typename PolicyKind, typename DefaultPolicy>
+struct SelectPolicy<PolicyKind, DefaultPolicy> {
+  using type = DefaultPolicy;
+};
+
+template <typename PolicyKind, typename DefaultPolicy, typename Policy, typename... Policies>
+struct SelectPolicy<PolicyKind, DefaultPolicy, Policy, Policies...> {
+  using type = typename std::conditional<
+      std::is_same<typename Policy::PolicyKind, PolicyKind>::value, Policy,
+      typename SelectPolicy<PolicyKind, DefaultPolicy, Policies...>::type>::type;
+};
+
+template <std::size_t...>
+struct IndexSequence {
+  // Empty
+};
+
+template <std::size_t num, std::size_t... indices>
+struct MakeIndexSequence : MakeIndexSequence<num - 1, num - 1, indices...> {
+  // Empty
+};
+
+template <std::size_t... indices>
+struct MakeIndexSequence<0, indices...> {
+  using type = IndexSequence<indices...>;
+};
+
+template <typename SigdatType, typename... Param>
+class DeferredEmit {
+ public:
+  template <typename... Arg>
+  explicit DeferredEmit(const std::shared_ptr<SigdatType>& sigdat_ptr, Arg&&... arg);
+
+  void operator()();
+
+ private:
+  template <std::size_t... indices>
+  void CallHandlers_(IndexSequence<indices...>);
+
+  // Weak, so emissions still in the queue won't keep a dropped signal alive
+  std::weak_ptr<SigdatType> sigdat_wptr_;
+  std::tuple<typename std::decay<Param>::type...> args_;
+};
+
+// Waiters are linked into the sigdat, so waiting needs no handler, sigcon, or allocation
+template <typename... Param>
+struct EmitWaiter {
+  virtual void Wake(const typename std::decay<Param>::type&... param) = 0;
+
+  EmitWaiter* next_ptr = nullptr;
+  // Points at whatever points at this waiter (null if it isn't waiting)
+  EmitWaiter** prev_next_ptr = nullptr;
+
+ protected:
+  ~EmitWaiter() = default;
+};
+
 class SigdatBase {
  public:
   virtual ~SigdatBase() = default;
   virtual void RemoveHandler(std::size_t handler_id) = 0;
+  virtual void RemoveHandlers(const std::size_t* handler_ids, std::size_t num_handler_ids) = 0;
+  virtual bool IsHandlerBlocked(std::size_t handler_id) = 0;
+  virtual void SetHandlerBlocked(std::size_t handler_id, bool blocked) = 0;
 };
 
-template <typename... Param>
-class Sigdat<void(Param...)> final : public SigdatBase {
+template <typename Ret, typename... Param, typename... Policies>
+class Sigdat<Ret(Param...), Policies...> final
+    : public SigdatBase,
+      private SelectPolicy<InstrumentationPolicyKind, NoInstrumentation,
+                           Policies...>::type::SignalRecorder {
  public:
-  using Handler = std::function<void(Param...)>;
-
-  std::size_t AddHandler(const Handler& handler);
-  std::size_t AddHandler(Handler&& handler);
-  void CallHandlers(Param&&... param) const;
+  using HandlerPolicy =
+      typename SelectPolicy<HandlerPolicyKind, FunctionHandlers, Policies...>::type;
+  using Handler = typename HandlerPolicy::template Handler<Ret(Param...)>;
+  using ThreadingPolicy =
+      typename SelectPolicy<ThreadingPolicyKind, SingleThreaded, Policies...>::type;
+  using InstrumentationPolicy =
+      typename SelectPolicy<InstrumentationPolicyKind, NoInstrumentation, Policies...>::type;
+  using SignalRecorder = typename InstrumentationPolicy::SignalRecorder;
+  using ErrorPolicy = typename SelectPolicy<ErrorPolicyKind, PropagateErrors, Policies...>::type;
+  using AllocatorPolicy =
+      typename SelectPolicy<AllocatorPolicyKind, DefaultAllocation, Policies...>::type;
+  using Allocator = typename AllocatorPolicy::Allocator;
+
+  Sigdat();
+  explicit Sigdat(const Allocator& allocator);
+
+  using SignalRecorder::SetName;
+  using SignalRecorder::GetStats;
+
+  std::size_t AddHandler(const Handler& handler, int priority = DEFAULT_HANDLER_PRIORITY);
+  std::size_t AddHandler(Handler&& handler, int priority = DEFAULT_HANDLER_PRIORITY);
+  // Tracked handlers note when the tracked object is gone, and are removed after the emission
+  template <typename Tracked, typename Callable>
+  std::size_t AddTrackedHandler(const std::weak_ptr<Tracked>& tracked_wptr, Callable&& callable,
+                                int priority = DEFAULT_HANDLER_PRIORITY);
+  // Only noexcept with the terminate error policy, which needs no unwind paths
+  void CallHandlers(Param&&... param) const noexcept(ErrorPolicy::NOEXCEPT);
+  template <typename BatchType>
+  void CallHandlersOver(const BatchType& batch) const noexcept(ErrorPolicy::NOEXCEPT);
+  template <typename Combiner>
+  void CombineHandlers(Combiner& combiner, Param&&... param) const
+      noexcept(ErrorPolicy::NOEXCEPT);
   void RemoveHandler(std::size_t handler_id) final;
+  // Waiters are woken (once) by the next emission, before the handlers are called
+  void AddWaiter(EmitWaiter<Param...>* waiter_ptr);
+  void RemoveWaiter(EmitWaiter<Param...>* waiter_ptr);
+  // Removes all the handlers together, publishing only one new snapshot
+  void RemoveHandlers(const std::size_t* handler_ids, std::size_t num_handler_ids) final;
+  bool IsHandlerBlocked(std::size_t handler_id) final;
+  void SetHandlerBlocked(std::size_t handler_id, bool blocked) final;
+  // Whether any handlers are connected (batch handlers are kept elsewhere)
+  bool HasHandlers() const;
+
+  // Batch handlers are kept in another sigdat, which is made on first use and lives as long as
+  // this one (it's returned as null if there isn't one yet)
+  template <typename BatchSigdat>
+  std::shared_ptr<BatchSigdat> MakeBatchSigdat();
+  template <typename BatchSigdat>
+  const BatchSigdat* GetBatchSigdat() const;
 
  private:
-  std::size_t incremental_handler_id_ = 0u;
-  std::map<std::size_t, std::shared_ptr<Handler>> handler_ptrs_;
+  // Handler IDs pack a slot index into the low bits and a generation into the high bits
+  static constexpr unsigned SLOT_INDEX_BITS = std::numeric_limits<std::size_t>::digits / 2;
+  static constexpr std::size_t SLOT_INDEX_MASK = (std::size_t(1) << SLOT_INDEX_BITS) - 1u;
+  static constexpr std::size_t DEAD_SLOT_INDEX = SLOT_INDEX_MASK;
+
+  // Entries are stored contiguously in connection order, dead entries are compacted lazily
+  // (the recorder is a base, so it takes no space when it records nothing)
+  struct HandlerEntry : SignalRecorder::HandlerRecorder {
+    using HandlerRecorder = typename SignalRecorder::HandlerRecorder;
+    using HandlerPool = typename ThreadingPolicy::template HandlerPool<Handler, Allocator>;
+    using HandlerCell = typename HandlerPool::Cell;
+
+    HandlerEntry(std::size_t slot_index, HandlerCell&& handler_cell,
+                 HandlerRecorder&& handler_recorder);
+
+    std::size_t slot_index;
+    HandlerCell handler_cell;
+  };
+
+  // Slots map a handler ID to the current index of its entry (the priority is only needed to
+  // connect, so it's kept here rather than in the entries walked by every emission)
+  struct HandlerSlot {
+    std::size_t entry_index;
+    std::size_t generation;
+    int priority;
+  };
+
+  template <typename T>
+  using AllocatorFor = typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+  using HandlerList = std::vector<HandlerEntry, AllocatorFor<HandlerEntry>>;
+
+  // Calls the callable while the tracked object is alive, or notes that it's expired
+  template <typename Tracked, typename Callable>
+  class TrackedHandler {
+   public:
+    TrackedHandler(const Sigdat* sigdat_ptr, std::size_t handler_id,
+                   const std::weak_ptr<Tracked>& tracked_wptr, Callable callable);
+
+    template <typename... Arg>
+    void operator()(Arg&&... arg) const;
+
+   private:
+    const Sigdat* sigdat_ptr_;
+    std::size_t handler_id_;
+    std::weak_ptr<Tracked> tracked_wptr_;
+    Callable callable_;
+  };
+
+  // The handler is made with its handler ID, which tracked handlers need to note their expiry
+  template <typename MakeHandler>
+  std::size_t AddHandlerEntry_(MakeHandler&& make_handler, int priority);
+  using HandlerPool = typename HandlerEntry::HandlerPool;
+  using HandlerCell = typename HandlerEntry::HandlerCell;
+
+  bool IsLiveHandlerId_(std::size_t handler_id) const;
+  HandlerEntry* FindHandlerEntry_(std::size_t handler_id);
+  typename HandlerCell::DisconnectToken KillHandlerEntry_(HandlerList& handlers,
+                                                          std::size_t handler_id);
+
+  HandlerList& BeginModifyHandlers_();
+  void CopyLiveHandlers_(const HandlerList& handlers, HandlerList& live_handlers);
+  void CompactHandlers_(HandlerList& handlers);
+  template <typename Args, std::size_t... indices>
+  static void CallHandlerWith_(const Handler& handler, const Args& args,
+                               IndexSequence<indices...>);
+  // Errors from the combiner are kept from the error policy, to be passed on after the call
+  template <typename Combiner, typename Result>
+  static bool CombineResult_(Combiner& combiner, Result&& result, std::exception_ptr& error_ptr,
+                             std::false_type /* noexcept */);
+  // Noexcept policies never catch, so the combiner is called directly
+  template <typename Combiner, typename Result>
+  static bool CombineResult_(Combiner& combiner, Result&& result, std::exception_ptr& error_ptr,
+                             std::true_type /* noexcept */);
+  void WakeWaiters_(const typename std::decay<Param>::type&... param) const;
+  template <typename Args, std::size_t... indices>
+  void WakeWaitersWith_(const Args& args, IndexSequence<indices...>) const;
+  void UnlinkWaiter_(EmitWaiter<Param...>* waiter_ptr) const;
+  void NoteExpiredHandler_(std::size_t handler_id) const;
+  void RemoveExpiredHandlers_() const;
+
+  // Guards everything but the snapshot readers (does nothing if single threaded)
+  mutable typename ThreadingPolicy::Mutex mutex_;
+  std::vector<HandlerSlot, AllocatorFor<HandlerSlot>> handler_slots_;
+  std::vector<std::size_t, AllocatorFor<std::size_t>> free_slot_indices_;
+  std::size_t num_dead_entries_ = 0u;
+  // No handler has a lower priority, so handlers at or below it are just appended
+  int lowest_priority_ = std::numeric_limits<int>::max();
+  // Handlers are shared between snapshots, so the pool outlives them (emissions hold the signal
+  // data, so their snapshots are released first)
+  HandlerPool handler_pool_;
+  // A snapshot of the handlers, shared with any emissions in flight
+  typename ThreadingPolicy::template Snapshot<HandlerList, AllocatorFor<HandlerList>>
+      handlers_snapshot_;
+  std::shared_ptr<SigdatBase> batch_sigdat_ptr_;
+  std::atomic<SigdatBase*> batch_sigdat_raw_ptr_{nullptr};
+  // Waiters in waiting order, emissions only take the lock if there are any
+  mutable EmitWaiter<Param...>* waiters_head_ptr_ = nullptr;
+  mutable EmitWaiter<Param...>** waiters_tail_ptr_ = &waiters_head_ptr_;
+  mutable std::atomic<bool> has_waiters_{false};
+  // Tracked handlers noted as expired, emissions only take the lock if there are any
+  mutable std::vector<std::size_t, AllocatorFor<std::size_t>> expired_handler_ids_;
+  mutable std::atomic<bool> has_expired_handlers_{false};
 };
 
 }  // namespace detail
 
-Sigcon::Sigcon() : handler_id_(detail::INVALID_HANDLER_ID)
+inline Sigcon::Sigcon() : handler_id_(detail::INVALID_HANDLER_ID)
 {
   // Do nothing
 }
 
-Sigcon::Sigcon(const std::weak_ptr<detail::SigdatBase>& sigdat_wptr, std::size_t handler_id)
+inline Sigcon::Sigcon(const std::weak_ptr<detail::SigdatBase>& sigdat_wptr, std::size_t handler_id)
     : sigdat_wptr_(sigdat_wptr), handler_id_(handler_id)
 {
   // Do nothing
 }
 
-Sigcon::Sigcon(Sigcon&& sigcon) : sigdat_wptr_(sigcon.sigdat_wptr_), handler_id_(sigcon.handler_id_)
+inline Sigcon::Sigcon(Sigcon&& sigcon)
+    : sigdat_wptr_(sigcon.sigdat_wptr_), handler_id_(sigcon.handler_id_)
 {
   sigcon.sigdat_wptr_.reset();
   sigcon.handler_id_ = detail::INVALID_HANDLER_ID;
 }
 
-Sigcon::~Sigcon()
+inline Sigcon::~Sigcon()
 {
   const std::shared_ptr<detail::SigdatBase> sigdat_ptr = sigdat_wptr_.lock();
   if (sigdat_ptr) {
@@ -186,7 +877,7 @@ Sigcon::~Sigcon()
   }
 }
 
-Sigcon& Sigcon::operator=(Sigcon&& sigcon)
+inline Sigcon& Sigcon::operator=(Sigcon&& sigcon)
 {
   // Remove the handler if there was one
   const std::shared_ptr<detail::SigdatBase> sigdat_ptr = sigdat_wptr_.lock();
@@ -202,7 +893,7 @@ Sigcon& Sigcon::operator=(Sigcon&& sigcon)
   return *this;
 }
 
-void Sigcon::Reset()
+inline void Sigcon::Reset()
 {
   // Remove the handler if there was one
   const std::shared_ptr<detail::SigdatBase> sigdat_ptr = sigdat_wptr_.lock();
@@ -214,111 +905,1236 @@ void Sigcon::Reset()
   handler_id_ = detail::INVALID_HANDLER_ID;
 }
 
-template <typename... Param>
-Signal<void(Param...)>::Signal() : sigdat_ptr_(std::make_shared<detail::Sigdat<void(Param...)>>())
+inline void Sigcon::Block()
+{
+  const std::shared_ptr<detail::SigdatBase> sigdat_ptr = sigdat_wptr_.lock();
+  if (sigdat_ptr) {
+    sigdat_ptr->SetHandlerBlocked(handler_id_, true);
+  }
+}
+
+inline void Sigcon::Unblock()
+{
+  const std::shared_ptr<detail::SigdatBase> sigdat_ptr = sigdat_wptr_.lock();
+  if (sigdat_ptr) {
+    sigdat_ptr->SetHandlerBlocked(handler_id_, false);
+  }
+}
+
+inline bool Sigcon::IsBlocked() const
+{
+  const std::shared_ptr<detail::SigdatBase> sigdat_ptr = sigdat_wptr_.lock();
+  return sigdat_ptr && sigdat_ptr->IsHandlerBlocked(handler_id_);
+}
+
+inline SigconBlocker::SigconBlocker(Sigcon& sigcon)
+    : sigcon_(sigcon), was_blocked_(sigcon.IsBlocked())
+{
+  sigcon_.Block();
+}
+
+inline SigconBlocker::~SigconBlocker()
+{
+  if (!was_blocked_) {
+    sigcon_.Unblock();
+  }
+}
+
+inline SigconGroup::SigconGroup(SigconGroup&& sigcon_group)
+    : sigdat_handlers_(std::move(sigcon_group.sigdat_handlers_))
+{
+  sigcon_group.sigdat_handlers_.clear();
+}
+
+inline SigconGroup::~SigconGroup()
+{
+  Reset();
+}
+
+inline SigconGroup& SigconGroup::operator=(SigconGroup&& sigcon_group)
+{
+  // Remove the handlers if there were any
+  Reset();
+  sigdat_handlers_ = std::move(sigcon_group.sigdat_handlers_);
+  sigcon_group.sigdat_handlers_.clear();
+  return *this;
+}
+
+inline void SigconGroup::Add(Sigcon&& sigcon)
+{
+  if (sigcon.handler_id_ == detail::INVALID_HANDLER_ID) {
+    return;
+  }
+  // Sigcons to the same signal are usually added together, so search from the back
+  const auto same_sigdat = [&sigcon](const SigdatHandlers& sigdat_handlers) {
+    return !sigdat_handlers.sigdat_wptr.owner_before(sigcon.sigdat_wptr_)
+           && !sigcon.sigdat_wptr_.owner_before(sigdat_handlers.sigdat_wptr);
+  };
+  const auto rev_iter =
+      std::find_if(sigdat_handlers_.rbegin(), sigdat_handlers_.rend(), same_sigdat);
+  if (rev_iter != sigdat_handlers_.rend()) {
+    rev_iter->handler_ids.push_back(sigcon.handler_id_);
+  }
+  else {
+    sigdat_handlers_.push_back({std::move(sigcon.sigdat_wptr_), {sigcon.handler_id_}});
+  }
+  // The group owns the handler now
+  sigcon.sigdat_wptr_.reset();
+  sigcon.handler_id_ = detail::INVALID_HANDLER_ID;
+}
+
+inline std::size_t SigconGroup::NumSigcons() const
+{
+  std::size_t num_sigcons = 0u;
+  for (const SigdatHandlers& sigdat_handlers : sigdat_handlers_) {
+    num_sigcons += sigdat_handlers.handler_ids.size();
+  }
+  return num_sigcons;
+}
+
+inline void SigconGroup::Reset()
+{
+  for (const SigdatHandlers& sigdat_handlers : sigdat_handlers_) {
+    const std::shared_ptr<detail::SigdatBase> sigdat_ptr = sigdat_handlers.sigdat_wptr.lock();
+    if (sigdat_ptr) {
+      sigdat_ptr->RemoveHandlers(sigdat_handlers.handler_ids.data(),
+                                 sigdat_handlers.handler_ids.size());
+    }
+  }
+  sigdat_handlers_.clear();
+}
+
+template <typename... Param, typename... Policies>
+Signal<void(Param...), Policies...>::Signal()
+    : sigdat_ptr_(LAZY_SIGDAT ? nullptr : MakeSigdat_(Allocator()))
 {
   // Do nothing
 }
 
-template <typename... Param>
-Sigcon Signal<void(Param...)>::Connect(const Signal::Handler& handler)
+template <typename... Param, typename... Policies>
+Signal<void(Param...), Policies...>::Signal(const Allocator& allocator)
+    : sigdat_ptr_(LAZY_SIGDAT ? nullptr : MakeSigdat_(allocator))
+{
+  // Do nothing
+}
+
+template <typename... Param, typename... Policies>
+template <typename Dispatcher, typename>
+Signal<void(Param...), Policies...>::Signal(Dispatcher& dispatcher)
+    : DispatchPolicy(dispatcher), sigdat_ptr_(LAZY_SIGDAT ? nullptr : MakeSigdat_(Allocator()))
+{
+  // Do nothing
+}
+
+template <typename... Param, typename... Policies>
+template <typename Dispatcher>
+Signal<void(Param...), Policies...>::Signal(Dispatcher& dispatcher, const Allocator& allocator)
+    : DispatchPolicy(dispatcher), sigdat_ptr_(LAZY_SIGDAT ? nullptr : MakeSigdat_(allocator))
+{
+  // Do nothing
+}
+
+template <typename... Param, typename... Policies>
+Sigcon Signal<void(Param...), Policies...>::Connect(const Signal::Handler& handler, int priority)
 {
-  const std::size_t handler_id = sigdat_ptr_->AddHandler(handler);
+  const std::size_t handler_id = GetSigdat_()->AddHandler(handler, priority);
   return Sigcon(sigdat_ptr_, handler_id);
 }
 
-template <typename... Param>
-Sigcon Signal<void(Param...)>::Connect(Signal::Handler&& handler)
+template <typename... Param, typename... Policies>
+Sigcon Signal<void(Param...), Policies...>::Connect(Signal::Handler&& handler, int priority)
 {
-  const std::size_t handler_id = sigdat_ptr_->AddHandler(std::move(handler));
+  const std::size_t handler_id = GetSigdat_()->AddHandler(std::move(handler), priority);
   return Sigcon(sigdat_ptr_, handler_id);
 }
 
-template <typename... Param>
-void Signal<void(Param...)>::Emit(Param&&... param) const
+template <typename... Param, typename... Policies>
+Sigcon Signal<void(Param...), Policies...>::ConnectBatch(const BatchHandler& batch_handler)
 {
-  sigdat_ptr_->CallHandlers(std::forward<Param>(param)...);
+  return ConnectBatch(BatchHandler(batch_handler));
 }
 
-template <typename Func>
-SignalConnector<Func>::SignalConnector(Signal<Func>& signal) : sigdat_wptr_(signal.sigdat_ptr_)
+template <typename... Param, typename... Policies>
+Sigcon Signal<void(Param...), Policies...>::ConnectBatch(BatchHandler&& batch_handler)
 {
-  // Do nothing
+  static_assert(std::is_same<DispatchPolicy, DirectDispatch>::value,
+                "Dispatched signals can't have batch handlers");
+  // Each Emit copies its arguments into a batch of one
+  static_assert(std::is_constructible<typename Batch<Param...>::Args, Param&...>::value,
+                "Signals with uncopyable arguments can't have batch handlers");
+  const std::shared_ptr<BatchSigdat> batch_sigdat_ptr =
+      GetSigdat_()->template MakeBatchSigdat<BatchSigdat>();
+  const std::size_t handler_id = batch_sigdat_ptr->AddHandler(std::move(batch_handler));
+  return Sigcon(batch_sigdat_ptr, handler_id);
 }
 
-template <typename Func>
-Sigcon SignalConnector<Func>::Connect(const Handler& handler)
+template <typename... Param, typename... Policies>
+template <typename Tracked, typename Callable>
+void Signal<void(Param...), Policies...>::Connect(const std::weak_ptr<Tracked>& tracked_wptr,
+                                                  Callable&& callable, int priority)
 {
-  const std::shared_ptr<detail::Sigdat<Func>> sigdat_ptr = sigdat_wptr_.lock();
-  if (!sigdat_ptr) {
-    return {};
+  GetSigdat_()->AddTrackedHandler(tracked_wptr, std::forward<Callable>(callable), priority);
+}
+
+template <typename... Param, typename... Policies>
+template <typename Tracked, typename Callable>
+void Signal<void(Param...), Policies...>::Connect(const std::shared_ptr<Tracked>& tracked_ptr,
+                                                  Callable&& callable, int priority)
+{
+  Connect(std::weak_ptr<Tracked>(tracked_ptr), std::forward<Callable>(callable), priority);
+}
+
+template <typename... Param, typename... Policies>
+void Signal<void(Param...), Policies...>::Emit(Param&&... param) const
+{
+  // Nothing was ever connected
+  if (!sigdat_ptr_) {
+    return;
   }
-  const std::size_t handler_id = sigdat_ptr->AddHandler(handler);
-  return Sigcon(sigdat_ptr, handler_id);
+  // Hold the signal data, in case a handler destroys the signal
+  const std::shared_ptr<SigdatType> sigdat_ptr = sigdat_ptr_;
+  const BatchSigdat* const batch_sigdat_ptr = sigdat_ptr->template GetBatchSigdat<BatchSigdat>();
+  if (batch_sigdat_ptr) {
+    using Copyable = std::is_constructible<typename Batch<Param...>::Args, Param&...>;
+    EmitBatchHandlers_(sigdat_ptr, *batch_sigdat_ptr, param..., Copyable());
+    return;
+  }
+  DispatchPolicy::Emit(sigdat_ptr, std::forward<Param>(param)...);
 }
 
-template <typename Func>
-Sigcon SignalConnector<Func>::Connect(Handler&& handler)
+template <typename... Param, typename... Policies>
+void Signal<void(Param...), Policies...>::EmitBatch(const Batch<Param...>& batch) const
 {
-  const std::shared_ptr<detail::Sigdat<Func>> sigdat_ptr = sigdat_wptr_.lock();
-  if (!sigdat_ptr) {
-    return {};
+  if (!sigdat_ptr_) {
+    return;
   }
-  const std::size_t handler_id = sigdat_ptr->AddHandler(std::move(handler));
-  return Sigcon(sigdat_ptr, handler_id);
+  const std::shared_ptr<SigdatType> sigdat_ptr = sigdat_ptr_;
+  EmitBatch_(sigdat_ptr, batch, std::is_same<DispatchPolicy, DirectDispatch>());
 }
 
-template <typename Func>
-Sigcon SignalConnector<Func>::operator()(const Handler& handler)
+template <typename... Param, typename... Policies>
+void Signal<void(Param...), Policies...>::SetName(const std::string& name)
 {
-  return Connect(handler);
+  // Uninstrumented signals have nothing to name
+  if (sigdat_ptr_) {
+    sigdat_ptr_->SetName(name);
+  }
 }
 
-template <typename Func>
-Sigcon SignalConnector<Func>::operator()(Handler&& handler)
+template <typename... Param, typename... Policies>
+SignalStats Signal<void(Param...), Policies...>::GetStats() const
 {
-  return Connect(std::move(handler));
+  return sigdat_ptr_ ? sigdat_ptr_->GetStats() : SignalStats();
 }
 
-template <typename Func>
-SignalConnector<Func> MakeSignalConnector(Signal<Func>& signal)
+template <typename... Param, typename... Policies>
+const std::shared_ptr<typename Signal<void(Param...), Policies...>::SigdatType>&
+Signal<void(Param...), Policies...>::GetSigdat_()
 {
-  return SignalConnector<Func>(signal);
+  if (!sigdat_ptr_) {
+    sigdat_ptr_ = MakeSigdat_(Allocator());
+  }
+  return sigdat_ptr_;
 }
 
-namespace detail {
+template <typename... Param, typename... Policies>
+std::shared_ptr<typename Signal<void(Param...), Policies...>::SigdatType>
+Signal<void(Param...), Policies...>::MakeSigdat_(const Allocator& allocator)
+{
+  return std::allocate_shared<SigdatType>(allocator, allocator);
+}
 
-template <typename... Param>
-std::size_t Sigdat<void(Param...)>::AddHandler(const Handler& handler)
+template <typename... Param, typename... Policies>
+void Signal<void(Param...), Policies...>::EmitBatchHandlers_(
+    const std::shared_ptr<SigdatType>& sigdat_ptr, const BatchSigdat& batch_sigdat,
+    Param&... param, std::true_type /* copyable */) const
 {
-  handler_ptrs_.emplace(incremental_handler_id_, std::make_shared<Handler>(handler));
-  return incremental_handler_id_++;
+  // Copy the arguments before the handlers can move them
+  const typename Batch<Param...>::Args args(param...);
+  DispatchPolicy::Emit(sigdat_ptr, std::forward<Param>(param)...);
+  batch_sigdat.CallHandlers(Batch<Param...>(&args, 1u));
 }
 
-template <typename... Param>
-std::size_t Sigdat<void(Param...)>::AddHandler(Handler&& handler)
+template <typename... Param, typename... Policies>
+void Signal<void(Param...), Policies...>::EmitBatchHandlers_(
+    const std::shared_ptr<SigdatType>& sigdat_ptr, const BatchSigdat&, Param&... param,
+    std::false_type /* copyable */) const
 {
-  handler_ptrs_.emplace(incremental_handler_id_, std::make_shared<Handler>(std::move(handler)));
-  return incremental_handler_id_++;
+  // Never reached, ConnectBatch won't compile for signals with uncopyable arguments
+  DispatchPolicy::Emit(sigdat_ptr, std::forward<Param>(param)...);
 }
 
-template <typename... Param>
-void Sigdat<void(Param...)>::CallHandlers(Param&&... param) const
+template <typename... Param, typename... Policies>
+void Signal<void(Param...), Policies...>::EmitBatch_(const std::shared_ptr<SigdatType>& sigdat_ptr,
+                                                     const Batch<Param...>& batch,
+                                                     std::true_type /* direct */) const
 {
-  // Copy handlers to prevent in-flight modifications
-  const auto handler_ptrs = handler_ptrs_;
-  // TODO It would be more efficient to only copy if a modification takes place
-  for (const auto& handler_pair : handler_ptrs) {
-    const std::shared_ptr<Handler> handler_ptr = std::get<1>(handler_pair);
-    // TODO Better exception handling
-    (*handler_ptr)(std::forward<Param>(param)...);
+  sigdat_ptr->CallHandlersOver(batch);
+  const BatchSigdat* const batch_sigdat_ptr = sigdat_ptr->template GetBatchSigdat<BatchSigdat>();
+  if (batch_sigdat_ptr) {
+    batch_sigdat_ptr->CallHandlers(batch);
   }
 }
 
-template <typename... Param>
-void Sigdat<void(Param...)>::RemoveHandler(std::size_t handler_id)
+template <typename... Param, typename... Policies>
+void Signal<void(Param...), Policies...>::EmitBatch_(const std::shared_ptr<SigdatType>& sigdat_ptr,
+                                                     const Batch<Param...>& batch,
+                                                     std::false_type /* direct */) const
 {
-  handler_ptrs_.erase(handler_id);
+  // Dispatched emissions need their own copy of the arguments anyway, so emit them one by one
+  for (const typename Batch<Param...>::Args& args : batch) {
+    EmitArgs_(sigdat_ptr, args, typename detail::MakeIndexSequence<sizeof...(Param)>::type());
+  }
+}
+
+template <typename... Param, typename... Policies>
+template <std::size_t... indices>
+void Signal<void(Param...), Policies...>::EmitArgs_(const std::shared_ptr<SigdatType>& sigdat_ptr,
+                                                    const typename Batch<Param...>::Args& args,
+                                                    detail::IndexSequence<indices...>) const
+{
+  // Pass copies, since the handlers could move the arguments
+  DispatchPolicy::Emit(
+      sigdat_ptr,
+      static_cast<Param&&>(typename std::decay<Param>::type(std::get<indices>(args)))...);
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+Signal<Ret(Param...), Policies...>::Signal()
+    : sigdat_ptr_(LAZY_SIGDAT ? nullptr : MakeSigdat_(Allocator()))
+{
+  // Do nothing
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+Signal<Ret(Param...), Policies...>::Signal(const Allocator& allocator)
+    : sigdat_ptr_(LAZY_SIGDAT ? nullptr : MakeSigdat_(allocator))
+{
+  // Do nothing
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+Sigcon Signal<Ret(Param...), Policies...>::Connect(const Signal::Handler& handler, int priority)
+{
+  const std::size_t handler_id = GetSigdat_()->AddHandler(handler, priority);
+  return Sigcon(sigdat_ptr_, handler_id);
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+Sigcon Signal<Ret(Param...), Policies...>::Connect(Signal::Handler&& handler, int priority)
+{
+  const std::size_t handler_id = GetSigdat_()->AddHandler(std::move(handler), priority);
+  return Sigcon(sigdat_ptr_, handler_id);
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+typename Signal<Ret(Param...), Policies...>::Result Signal<Ret(Param...), Policies...>::Emit(
+    Param&&... param) const
+{
+  return EmitWith<CombinerPolicy>(std::forward<Param>(param)...);
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+template <typename OtherCombinerPolicy>
+typename OtherCombinerPolicy::template Combiner<Ret>::Result
+Signal<Ret(Param...), Policies...>::EmitWith(Param&&... param) const
+{
+  typename OtherCombinerPolicy::template Combiner<Ret> combiner;
+  if (sigdat_ptr_) {
+    // Hold the signal data, in case a handler destroys the signal
+    const std::shared_ptr<SigdatType> sigdat_ptr = sigdat_ptr_;
+    sigdat_ptr->CombineHandlers(combiner, std::forward<Param>(param)...);
+  }
+  return combiner.Finish();
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+template <typename Combiner>
+typename std::decay<Combiner>::type::Result Signal<Ret(Param...), Policies...>::EmitInto(
+    Combiner&& combiner, Param&&... param) const
+{
+  if (sigdat_ptr_) {
+    const std::shared_ptr<SigdatType> sigdat_ptr = sigdat_ptr_;
+    sigdat_ptr->CombineHandlers(combiner, std::forward<Param>(param)...);
+  }
+  return combiner.Finish();
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+void Signal<Ret(Param...), Policies...>::SetName(const std::string& name)
+{
+  // Uninstrumented signals have nothing to name
+  if (sigdat_ptr_) {
+    sigdat_ptr_->SetName(name);
+  }
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+SignalStats Signal<Ret(Param...), Policies...>::GetStats() const
+{
+  return sigdat_ptr_ ? sigdat_ptr_->GetStats() : SignalStats();
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+const std::shared_ptr<typename Signal<Ret(Param...), Policies...>::SigdatType>&
+Signal<Ret(Param...), Policies...>::GetSigdat_()
+{
+  if (!sigdat_ptr_) {
+    sigdat_ptr_ = MakeSigdat_(Allocator());
+  }
+  return sigdat_ptr_;
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+std::shared_ptr<typename Signal<Ret(Param...), Policies...>::SigdatType>
+Signal<Ret(Param...), Policies...>::MakeSigdat_(const Allocator& allocator)
+{
+  return std::allocate_shared<SigdatType>(allocator, allocator);
+}
+
+template <typename Ret>
+bool FirstResult::Combiner<Ret>::Combine(Ret&& ret)
+{
+  result_ = std::forward<Ret>(ret);
+  return false;
+}
+
+template <typename Ret>
+typename FirstResult::Combiner<Ret>::Result FirstResult::Combiner<Ret>::Finish()
+{
+  return std::move(result_);
+}
+
+template <typename Ret>
+bool LastResult::Combiner<Ret>::Combine(Ret&& ret)
+{
+  result_ = std::forward<Ret>(ret);
+  return true;
+}
+
+template <typename Ret>
+typename LastResult::Combiner<Ret>::Result LastResult::Combiner<Ret>::Finish()
+{
+  return std::move(result_);
+}
+
+template <typename Ret>
+bool AnyOf::Combiner<Ret>::Combine(Ret&& ret)
+{
+  result_ = static_cast<bool>(ret);
+  return !result_;
+}
+
+template <typename Ret>
+typename AnyOf::Combiner<Ret>::Result AnyOf::Combiner<Ret>::Finish()
+{
+  return result_;
+}
+
+template <typename Ret>
+bool AllOf::Combiner<Ret>::Combine(Ret&& ret)
+{
+  result_ = static_cast<bool>(ret);
+  return result_;
+}
+
+template <typename Ret>
+typename AllOf::Combiner<Ret>::Result AllOf::Combiner<Ret>::Finish()
+{
+  return result_;
+}
+
+template <typename Ret>
+bool SumResults::Combiner<Ret>::Combine(Ret&& ret)
+{
+  result_ += std::forward<Ret>(ret);
+  return true;
+}
+
+template <typename Ret>
+typename SumResults::Combiner<Ret>::Result SumResults::Combiner<Ret>::Finish()
+{
+  return result_;
+}
+
+template <typename... Param>
+Batch<Param...>::Batch(const Args* args_ptr, std::size_t num_args)
+    : args_ptr_(args_ptr), num_args_(num_args)
+{
+  // Do nothing
+}
+
+template <typename... Param>
+Batch<Param...>::Batch(const std::vector<Args>& args)
+    : args_ptr_(args.data()), num_args_(args.size())
+{
+  // Do nothing
+}
+
+template <typename... Param>
+const typename Batch<Param...>::Args* Batch<Param...>::begin() const
+{
+  return args_ptr_;
+}
+
+template <typename... Param>
+const typename Batch<Param...>::Args* Batch<Param...>::end() const
+{
+  return args_ptr_ + num_args_;
+}
+
+template <typename... Param>
+std::size_t Batch<Param...>::size() const
+{
+  return num_args_;
+}
+
+template <typename... Param>
+const typename Batch<Param...>::Args& Batch<Param...>::operator[](std::size_t index) const
+{
+  return args_ptr_[index];
+}
+
+template <typename Container>
+ResultCollector<Container>::ResultCollector(Container& container)
+    : container_ptr_(&container), num_results_(0u)
+{
+  // Do nothing
+}
+
+template <typename Container>
+template <typename Ret>
+bool ResultCollector<Container>::Combine(Ret&& ret)
+{
+  container_ptr_->insert(container_ptr_->end(), std::forward<Ret>(ret));
+  ++num_results_;
+  return true;
+}
+
+template <typename Container>
+typename ResultCollector<Container>::Result ResultCollector<Container>::Finish()
+{
+  return num_results_;
+}
+
+template <typename Container>
+ResultCollector<Container> CollectInto(Container& container)
+{
+  return ResultCollector<Container>(container);
+}
+
+template <typename HandlerCall>
+void PropagateErrors::CallHandler(HandlerCall&& handler_call)
+{
+  handler_call();
+}
+
+template <typename ErrorHandler>
+template <typename HandlerCall>
+void CatchErrors<ErrorHandler>::CallHandler(HandlerCall&& handler_call)
+{
+  try {
+    handler_call();
+  }
+  catch (...) {
+    ErrorHandler()(std::current_exception());
+  }
+}
+
+template <typename HandlerCall>
+void TerminateOnError::CallHandler(HandlerCall&& handler_call)
+{
+  // Handlers are called from noexcept functions, so anything thrown will terminate
+  handler_call();
+}
+
+template <typename SigdatType, typename... Param>
+void DirectDispatch::Emit(const std::shared_ptr<SigdatType>& sigdat_ptr, Param&&... param) const
+{
+  sigdat_ptr->CallHandlers(std::forward<Param>(param)...);
+}
+
+template <typename Dispatcher>
+DispatchWith<Dispatcher>::DispatchWith() : dispatcher_ptr_(nullptr)
+{
+  // Do nothing
+}
+
+template <typename Dispatcher>
+DispatchWith<Dispatcher>::DispatchWith(Dispatcher& dispatcher) : dispatcher_ptr_(&dispatcher)
+{
+  // Do nothing
+}
+
+template <typename Dispatcher>
+template <typename SigdatType, typename... Param>
+void DispatchWith<Dispatcher>::Emit(const std::shared_ptr<SigdatType>& sigdat_ptr,
+                                    Param&&... param) const
+{
+  // Without a dispatcher (e.g., default constructed), just call the handlers directly
+  if (!dispatcher_ptr_) {
+    sigdat_ptr->CallHandlers(std::forward<Param>(param)...);
+    return;
+  }
+  dispatcher_ptr_->Dispatch(
+      detail::DeferredEmit<SigdatType, Param...>(sigdat_ptr, std::forward<Param>(param)...));
+}
+
+template <typename Dispatcher>
+SignalFactory<Dispatcher>::SignalFactory(Dispatcher& dispatcher) : dispatcher_ptr_(&dispatcher)
+{
+  // Do nothing
+}
+
+template <typename Dispatcher>
+template <typename Func, typename... Policies>
+Signal<Func, DispatchWith<Dispatcher>, Policies...> SignalFactory<Dispatcher>::MakeSignal() const
+{
+  return Signal<Func, DispatchWith<Dispatcher>, Policies...>(*dispatcher_ptr_);
+}
+
+template <typename Func, typename... Policies>
+SignalConnector<Func, Policies...>::SignalConnector(Signal<Func, Policies...>& signal)
+    : sigdat_wptr_(signal.GetSigdat_())
+{
+  // Do nothing
+}
+
+template <typename Func, typename... Policies>
+Sigcon SignalConnector<Func, Policies...>::Connect(const Handler& handler, int priority)
+{
+  const std::shared_ptr<detail::Sigdat<Func, Policies...>> sigdat_ptr = sigdat_wptr_.lock();
+  if (!sigdat_ptr) {
+    return {};
+  }
+  const std::size_t handler_id = sigdat_ptr->AddHandler(handler, priority);
+  return Sigcon(sigdat_ptr, handler_id);
+}
+
+template <typename Func, typename... Policies>
+Sigcon SignalConnector<Func, Policies...>::Connect(Handler&& handler, int priority)
+{
+  const std::shared_ptr<detail::Sigdat<Func, Policies...>> sigdat_ptr = sigdat_wptr_.lock();
+  if (!sigdat_ptr) {
+    return {};
+  }
+  const std::size_t handler_id = sigdat_ptr->AddHandler(std::move(handler), priority);
+  return Sigcon(sigdat_ptr, handler_id);
+}
+
+template <typename Func, typename... Policies>
+Sigcon SignalConnector<Func, Policies...>::operator()(const Handler& handler)
+{
+  return Connect(handler);
+}
+
+template <typename Func, typename... Policies>
+Sigcon SignalConnector<Func, Policies...>::operator()(Handler&& handler)
+{
+  return Connect(std::move(handler));
+}
+
+template <typename Func, typename... Policies>
+SignalConnector<Func, Policies...> MakeSignalConnector(Signal<Func, Policies...>& signal)
+{
+  return SignalConnector<Func, Policies...>(signal);
+}
+
+namespace detail {
+
+template <typename Ret, typename... Param, typename... Policies>
+Sigdat<Ret(Param...), Policies...>::Sigdat() : Sigdat(Allocator())
+{
+  // Do nothing
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+Sigdat<Ret(Param...), Policies...>::Sigdat(const Allocator& allocator)
+    : handler_slots_(allocator),
+      free_slot_indices_(allocator),
+      handler_pool_(allocator),
+      handlers_snapshot_(allocator),
+      expired_handler_ids_(allocator)
+{
+  // Do nothing
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+std::size_t Sigdat<Ret(Param...), Policies...>::AddHandler(const Handler& handler, int priority)
+{
+  return AddHandler(Handler(handler), priority);
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+std::size_t Sigdat<Ret(Param...), Policies...>::AddHandler(Handler&& handler, int priority)
+{
+  return AddHandlerEntry_([&handler](std::size_t) -> Handler&& { return std::move(handler); },
+                          priority);
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+template <typename Tracked, typename Callable>
+std::size_t Sigdat<Ret(Param...), Policies...>::AddTrackedHandler(
+    const std::weak_ptr<Tracked>& tracked_wptr, Callable&& callable, int priority)
+{
+  using TrackedHandlerType = TrackedHandler<Tracked, typename std::decay<Callable>::type>;
+  return AddHandlerEntry_(
+      [&](std::size_t handler_id) {
+        return Handler(TrackedHandlerType(this, handler_id, tracked_wptr,
+                                          std::forward<Callable>(callable)));
+      },
+      priority);
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+void Sigdat<Ret(Param...), Policies...>::CallHandlers(Param&&... param) const
+    noexcept(ErrorPolicy::NOEXCEPT)
+{
+  this->RecordEmits(1u);
+  if (has_waiters_.load(std::memory_order_relaxed)) {
+    WakeWaiters_(param...);
+  }
+  {
+    // Hold the snapshot, so in-flight modifications will make a copy
+    const auto handlers_reader = handlers_snapshot_.Read();
+    if (!handlers_reader) {
+      return;
+    }
+    for (const HandlerEntry& handler_entry : *handlers_reader) {
+      if (handler_entry.slot_index == DEAD_SLOT_INDEX) {
+        continue;
+      }
+      handler_entry.handler_cell.Visit([&](const Handler& handler) {
+        handler_entry.RecordCall([&]() {
+          ErrorPolicy::CallHandler([&]() { handler(std::forward<Param>(param)...); });
+        });
+      });
+    }
+  }
+  // Remove them after releasing the snapshot, so it isn't copied
+  if (has_expired_handlers_.load(std::memory_order_relaxed)) {
+    RemoveExpiredHandlers_();
+  }
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+template <typename BatchType>
+void Sigdat<Ret(Param...), Policies...>::CallHandlersOver(const BatchType& batch) const
+    noexcept(ErrorPolicy::NOEXCEPT)
+{
+  this->RecordEmits(batch.size());
+  if (has_waiters_.load(std::memory_order_relaxed)) {
+    // Waiters which wait again are woken by the rest of the batch
+    for (const auto& args : batch) {
+      WakeWaitersWith_(args, typename MakeIndexSequence<sizeof...(Param)>::type());
+    }
+  }
+  {
+    // Hold the snapshot, so in-flight modifications will make a copy
+    const auto handlers_reader = handlers_snapshot_.Read();
+    if (!handlers_reader) {
+      return;
+    }
+    for (const HandlerEntry& handler_entry : *handlers_reader) {
+      if (handler_entry.slot_index == DEAD_SLOT_INDEX) {
+        continue;
+      }
+      // Call each handler over the whole batch, while it's still hot in the cache
+      handler_entry.handler_cell.Visit([&](const Handler& handler) {
+        for (const auto& args : batch) {
+          handler_entry.RecordCall([&]() {
+            ErrorPolicy::CallHandler([&]() {
+              CallHandlerWith_(handler, args,
+                               typename MakeIndexSequence<sizeof...(Param)>::type());
+            });
+          });
+        }
+      });
+    }
+  }
+  if (has_expired_handlers_.load(std::memory_order_relaxed)) {
+    RemoveExpiredHandlers_();
+  }
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+template <typename Combiner>
+void Sigdat<Ret(Param...), Policies...>::CombineHandlers(Combiner& combiner,
+                                                         Param&&... param) const
+    noexcept(ErrorPolicy::NOEXCEPT)
+{
+  this->RecordEmits(1u);
+  // Hold the snapshot, so in-flight modifications will make a copy
+  const auto handlers_reader = handlers_snapshot_.Read();
+  if (!handlers_reader) {
+    return;
+  }
+  bool keep_calling = true;
+  // The error policy only applies to the handlers, errors from the combiner are passed on
+  // (which terminates if the policy is noexcept)
+  std::exception_ptr combiner_error_ptr;
+  for (const HandlerEntry& handler_entry : *handlers_reader) {
+    if (handler_entry.slot_index == DEAD_SLOT_INDEX) {
+      continue;
+    }
+    // Results of handlers which throw (and are caught) aren't combined
+    handler_entry.handler_cell.Visit([&](const Handler& handler) {
+      handler_entry.RecordCall([&]() {
+        ErrorPolicy::CallHandler([&]() {
+          keep_calling =
+              CombineResult_(combiner, handler(std::forward<Param>(param)...), combiner_error_ptr,
+                             std::integral_constant<bool, ErrorPolicy::NOEXCEPT>());
+        });
+      });
+    });
+    if (!ErrorPolicy::NOEXCEPT && combiner_error_ptr) {
+      std::rethrow_exception(combiner_error_ptr);
+    }
+    if (!keep_calling) {
+      break;
+    }
+  }
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+void Sigdat<Ret(Param...), Policies...>::RemoveHandler(std::size_t handler_id)
+{
+  typename HandlerCell::DisconnectToken disconnect_token;
+  {
+    std::lock_guard<typename ThreadingPolicy::Mutex> lock(mutex_);
+    // Only publish a new snapshot if the handler is actually removed
+    if (!IsLiveHandlerId_(handler_id)) {
+      return;
+    }
+    HandlerList& handlers = BeginModifyHandlers_();
+    disconnect_token = KillHandlerEntry_(handlers, handler_id);
+    if (2u * num_dead_entries_ > handlers.size()) {
+      CompactHandlers_(handlers);
+    }
+    handlers_snapshot_.Commit();
+  }
+  // Wait without the lock, so handlers in flight can still connect and disconnect
+  disconnect_token.Wait();
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+void Sigdat<Ret(Param...), Policies...>::RemoveHandlers(const std::size_t* handler_ids,
+                                                        std::size_t num_handler_ids)
+{
+  DisconnectTokenList<typename HandlerCell::DisconnectToken, Allocator> disconnect_tokens(
+      handler_slots_.get_allocator());
+  {
+    std::lock_guard<typename ThreadingPolicy::Mutex> lock(mutex_);
+    // Only publish a new snapshot if any handlers are actually removed
+    HandlerList* handlers_ptr = nullptr;
+    for (std::size_t ii = 0; ii < num_handler_ids; ++ii) {
+      if (!IsLiveHandlerId_(handler_ids[ii])) {
+        continue;
+      }
+      if (!handlers_ptr) {
+        handlers_ptr = &BeginModifyHandlers_();
+      }
+      disconnect_tokens.Add(KillHandlerEntry_(*handlers_ptr, handler_ids[ii]));
+    }
+    if (!handlers_ptr) {
+      return;
+    }
+    if (2u * num_dead_entries_ > handlers_ptr->size()) {
+      CompactHandlers_(*handlers_ptr);
+    }
+    handlers_snapshot_.Commit();
+  }
+  // Wait without the lock, so handlers in flight can still connect and disconnect
+  disconnect_tokens.Wait();
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+void Sigdat<Ret(Param...), Policies...>::AddWaiter(EmitWaiter<Param...>* waiter_ptr)
+{
+  std::lock_guard<typename ThreadingPolicy::Mutex> lock(mutex_);
+  waiter_ptr->next_ptr = nullptr;
+  waiter_ptr->prev_next_ptr = waiters_tail_ptr_;
+  *waiters_tail_ptr_ = waiter_ptr;
+  waiters_tail_ptr_ = &waiter_ptr->next_ptr;
+  has_waiters_.store(true, std::memory_order_relaxed);
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+void Sigdat<Ret(Param...), Policies...>::RemoveWaiter(EmitWaiter<Param...>* waiter_ptr)
+{
+  std::lock_guard<typename ThreadingPolicy::Mutex> lock(mutex_);
+  if (waiter_ptr->prev_next_ptr) {
+    UnlinkWaiter_(waiter_ptr);
+  }
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+bool Sigdat<Ret(Param...), Policies...>::IsHandlerBlocked(std::size_t handler_id)
+{
+  std::lock_guard<typename ThreadingPolicy::Mutex> lock(mutex_);
+  const HandlerEntry* const handler_entry_ptr = FindHandlerEntry_(handler_id);
+  return handler_entry_ptr && handler_entry_ptr->handler_cell.IsBlocked();
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+bool Sigdat<Ret(Param...), Policies...>::HasHandlers() const
+{
+  std::lock_guard<typename ThreadingPolicy::Mutex> lock(mutex_);
+  return handler_slots_.size() != free_slot_indices_.size();
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+void Sigdat<Ret(Param...), Policies...>::SetHandlerBlocked(std::size_t handler_id, bool blocked)
+{
+  std::lock_guard<typename ThreadingPolicy::Mutex> lock(mutex_);
+  // Set the flag in place rather than publishing a new snapshot (emissions in flight on an
+  // older snapshot may still call the handler)
+  HandlerEntry* const handler_entry_ptr = FindHandlerEntry_(handler_id);
+  if (handler_entry_ptr) {
+    handler_entry_ptr->handler_cell.SetBlocked(blocked);
+  }
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+template <typename BatchSigdat>
+std::shared_ptr<BatchSigdat> Sigdat<Ret(Param...), Policies...>::MakeBatchSigdat()
+{
+  std::lock_guard<typename ThreadingPolicy::Mutex> lock(mutex_);
+  if (!batch_sigdat_ptr_) {
+    const Allocator allocator(handler_slots_.get_allocator());
+    batch_sigdat_ptr_ = std::allocate_shared<BatchSigdat>(allocator, allocator);
+    batch_sigdat_raw_ptr_.store(batch_sigdat_ptr_.get(), std::memory_order_release);
+  }
+  return std::static_pointer_cast<BatchSigdat>(batch_sigdat_ptr_);
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+template <typename BatchSigdat>
+const BatchSigdat* Sigdat<Ret(Param...), Policies...>::GetBatchSigdat() const
+{
+  // Emissions read this without the lock, but it never changes once set
+  return static_cast<const BatchSigdat*>(batch_sigdat_raw_ptr_.load(std::memory_order_acquire));
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+template <typename MakeHandler>
+std::size_t Sigdat<Ret(Param...), Policies...>::AddHandlerEntry_(MakeHandler&& make_handler,
+                                                                int priority)
+{
+  std::lock_guard<typename ThreadingPolicy::Mutex> lock(mutex_);
+  HandlerList& handlers = BeginModifyHandlers_();
+  std::size_t slot_index;
+  if (!free_slot_indices_.empty()) {
+    slot_index = free_slot_indices_.back();
+    free_slot_indices_.pop_back();
+  }
+  else {
+    slot_index = handler_slots_.size();
+    handler_slots_.push_back({0u, 0u, DEFAULT_HANDLER_PRIORITY});
+  }
+  // Find where the entry goes now, so emissions never sort (usually this is the back)
+  std::size_t entry_index = handlers.size();
+  if (priority <= lowest_priority_) {
+    lowest_priority_ = priority;
+  }
+  else {
+    for (; entry_index > 0u; --entry_index) {
+      const HandlerEntry& handler_entry = handlers[entry_index - 1u];
+      if (handler_entry.slot_index != DEAD_SLOT_INDEX
+          && handler_slots_[handler_entry.slot_index].priority >= priority) {
+        break;
+      }
+    }
+  }
+  HandlerSlot& handler_slot = handler_slots_[slot_index];
+  handler_slot.entry_index = entry_index;
+  handler_slot.priority = priority;
+  const std::size_t handler_id = (handler_slot.generation << SLOT_INDEX_BITS) | slot_index;
+  handlers.insert(
+      handlers.begin() + entry_index,
+      HandlerEntry(slot_index, handler_pool_.MakeCell(make_handler(handler_id)),
+                   this->RecordConnect(handler_id, priority)));
+  // Point the slots of any shifted entries at their new indices
+  for (std::size_t ii = entry_index + 1u; ii < handlers.size(); ++ii) {
+    if (handlers[ii].slot_index != DEAD_SLOT_INDEX) {
+      handler_slots_[handlers[ii].slot_index].entry_index = ii;
+    }
+  }
+  handlers_snapshot_.Commit();
+  return handler_id;
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+bool Sigdat<Ret(Param...), Policies...>::IsLiveHandlerId_(std::size_t handler_id) const
+{
+  const std::size_t slot_index = handler_id & SLOT_INDEX_MASK;
+  const std::size_t generation = handler_id >> SLOT_INDEX_BITS;
+  return slot_index < handler_slots_.size()
+         && handler_slots_[slot_index].generation == generation;
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+typename Sigdat<Ret(Param...), Policies...>::HandlerEntry*
+Sigdat<Ret(Param...), Policies...>::FindHandlerEntry_(std::size_t handler_id)
+{
+  if (!IsLiveHandlerId_(handler_id)) {
+    return nullptr;
+  }
+  const std::size_t slot_index = handler_id & SLOT_INDEX_MASK;
+  return &(*handlers_snapshot_.Get())[handler_slots_[slot_index].entry_index];
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+typename Sigdat<Ret(Param...), Policies...>::HandlerCell::DisconnectToken
+Sigdat<Ret(Param...), Policies...>::KillHandlerEntry_(HandlerList& handlers,
+                                                      std::size_t handler_id)
+{
+  const std::size_t slot_index = handler_id & SLOT_INDEX_MASK;
+  HandlerSlot& handler_slot = handler_slots_[slot_index];
+  HandlerEntry& handler_entry = handlers[handler_slot.entry_index];
+  handler_entry.slot_index = DEAD_SLOT_INDEX;
+  ++num_dead_entries_;
+  // Bump the generation so stale handler IDs can't match the reused slot
+  handler_slot.generation = (handler_slot.generation + 1u) & SLOT_INDEX_MASK;
+  free_slot_indices_.push_back(slot_index);
+  this->RecordDisconnect(handler_id);
+  return handler_entry.handler_cell.Disconnect();
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+Sigdat<Ret(Param...), Policies...>::HandlerEntry::HandlerEntry(std::size_t slot_index,
+                                                               HandlerCell&& handler_cell,
+                                                               HandlerRecorder&& handler_recorder)
+    : HandlerRecorder(std::move(handler_recorder)),
+      slot_index(slot_index),
+      handler_cell(std::move(handler_cell))
+{
+  // Do nothing
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+typename Sigdat<Ret(Param...), Policies...>::HandlerList&
+Sigdat<Ret(Param...), Policies...>::BeginModifyHandlers_()
+{
+  HandlerList* const handlers_ptr = handlers_snapshot_.Get();
+  if (handlers_ptr && !handlers_snapshot_.IsShared()) {
+    return *handlers_ptr;
+  }
+  // An emission could be in flight, so copy rather than modify its snapshot
+  HandlerList& live_handlers = handlers_snapshot_.Stage();
+  if (handlers_ptr) {
+    CopyLiveHandlers_(*handlers_ptr, live_handlers);
+  }
+  return live_handlers;
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+void Sigdat<Ret(Param...), Policies...>::CopyLiveHandlers_(const HandlerList& handlers,
+                                                           HandlerList& live_handlers)
+{
+  // Copy only the live entries (in order) and point their slots at the new indices (the handlers
+  // themselves are shared, not copied)
+  live_handlers.reserve(handlers.size() - num_dead_entries_ + 1u);
+  for (const HandlerEntry& handler_entry : handlers) {
+    if (handler_entry.slot_index == DEAD_SLOT_INDEX) {
+      continue;
+    }
+    handler_slots_[handler_entry.slot_index].entry_index = live_handlers.size();
+    live_handlers.push_back(handler_entry);
+  }
+  num_dead_entries_ = 0u;
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+void Sigdat<Ret(Param...), Policies...>::CompactHandlers_(HandlerList& handlers)
+{
+  // Shift the live entries down (in order) and point their slots at the new indices
+  std::size_t live_index = 0u;
+  for (HandlerEntry& handler_entry : handlers) {
+    if (handler_entry.slot_index == DEAD_SLOT_INDEX) {
+      continue;
+    }
+    handler_slots_[handler_entry.slot_index].entry_index = live_index;
+    if (&handlers[live_index] != &handler_entry) {
+      handlers[live_index] = std::move(handler_entry);
+    }
+    ++live_index;
+  }
+  handlers.erase(handlers.begin() + live_index, handlers.end());
+  num_dead_entries_ = 0u;
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+template <typename Args, std::size_t... indices>
+void Sigdat<Ret(Param...), Policies...>::CallHandlerWith_(const Handler& handler, const Args& args,
+                                                          IndexSequence<indices...>)
+{
+  handler(std::get<indices>(args)...);
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+template <typename Combiner, typename Result>
+bool Sigdat<Ret(Param...), Policies...>::CombineResult_(Combiner& combiner, Result&& result,
+                                                        std::exception_ptr& error_ptr,
+                                                        std::false_type /* noexcept */)
+{
+  try {
+    return combiner.Combine(std::forward<Result>(result));
+  }
+  catch (...) {
+    error_ptr = std::current_exception();
+    return false;
+  }
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+template <typename Combiner, typename Result>
+bool Sigdat<Ret(Param...), Policies...>::CombineResult_(Combiner& combiner, Result&& result,
+                                                        std::exception_ptr&,
+                                                        std::true_type /* noexcept */)
+{
+  return combiner.Combine(std::forward<Result>(result));
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+void Sigdat<Ret(Param...), Policies...>::WakeWaiters_(
+    const typename std::decay<Param>::type&... param) const
+{
+  // Take all the waiters, so any which wait again are woken by the next emission
+  EmitWaiter<Param...>* waking_head_ptr;
+  {
+    std::lock_guard<typename ThreadingPolicy::Mutex> lock(mutex_);
+    waking_head_ptr = waiters_head_ptr_;
+    if (waking_head_ptr) {
+      waking_head_ptr->prev_next_ptr = &waking_head_ptr;
+    }
+    waiters_head_ptr_ = nullptr;
+    waiters_tail_ptr_ = &waiters_head_ptr_;
+    has_waiters_.store(false, std::memory_order_relaxed);
+  }
+  while (true) {
+    EmitWaiter<Param...>* waiter_ptr;
+    {
+      // Waiters are still unlinked with the lock, so they can go away while others are woken
+      std::lock_guard<typename ThreadingPolicy::Mutex> lock(mutex_);
+      waiter_ptr = waking_head_ptr;
+      if (!waiter_ptr) {
+        return;
+      }
+      UnlinkWaiter_(waiter_ptr);
+    }
+    waiter_ptr->Wake(param...);
+  }
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+template <typename Args, std::size_t... indices>
+void Sigdat<Ret(Param...), Policies...>::WakeWaitersWith_(const Args& args,
+                                                          IndexSequence<indices...>) const
+{
+  WakeWaiters_(std::get<indices>(args)...);
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+void Sigdat<Ret(Param...), Policies...>::UnlinkWaiter_(EmitWaiter<Param...>* waiter_ptr) const
+{
+  *waiter_ptr->prev_next_ptr = waiter_ptr->next_ptr;
+  if (waiter_ptr->next_ptr) {
+    waiter_ptr->next_ptr->prev_next_ptr = waiter_ptr->prev_next_ptr;
+  }
+  else if (waiters_tail_ptr_ == &waiter_ptr->next_ptr) {
+    waiters_tail_ptr_ = waiter_ptr->prev_next_ptr;
+  }
+  waiter_ptr->next_ptr = nullptr;
+  waiter_ptr->prev_next_ptr = nullptr;
+  has_waiters_.store(waiters_head_ptr_ != nullptr, std::memory_order_relaxed);
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+void Sigdat<Ret(Param...), Policies...>::NoteExpiredHandler_(std::size_t handler_id) const
+{
+  std::lock_guard<typename ThreadingPolicy::Mutex> lock(mutex_);
+  // Batches call the same handler over and over
+  if (!expired_handler_ids_.empty() && expired_handler_ids_.back() == handler_id) {
+    return;
+  }
+  expired_handler_ids_.push_back(handler_id);
+  has_expired_handlers_.store(true, std::memory_order_relaxed);
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+void Sigdat<Ret(Param...), Policies...>::RemoveExpiredHandlers_() const
+{
+  std::vector<std::size_t, AllocatorFor<std::size_t>> expired_handler_ids(
+      expired_handler_ids_.get_allocator());
+  {
+    std::lock_guard<typename ThreadingPolicy::Mutex> lock(mutex_);
+    expired_handler_ids.swap(expired_handler_ids_);
+    has_expired_handlers_.store(false, std::memory_order_relaxed);
+  }
+  // Sigdats are never const objects, emissions are const only to keep handler calls read-only
+  const_cast<Sigdat*>(this)->RemoveHandlers(expired_handler_ids.data(),
+                                            expired_handler_ids.size());
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+template <typename Tracked, typename Callable>
+Sigdat<Ret(Param...), Policies...>::TrackedHandler<Tracked, Callable>::TrackedHandler(
+    const Sigdat* sigdat_ptr, std::size_t handler_id, const std::weak_ptr<Tracked>& tracked_wptr,
+    Callable callable)
+    : sigdat_ptr_(sigdat_ptr),
+      handler_id_(handler_id),
+      tracked_wptr_(tracked_wptr),
+      callable_(std::move(callable))
+{
+  // Do nothing
+}
+
+template <typename Ret, typename... Param, typename... Policies>
+template <typename Tracked, typename Callable>
+template <typename... Arg>
+void Sigdat<Ret(Param...), Policies...>::TrackedHandler<Tracked, Callable>::operator()(
+    Arg&&... arg) const
+{
+  if (ThreadingPolicy::LOCK_TRACKED) {
+    const std::shared_ptr<Tracked> tracked_ptr = tracked_wptr_.lock();
+    if (tracked_ptr) {
+      callable_(std::forward<Arg>(arg)...);
+      return;
+    }
+  }
+  else if (!tracked_wptr_.expired()) {
+    callable_(std::forward<Arg>(arg)...);
+    return;
+  }
+  sigdat_ptr_->NoteExpiredHandler_(handler_id_);
+}
+
+template <typename SigdatType, typename... Param>
+template <typename... Arg>
+DeferredEmit<SigdatType, Param...>::DeferredEmit(const std::shared_ptr<SigdatType>& sigdat_ptr,
+                                                 Arg&&... arg)
+    : sigdat_wptr_(sigdat_ptr), args_(std::forward<Arg>(arg)...)
+{
+  // Do nothing
+}
+
+template <typename SigdatType, typename... Param>
+void DeferredEmit<SigdatType, Param...>::operator()()
+{
+  CallHandlers_(typename MakeIndexSequence<sizeof...(Param)>::type());
+}
+
+template <typename SigdatType, typename... Param>
+template <std::size_t... indices>
+void DeferredEmit<SigdatType, Param...>::CallHandlers_(IndexSequence<indices...>)
+{
+  const std::shared_ptr<SigdatType> sigdat_ptr = sigdat_wptr_.lock();
+  if (!sigdat_ptr) {
+    return;
+  }
+  // The handlers see the queued copies, just like the original arguments
+  sigdat_ptr->CallHandlers(static_cast<Param&&>(std::get<indices>(args_))...);
 }
 
 }  // namespace detail
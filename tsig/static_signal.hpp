@@ -0,0 +1,157 @@
+// Copyright (c) 2021 Tim Perkins
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// “Software”), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TSIG_STATIC_SIGNAL_HPP
+#define TSIG_STATIC_SIGNAL_HPP
+
+#include <tsig/signal.hpp>
+
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace tsig {
+
+template <typename Func, typename... Handlers>
+class StaticSignal;
+
+// A signal with a fixed set of handlers, known at compile time, so emitting can be inlined
+template <typename... Param, typename... Handlers>
+class StaticSignal<void(Param...), Handlers...> {
+ public:
+  StaticSignal() = default;
+  template <typename FirstHandler, typename... OtherHandlers,
+            typename = typename std::enable_if<
+                !std::is_same<typename std::decay<FirstHandler>::type, StaticSignal>::value>::type>
+  explicit StaticSignal(FirstHandler&& first_handler, OtherHandlers&&... other_handlers);
+  StaticSignal(const StaticSignal&) = default;
+  StaticSignal(StaticSignal&&) = default;
+
+  StaticSignal& operator=(const StaticSignal&) = default;
+  StaticSignal& operator=(StaticSignal&&) = default;
+
+  void Emit(Param&&... param) const;
+  void EmitBatch(const Batch<Param...>& batch) const;
+
+  template <std::size_t index>
+  typename std::tuple_element<index, std::tuple<Handlers...>>::type& GetHandler();
+
+ private:
+  using Args = typename Batch<Param...>::Args;
+
+  template <std::size_t... indices>
+  void Emit_(detail::IndexSequence<indices...>, Param&&... param) const;
+  template <std::size_t... indices>
+  void EmitBatch_(detail::IndexSequence<indices...>, const Batch<Param...>& batch) const;
+  template <typename Handler>
+  static void EmitBatchTo_(Handler& handler, const Batch<Param...>& batch);
+  template <typename Handler, std::size_t... indices>
+  static void EmitArgsTo_(Handler& handler, const Args& args, detail::IndexSequence<indices...>);
+
+  // Mutable like std::function, the handlers are called as non-const
+  mutable std::tuple<Handlers...> handlers_;
+};
+
+// Makes a static signal from handlers (e.g., lambdas)
+template <typename Func, typename... Handlers>
+StaticSignal<Func, typename std::decay<Handlers>::type...> MakeStaticSignal(Handlers&&... handlers);
+
+template <typename... Param, typename... Handlers>
+template <typename FirstHandler, typename... OtherHandlers, typename>
+StaticSignal<void(Param...), Handlers...>::StaticSignal(FirstHandler&& first_handler,
+                                                        OtherHandlers&&... other_handlers)
+    : handlers_(std::forward<FirstHandler>(first_handler),
+                std::forward<OtherHandlers>(other_handlers)...)
+{
+  // Do nothing
+}
+
+template <typename... Param, typename... Handlers>
+void StaticSignal<void(Param...), Handlers...>::Emit(Param&&... param) const
+{
+  Emit_(typename detail::MakeIndexSequence<sizeof...(Handlers)>::type(),
+        std::forward<Param>(param)...);
+}
+
+template <typename... Param, typename... Handlers>
+void StaticSignal<void(Param...), Handlers...>::EmitBatch(const Batch<Param...>& batch) const
+{
+  EmitBatch_(typename detail::MakeIndexSequence<sizeof...(Handlers)>::type(), batch);
+}
+
+template <typename... Param, typename... Handlers>
+template <std::size_t index>
+typename std::tuple_element<index, std::tuple<Handlers...>>::type&
+StaticSignal<void(Param...), Handlers...>::GetHandler()
+{
+  return std::get<index>(handlers_);
+}
+
+template <typename... Param, typename... Handlers>
+template <std::size_t... indices>
+void StaticSignal<void(Param...), Handlers...>::Emit_(detail::IndexSequence<indices...>,
+                                                      Param&&... param) const
+{
+  // Call the handlers in order, which the compiler can see through and inline
+  using Expand = int[];
+  (void) Expand{0, ((void) std::get<indices>(handlers_)(std::forward<Param>(param)...), 0)...};
+}
+
+template <typename... Param, typename... Handlers>
+template <std::size_t... indices>
+void StaticSignal<void(Param...), Handlers...>::EmitBatch_(detail::IndexSequence<indices...>,
+                                                           const Batch<Param...>& batch) const
+{
+  using Expand = int[];
+  (void) Expand{0, (EmitBatchTo_(std::get<indices>(handlers_), batch), 0)...};
+}
+
+template <typename... Param, typename... Handlers>
+template <typename Handler>
+void StaticSignal<void(Param...), Handlers...>::EmitBatchTo_(Handler& handler,
+                                                             const Batch<Param...>& batch)
+{
+  // Like Signal, each handler is called over the whole batch in turn
+  for (const Args& args : batch) {
+    EmitArgsTo_(handler, args, typename detail::MakeIndexSequence<sizeof...(Param)>::type());
+  }
+}
+
+template <typename... Param, typename... Handlers>
+template <typename Handler, std::size_t... indices>
+void StaticSignal<void(Param...), Handlers...>::EmitArgsTo_(Handler& handler, const Args& args,
+                                                            detail::IndexSequence<indices...>)
+{
+  handler(std::get<indices>(args)...);
+}
+
+template <typename Func, typename... Handlers>
+StaticSignal<Func, typename std::decay<Handlers>::type...> MakeStaticSignal(Handlers&&... handlers)
+{
+  return StaticSignal<Func, typename std::decay<Handlers>::type...>(
+      std::forward<Handlers>(handlers)...);
+}
+
+}  // namespace tsig
+
+#endif  // TSIG_STATIC_SIGNAL_HPP
@@ -0,0 +1,936 @@
+// Copyright (c) 2021 Tim Perkins
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// “Software”), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TSIG_THREADING_HPP
+#define TSIG_THREADING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace tsig {
+namespace detail {
+
+// Used to tag threading policies
+struct ThreadingPolicyKind {
+  // Empty
+};
+
+// A mutex which does nothing, for single threaded signals
+struct NullMutex {
+  void lock() {}
+  void unlock() {}
+};
+
+// Single threaded handlers have nothing to wait for after a disconnect
+struct NullDisconnectToken {
+  void Wait() {}
+};
+
+// Makes an object with an allocator, which is also passed to its constructor
+template <typename T, typename Allocator>
+T* NewWithAllocator(const Allocator& allocator);
+
+// Frees an object made with an allocator
+template <typename T, typename Allocator>
+void DeleteWithAllocator(const Allocator& allocator, T* ptr);
+
+// Frees an object made with an allocator (e.g., when shared)
+template <typename Allocator>
+class AllocatorDeleter {
+ public:
+  explicit AllocatorDeleter(const Allocator& allocator);
+
+  template <typename T>
+  void operator()(T* ptr) const;
+
+ private:
+  Allocator allocator_;
+};
+
+// A snapshot shared with the emissions in flight, modified in place when unshared (the allocator
+// is a base, so it takes no space when it's stateless)
+template <typename T, typename Allocator = std::allocator<T>>
+class SharedSnapshot : private Allocator {
+ public:
+  using Reader = std::shared_ptr<const T>;
+
+  SharedSnapshot() = default;
+  explicit SharedSnapshot(const Allocator& allocator);
+
+  Reader Read() const;
+  T* Get();
+  bool IsShared() const;
+  T& Stage();
+  void Commit();
+
+ private:
+  std::shared_ptr<T> ptr_;
+};
+
+// A snapshot published atomically. Readers register with the current epoch, and retired snapshots
+// are freed once the readers of their epoch have left (by the commit, or by the last reader to
+// leave), so overlapping readers can't hold them back for long
+template <typename T, typename Allocator = std::allocator<T>>
+class AtomicSnapshot : private Allocator {
+ public:
+  class Reader {
+   public:
+    explicit Reader(const AtomicSnapshot& snapshot);
+    Reader(const Reader&) = delete;
+    Reader(Reader&& reader);
+    ~Reader();
+
+    Reader& operator=(const Reader&) = delete;
+    Reader& operator=(Reader&&) = delete;
+
+    explicit operator bool() const;
+    const T& operator*() const;
+
+   private:
+    const AtomicSnapshot* snapshot_ptr_;
+    const T* ptr_;
+    std::size_t epoch_index_;
+  };
+
+  AtomicSnapshot();
+  explicit AtomicSnapshot(const Allocator& allocator);
+  AtomicSnapshot(const AtomicSnapshot&) = delete;
+  ~AtomicSnapshot();
+
+  AtomicSnapshot& operator=(const AtomicSnapshot&) = delete;
+
+  Reader Read() const;
+  T* Get();
+  bool IsShared() const;
+  T& Stage();
+  void Commit();
+  // Retired snapshots not yet freed
+  std::size_t NumRetired() const;
+
+ private:
+  using RetiredList =
+      std::vector<T*, typename std::allocator_traits<Allocator>::template rebind_alloc<T*>>;
+
+  void LeaveEpoch_(std::size_t epoch_index) const;
+  void FreeRetired_() const;
+
+  std::atomic<T*> current_ptr_;
+  // Readers are counted by the parity of the epoch they registered in
+  mutable std::atomic<std::size_t> epoch_;
+  mutable std::atomic<std::size_t> num_readers_[2];
+  T* staged_ptr_;
+  // Guards the retired snapshots, which readers free without the signal's lock
+  mutable std::mutex retired_mutex_;
+  mutable std::atomic<bool> has_retired_;
+  // Retired while the readers of the previous epoch were still leaving
+  mutable RetiredList waiting_ptrs_;
+  // Freed once the readers of the previous epoch have left
+  mutable RetiredList grace_ptrs_;
+};
+
+template <typename Handler, typename Allocator>
+class LocalHandlerPool;
+
+// A single threaded handler is shared between snapshots, so copying a snapshot (e.g., to connect
+// during an emission) only counts references
+template <typename Handler, typename Allocator>
+class LocalHandlerCell {
+ public:
+  using DisconnectToken = NullDisconnectToken;
+
+  LocalHandlerCell(const LocalHandlerCell& cell);
+  LocalHandlerCell(LocalHandlerCell&& cell) noexcept;
+  ~LocalHandlerCell();
+
+  LocalHandlerCell& operator=(const LocalHandlerCell& cell);
+  LocalHandlerCell& operator=(LocalHandlerCell&& cell) noexcept;
+
+  // Calls the visitor with the handler, returning false if it was blocked or disconnected
+  template <typename Visitor>
+  bool Visit(Visitor&& visitor) const;
+  // Emissions in flight on an older snapshot keep the handler until they're done
+  DisconnectToken Disconnect();
+  bool IsBlocked() const;
+  void SetBlocked(bool blocked);
+
+ private:
+  friend class LocalHandlerPool<Handler, Allocator>;
+
+  struct HandlerBlock {
+    HandlerBlock(Handler&& handler, LocalHandlerPool<Handler, Allocator>* pool_ptr);
+
+    Handler handler;
+    LocalHandlerPool<Handler, Allocator>* pool_ptr;
+    std::size_t num_refs;
+    bool blocked;
+  };
+
+  explicit LocalHandlerCell(HandlerBlock* block_ptr);
+
+  void Release_();
+
+  HandlerBlock* block_ptr_;
+};
+
+// Recycles the blocks of released handlers, so reconnecting doesn't allocate (the allocator is a
+// base, so it takes no space when it's stateless)
+template <typename Handler, typename Allocator>
+class LocalHandlerPool : private Allocator {
+ public:
+  using Cell = LocalHandlerCell<Handler, Allocator>;
+
+  explicit LocalHandlerPool(const Allocator& allocator);
+  LocalHandlerPool(const LocalHandlerPool&) = delete;
+  // Every cell must be released first
+  ~LocalHandlerPool();
+
+  LocalHandlerPool& operator=(const LocalHandlerPool&) = delete;
+
+  Cell MakeCell(Handler&& handler);
+
+ private:
+  friend class LocalHandlerCell<Handler, Allocator>;
+
+  using HandlerBlock = typename Cell::HandlerBlock;
+
+  void Recycle_(HandlerBlock* block_ptr);
+
+  std::size_t num_blocks_;
+  // Has room for every block, so recycling never allocates
+  std::vector<HandlerBlock*,
+              typename std::allocator_traits<Allocator>::template rebind_alloc<HandlerBlock*>>
+      free_block_ptrs_;
+};
+
+// Tracks if a multi threaded handler is connected and how many calls are in flight
+struct ConnectionState {
+  std::atomic<bool> connected{true};
+  std::atomic<std::size_t> num_calls{0u};
+};
+
+// Records which handlers the current thread is calling, so they can disconnect themselves
+class CallFrame {
+ public:
+  explicit CallFrame(const ConnectionState* state_ptr);
+  CallFrame(const CallFrame&) = delete;
+  ~CallFrame();
+
+  CallFrame& operator=(const CallFrame&) = delete;
+
+  static std::size_t CountCalls(const ConnectionState* state_ptr);
+
+ private:
+  static const CallFrame*& Top_();
+
+  const ConnectionState* state_ptr_;
+  const CallFrame* next_ptr_;
+};
+
+// Waits for the calls in flight (on other threads) after a disconnect
+class BlockingDisconnectToken {
+ public:
+  BlockingDisconnectToken() = default;
+  explicit BlockingDisconnectToken(std::shared_ptr<ConnectionState>&& state_ptr);
+
+  void Wait();
+
+ private:
+  std::shared_ptr<ConnectionState> state_ptr_;
+};
+
+// Collects the disconnect tokens of many handlers, to wait for them all at once
+template <typename DisconnectToken, typename Allocator>
+class DisconnectTokenList {
+ public:
+  explicit DisconnectTokenList(const Allocator& allocator);
+
+  void Add(DisconnectToken&& disconnect_token);
+  void Wait();
+
+ private:
+  using TokenAllocator =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<DisconnectToken>;
+
+  std::vector<DisconnectToken, TokenAllocator> disconnect_tokens_;
+};
+
+// Single threaded handlers have nothing to wait for, so there's nothing to collect
+template <typename Allocator>
+class DisconnectTokenList<NullDisconnectToken, Allocator> {
+ public:
+  explicit DisconnectTokenList(const Allocator&) {}
+
+  void Add(NullDisconnectToken&&) {}
+  void Wait() {}
+};
+
+// A multi threaded handler is shared between snapshots, along with its connection state
+template <typename Handler>
+class SharedHandlerCell {
+ public:
+  using DisconnectToken = BlockingDisconnectToken;
+
+  explicit SharedHandlerCell(Handler&& handler);
+  template <typename Allocator>
+  SharedHandlerCell(Handler&& handler, const Allocator& allocator);
+
+  // Calls the visitor with the handler, returning false if it was blocked or disconnected
+  template <typename Visitor>
+  bool Visit(Visitor&& visitor) const;
+  DisconnectToken Disconnect();
+  // Unlike disconnecting, blocking doesn't wait for the calls in flight
+  bool IsBlocked() const;
+  void SetBlocked(bool blocked);
+
+ private:
+  struct HandlerBlock : ConnectionState {
+    explicit HandlerBlock(Handler&& handler) : handler(std::move(handler)) {}
+
+    Handler handler;
+    std::atomic<bool> blocked{false};
+  };
+
+  std::shared_ptr<HandlerBlock> block_ptr_;
+};
+
+// Makes multi threaded handler cells, which are allocated with the allocator
+template <typename Handler, typename Allocator>
+class SharedHandlerPool : private Allocator {
+ public:
+  using Cell = SharedHandlerCell<Handler>;
+
+  explicit SharedHandlerPool(const Allocator& allocator);
+
+  Cell MakeCell(Handler&& handler);
+};
+
+}  // namespace detail
+
+// Signals are used from a single thread (the default)
+struct SingleThreaded {
+  using PolicyKind = detail::ThreadingPolicyKind;
+  // Signals allocate their data on the first connection
+  static constexpr bool LAZY_SIGDAT = true;
+  // Tracked objects can only be dropped by this thread, so checking they're alive is enough
+  static constexpr bool LOCK_TRACKED = false;
+  using Mutex = detail::NullMutex;
+  template <typename T, typename Allocator = std::allocator<T>>
+  using Snapshot = detail::SharedSnapshot<T, Allocator>;
+  template <typename Handler, typename Allocator>
+  using HandlerPool = detail::LocalHandlerPool<Handler, Allocator>;
+};
+
+// Signals are emitted without locking, handlers are never called after disconnecting
+struct MultiThreaded {
+  using PolicyKind = detail::ThreadingPolicyKind;
+  // Connecting can race with emitting, so signals allocate their data up front
+  static constexpr bool LAZY_SIGDAT = false;
+  // Tracked objects can be dropped by other threads, so they're kept alive while handled
+  static constexpr bool LOCK_TRACKED = true;
+  using Mutex = std::mutex;
+  template <typename T, typename Allocator = std::allocator<T>>
+  using Snapshot = detail::AtomicSnapshot<T, Allocator>;
+  template <typename Handler, typename Allocator>
+  using HandlerPool = detail::SharedHandlerPool<Handler, Allocator>;
+};
+
+namespace detail {
+
+template <typename T, typename Allocator>
+T* NewWithAllocator(const Allocator& allocator)
+{
+  using TAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+  TAllocator t_allocator(allocator);
+  T* const ptr = std::allocator_traits<TAllocator>::allocate(t_allocator, 1u);
+  try {
+    // Not constructed by the allocator, which could pass itself to the constructor again
+    ::new (static_cast<void*>(ptr)) T(allocator);
+  }
+  catch (...) {
+    std::allocator_traits<TAllocator>::deallocate(t_allocator, ptr, 1u);
+    throw;
+  }
+  return ptr;
+}
+
+template <typename T, typename Allocator>
+void DeleteWithAllocator(const Allocator& allocator, T* ptr)
+{
+  using TAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+  TAllocator t_allocator(allocator);
+  ptr->~T();
+  std::allocator_traits<TAllocator>::deallocate(t_allocator, ptr, 1u);
+}
+
+template <typename Allocator>
+AllocatorDeleter<Allocator>::AllocatorDeleter(const Allocator& allocator) : allocator_(allocator)
+{
+  // Do nothing
+}
+
+template <typename Allocator>
+template <typename T>
+void AllocatorDeleter<Allocator>::operator()(T* ptr) const
+{
+  DeleteWithAllocator(allocator_, ptr);
+}
+
+template <typename T, typename Allocator>
+SharedSnapshot<T, Allocator>::SharedSnapshot(const Allocator& allocator) : Allocator(allocator)
+{
+  // Do nothing
+}
+
+template <typename T, typename Allocator>
+typename SharedSnapshot<T, Allocator>::Reader SharedSnapshot<T, Allocator>::Read() const
+{
+  return ptr_;
+}
+
+template <typename T, typename Allocator>
+T* SharedSnapshot<T, Allocator>::Get()
+{
+  return ptr_.get();
+}
+
+template <typename T, typename Allocator>
+bool SharedSnapshot<T, Allocator>::IsShared() const
+{
+  return ptr_.use_count() > 1;
+}
+
+template <typename T, typename Allocator>
+T& SharedSnapshot<T, Allocator>::Stage()
+{
+  // Any previous snapshot is kept alive by its readers
+  const Allocator& allocator = *this;
+  ptr_ = std::shared_ptr<T>(NewWithAllocator<T>(allocator), AllocatorDeleter<Allocator>(allocator),
+                            allocator);
+  return *ptr_;
+}
+
+template <typename T, typename Allocator>
+void SharedSnapshot<T, Allocator>::Commit()
+{
+  // Do nothing
+}
+
+template <typename T, typename Allocator>
+AtomicSnapshot<T, Allocator>::Reader::Reader(const AtomicSnapshot& snapshot)
+    : snapshot_ptr_(&snapshot)
+{
+  // Register as a reader before loading, so the snapshot can't be freed in between
+  while (true) {
+    const std::size_t epoch = snapshot_ptr_->epoch_.load();
+    epoch_index_ = epoch % 2u;
+    snapshot_ptr_->num_readers_[epoch_index_].fetch_add(1u);
+    // If the epoch moved on, its retired snapshots might not wait for us
+    if (snapshot_ptr_->epoch_.load() == epoch) {
+      break;
+    }
+    snapshot_ptr_->LeaveEpoch_(epoch_index_);
+  }
+  ptr_ = snapshot_ptr_->current_ptr_.load();
+}
+
+template <typename T, typename Allocator>
+AtomicSnapshot<T, Allocator>::Reader::Reader(Reader&& reader)
+    : snapshot_ptr_(reader.snapshot_ptr_), ptr_(reader.ptr_), epoch_index_(reader.epoch_index_)
+{
+  reader.snapshot_ptr_ = nullptr;
+  reader.ptr_ = nullptr;
+}
+
+template <typename T, typename Allocator>
+AtomicSnapshot<T, Allocator>::Reader::~Reader()
+{
+  if (snapshot_ptr_) {
+    snapshot_ptr_->LeaveEpoch_(epoch_index_);
+  }
+}
+
+template <typename T, typename Allocator>
+AtomicSnapshot<T, Allocator>::Reader::operator bool() const
+{
+  return ptr_ != nullptr;
+}
+
+template <typename T, typename Allocator>
+const T& AtomicSnapshot<T, Allocator>::Reader::operator*() const
+{
+  return *ptr_;
+}
+
+template <typename T, typename Allocator>
+AtomicSnapshot<T, Allocator>::AtomicSnapshot()
+    : current_ptr_(nullptr), epoch_(0u), staged_ptr_(nullptr), has_retired_(false)
+{
+  num_readers_[0].store(0u);
+  num_readers_[1].store(0u);
+}
+
+template <typename T, typename Allocator>
+AtomicSnapshot<T, Allocator>::AtomicSnapshot(const Allocator& allocator)
+    : Allocator(allocator),
+      current_ptr_(nullptr),
+      epoch_(0u),
+      staged_ptr_(nullptr),
+      has_retired_(false),
+      waiting_ptrs_(allocator),
+      grace_ptrs_(allocator)
+{
+  num_readers_[0].store(0u);
+  num_readers_[1].store(0u);
+}
+
+template <typename T, typename Allocator>
+AtomicSnapshot<T, Allocator>::~AtomicSnapshot()
+{
+  const Allocator& allocator = *this;
+  if (T* const current_ptr = current_ptr_.load()) {
+    DeleteWithAllocator(allocator, current_ptr);
+  }
+  if (staged_ptr_) {
+    DeleteWithAllocator(allocator, staged_ptr_);
+  }
+  // There are no readers left
+  for (T* const retired_ptr : grace_ptrs_) {
+    DeleteWithAllocator(allocator, retired_ptr);
+  }
+  for (T* const retired_ptr : waiting_ptrs_) {
+    DeleteWithAllocator(allocator, retired_ptr);
+  }
+}
+
+template <typename T, typename Allocator>
+typename AtomicSnapshot<T, Allocator>::Reader AtomicSnapshot<T, Allocator>::Read() const
+{
+  return Reader(*this);
+}
+
+template <typename T, typename Allocator>
+T* AtomicSnapshot<T, Allocator>::Get()
+{
+  return current_ptr_.load();
+}
+
+template <typename T, typename Allocator>
+bool AtomicSnapshot<T, Allocator>::IsShared() const
+{
+  // Readers may arrive at any time, so never modify in place
+  return true;
+}
+
+template <typename T, typename Allocator>
+T& AtomicSnapshot<T, Allocator>::Stage()
+{
+  const Allocator& allocator = *this;
+  T* const staged_ptr = NewWithAllocator<T>(allocator);
+  if (staged_ptr_) {
+    DeleteWithAllocator(allocator, staged_ptr_);
+  }
+  staged_ptr_ = staged_ptr;
+  return *staged_ptr_;
+}
+
+template <typename T, typename Allocator>
+void AtomicSnapshot<T, Allocator>::Commit()
+{
+  if (!staged_ptr_) {
+    return;
+  }
+  T* const retired_ptr = current_ptr_.exchange(staged_ptr_);
+  staged_ptr_ = nullptr;
+  if (!retired_ptr) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(retired_mutex_);
+    waiting_ptrs_.push_back(retired_ptr);
+    has_retired_.store(true);
+  }
+  // Any reader arriving after this point will load the new snapshot
+  FreeRetired_();
+}
+
+template <typename T, typename Allocator>
+std::size_t AtomicSnapshot<T, Allocator>::NumRetired() const
+{
+  std::lock_guard<std::mutex> lock(retired_mutex_);
+  return waiting_ptrs_.size() + grace_ptrs_.size();
+}
+
+template <typename T, typename Allocator>
+void AtomicSnapshot<T, Allocator>::LeaveEpoch_(std::size_t epoch_index) const
+{
+  // The last reader of an epoch frees the snapshots waiting on it
+  if (num_readers_[epoch_index].fetch_sub(1u) == 1u && has_retired_.load()) {
+    FreeRetired_();
+  }
+}
+
+template <typename T, typename Allocator>
+void AtomicSnapshot<T, Allocator>::FreeRetired_() const
+{
+  const Allocator& allocator = *this;
+  RetiredList retired_ptrs(allocator);
+  {
+    std::lock_guard<std::mutex> lock(retired_mutex_);
+    while (!grace_ptrs_.empty() || !waiting_ptrs_.empty()) {
+      if (grace_ptrs_.empty()) {
+        // Readers registering in the next epoch can only load the current snapshot, so the
+        // waiting snapshots only wait for the readers of this one
+        grace_ptrs_.swap(waiting_ptrs_);
+        epoch_.fetch_add(1u);
+      }
+      if (num_readers_[(epoch_.load() - 1u) % 2u].load() != 0u) {
+        break;
+      }
+      if (retired_ptrs.empty()) {
+        retired_ptrs.swap(grace_ptrs_);
+      }
+      else {
+        retired_ptrs.insert(retired_ptrs.end(), grace_ptrs_.begin(), grace_ptrs_.end());
+        grace_ptrs_.clear();
+      }
+    }
+    has_retired_.store(!grace_ptrs_.empty() || !waiting_ptrs_.empty());
+  }
+  // Free them without the lock, in case freeing a handler modifies the signal again
+  for (T* const retired_ptr : retired_ptrs) {
+    DeleteWithAllocator(allocator, retired_ptr);
+  }
+}
+
+template <typename Handler, typename Allocator>
+LocalHandlerCell<Handler, Allocator>::LocalHandlerCell(const LocalHandlerCell& cell)
+    : block_ptr_(cell.block_ptr_)
+{
+  if (block_ptr_) {
+    ++block_ptr_->num_refs;
+  }
+}
+
+template <typename Handler, typename Allocator>
+LocalHandlerCell<Handler, Allocator>::LocalHandlerCell(LocalHandlerCell&& cell) noexcept
+    : block_ptr_(cell.block_ptr_)
+{
+  cell.block_ptr_ = nullptr;
+}
+
+template <typename Handler, typename Allocator>
+LocalHandlerCell<Handler, Allocator>::~LocalHandlerCell()
+{
+  Release_();
+}
+
+template <typename Handler, typename Allocator>
+LocalHandlerCell<Handler, Allocator>& LocalHandlerCell<Handler, Allocator>::operator=(
+    const LocalHandlerCell& cell)
+{
+  // Take the new reference first, in case the cell is assigned to itself
+  if (cell.block_ptr_) {
+    ++cell.block_ptr_->num_refs;
+  }
+  Release_();
+  block_ptr_ = cell.block_ptr_;
+  return *this;
+}
+
+template <typename Handler, typename Allocator>
+LocalHandlerCell<Handler, Allocator>& LocalHandlerCell<Handler, Allocator>::operator=(
+    LocalHandlerCell&& cell) noexcept
+{
+  if (this != &cell) {
+    Release_();
+    block_ptr_ = cell.block_ptr_;
+    cell.block_ptr_ = nullptr;
+  }
+  return *this;
+}
+
+template <typename Handler, typename Allocator>
+template <typename Visitor>
+bool LocalHandlerCell<Handler, Allocator>::Visit(Visitor&& visitor) const
+{
+  if (!block_ptr_ || block_ptr_->blocked) {
+    return false;
+  }
+  visitor(static_cast<const Handler&>(block_ptr_->handler));
+  return true;
+}
+
+template <typename Handler, typename Allocator>
+typename LocalHandlerCell<Handler, Allocator>::DisconnectToken
+LocalHandlerCell<Handler, Allocator>::Disconnect()
+{
+  Release_();
+  return {};
+}
+
+template <typename Handler, typename Allocator>
+bool LocalHandlerCell<Handler, Allocator>::IsBlocked() const
+{
+  return block_ptr_ && block_ptr_->blocked;
+}
+
+template <typename Handler, typename Allocator>
+void LocalHandlerCell<Handler, Allocator>::SetBlocked(bool blocked)
+{
+  if (block_ptr_) {
+    block_ptr_->blocked = blocked;
+  }
+}
+
+template <typename Handler, typename Allocator>
+LocalHandlerCell<Handler, Allocator>::HandlerBlock::HandlerBlock(
+    Handler&& handler, LocalHandlerPool<Handler, Allocator>* pool_ptr)
+    : handler(std::move(handler)), pool_ptr(pool_ptr), num_refs(1u), blocked(false)
+{
+  // Do nothing
+}
+
+template <typename Handler, typename Allocator>
+LocalHandlerCell<Handler, Allocator>::LocalHandlerCell(HandlerBlock* block_ptr)
+    : block_ptr_(block_ptr)
+{
+  // Do nothing
+}
+
+template <typename Handler, typename Allocator>
+void LocalHandlerCell<Handler, Allocator>::Release_()
+{
+  HandlerBlock* const block_ptr = block_ptr_;
+  block_ptr_ = nullptr;
+  if (block_ptr && --block_ptr->num_refs == 0u) {
+    block_ptr->pool_ptr->Recycle_(block_ptr);
+  }
+}
+
+template <typename Handler, typename Allocator>
+LocalHandlerPool<Handler, Allocator>::LocalHandlerPool(const Allocator& allocator)
+    : Allocator(allocator), num_blocks_(0u), free_block_ptrs_(allocator)
+{
+  // Do nothing
+}
+
+template <typename Handler, typename Allocator>
+LocalHandlerPool<Handler, Allocator>::~LocalHandlerPool()
+{
+  const Allocator& allocator = *this;
+  for (HandlerBlock* const block_ptr : free_block_ptrs_) {
+    DeleteWithAllocator(allocator, block_ptr);
+  }
+}
+
+template <typename Handler, typename Allocator>
+typename LocalHandlerPool<Handler, Allocator>::Cell LocalHandlerPool<Handler, Allocator>::MakeCell(
+    Handler&& handler)
+{
+  if (!free_block_ptrs_.empty()) {
+    HandlerBlock* const block_ptr = free_block_ptrs_.back();
+    block_ptr->handler = std::move(handler);
+    block_ptr->num_refs = 1u;
+    free_block_ptrs_.pop_back();
+    return Cell(block_ptr);
+  }
+  if (free_block_ptrs_.capacity() <= num_blocks_) {
+    free_block_ptrs_.reserve(2u * num_blocks_ + 1u);
+  }
+  using BlockAllocator =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<HandlerBlock>;
+  BlockAllocator block_allocator(static_cast<const Allocator&>(*this));
+  HandlerBlock* const block_ptr = std::allocator_traits<BlockAllocator>::allocate(block_allocator, 1u);
+  try {
+    ::new (static_cast<void*>(block_ptr)) HandlerBlock(std::move(handler), this);
+  }
+  catch (...) {
+    std::allocator_traits<BlockAllocator>::deallocate(block_allocator, block_ptr, 1u);
+    throw;
+  }
+  ++num_blocks_;
+  return Cell(block_ptr);
+}
+
+template <typename Handler, typename Allocator>
+void LocalHandlerPool<Handler, Allocator>::Recycle_(HandlerBlock* block_ptr)
+{
+  // Drop the handler now, rather than when the block is reused
+  block_ptr->handler = nullptr;
+  block_ptr->blocked = false;
+  free_block_ptrs_.push_back(block_ptr);
+}
+
+inline CallFrame::CallFrame(const ConnectionState* state_ptr)
+    : state_ptr_(state_ptr), next_ptr_(Top_())
+{
+  Top_() = this;
+}
+
+inline CallFrame::~CallFrame()
+{
+  Top_() = next_ptr_;
+}
+
+inline std::size_t CallFrame::CountCalls(const ConnectionState* state_ptr)
+{
+  std::size_t num_calls = 0u;
+  for (const CallFrame* frame_ptr = Top_(); frame_ptr; frame_ptr = frame_ptr->next_ptr_) {
+    if (frame_ptr->state_ptr_ == state_ptr) {
+      ++num_calls;
+    }
+  }
+  return num_calls;
+}
+
+inline const CallFrame*& CallFrame::Top_()
+{
+  static thread_local const CallFrame* top_ptr = nullptr;
+  return top_ptr;
+}
+
+inline BlockingDisconnectToken::BlockingDisconnectToken(
+    std::shared_ptr<ConnectionState>&& state_ptr)
+    : state_ptr_(std::move(state_ptr))
+{
+  // Do nothing
+}
+
+inline void BlockingDisconnectToken::Wait()
+{
+  if (!state_ptr_) {
+    return;
+  }
+  state_ptr_->connected.store(false);
+  // Calls on this thread are waiting on us (e.g., a handler disconnecting itself)
+  const std::size_t num_own_calls = CallFrame::CountCalls(state_ptr_.get());
+  while (state_ptr_->num_calls.load() > num_own_calls) {
+    std::this_thread::yield();
+  }
+  state_ptr_.reset();
+}
+
+template <typename DisconnectToken, typename Allocator>
+DisconnectTokenList<DisconnectToken, Allocator>::DisconnectTokenList(const Allocator& allocator)
+    : disconnect_tokens_(TokenAllocator(allocator))
+{
+  // Do nothing
+}
+
+template <typename DisconnectToken, typename Allocator>
+void DisconnectTokenList<DisconnectToken, Allocator>::Add(DisconnectToken&& disconnect_token)
+{
+  disconnect_tokens_.push_back(std::move(disconnect_token));
+}
+
+template <typename DisconnectToken, typename Allocator>
+void DisconnectTokenList<DisconnectToken, Allocator>::Wait()
+{
+  for (DisconnectToken& disconnect_token : disconnect_tokens_) {
+    disconnect_token.Wait();
+  }
+  disconnect_tokens_.clear();
+}
+
+template <typename Handler>
+SharedHandlerCell<Handler>::SharedHandlerCell(Handler&& handler)
+    : block_ptr_(std::make_shared<HandlerBlock>(std::move(handler)))
+{
+  // Do nothing
+}
+
+template <typename Handler>
+template <typename Allocator>
+SharedHandlerCell<Handler>::SharedHandlerCell(Handler&& handler, const Allocator& allocator)
+    : block_ptr_(std::allocate_shared<HandlerBlock>(allocator, std::move(handler)))
+{
+  // Do nothing
+}
+
+template <typename Handler>
+template <typename Visitor>
+bool SharedHandlerCell<Handler>::Visit(Visitor&& visitor) const
+{
+  HandlerBlock& block = *block_ptr_;
+  // Skipping a blocked handler needs no ordering, blocking doesn't promise to wait
+  if (block.blocked.load(std::memory_order_relaxed)) {
+    return false;
+  }
+  // Count the call before checking the connection, so a disconnect will wait for it
+  block.num_calls.fetch_add(1u);
+  struct CallGuard {
+    ~CallGuard()
+    {
+      block.num_calls.fetch_sub(1u);
+    }
+
+    HandlerBlock& block;
+  } call_guard{block};
+  if (!block.connected.load()) {
+    return false;
+  }
+  const CallFrame call_frame(&block);
+  visitor(static_cast<const Handler&>(block.handler));
+  return true;
+}
+
+template <typename Handler>
+typename SharedHandlerCell<Handler>::DisconnectToken SharedHandlerCell<Handler>::Disconnect()
+{
+  return DisconnectToken(std::move(block_ptr_));
+}
+
+template <typename Handler>
+bool SharedHandlerCell<Handler>::IsBlocked() const
+{
+  return block_ptr_->blocked.load(std::memory_order_relaxed);
+}
+
+template <typename Handler>
+void SharedHandlerCell<Handler>::SetBlocked(bool blocked)
+{
+  block_ptr_->blocked.store(blocked, std::memory_order_relaxed);
+}
+
+template <typename Handler, typename Allocator>
+SharedHandlerPool<Handler, Allocator>::SharedHandlerPool(const Allocator& allocator)
+    : Allocator(allocator)
+{
+  // Do nothing
+}
+
+template <typename Handler, typename Allocator>
+typename SharedHandlerPool<Handler, Allocator>::Cell SharedHandlerPool<Handler, Allocator>::MakeCell(
+    Handler&& handler)
+{
+  return Cell(std::move(handler), static_cast<const Allocator&>(*this));
+}
+
+}  // namespace detail
+}  // namespace tsig
+
+#endif  // TSIG_THREADING_HPP
@@ -0,0 +1,572 @@
+// Copyright (c) 2021 Tim Perkins
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// “Software”), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TSIG_TN_EXECUTOR_HPP
+#define TSIG_TN_EXECUTOR_HPP
+
+#include <tsig/delegate.hpp>
+#include <tsig/tn/queue.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace tsig {
+namespace tn {
+
+// Big enough for a message with a small value
+static constexpr std::size_t MAILBOX_MESSAGE_INLINE_SIZE = 8u * sizeof(void*);
+
+// The most messages a mailbox runs before letting other mailboxes run
+static constexpr std::size_t MAILBOX_BATCH_SIZE = 64u;
+
+class Executor;
+
+namespace detail {
+
+class MailboxState;
+
+}  // namespace detail
+
+// Messages posted to a mailbox are run in posting order, one at a time, on the threads of the
+// executor which made it
+class Mailbox {
+  friend class Executor;
+  friend class MailboxReceiver;
+
+ public:
+  using Message = Delegate<void(void), MAILBOX_MESSAGE_INLINE_SIZE>;
+
+  Mailbox() = default;
+
+  // Posting to an empty mailbox does nothing
+  void Post(Message&& message) const;
+  bool IsEmpty() const;
+
+ private:
+  explicit Mailbox(const std::shared_ptr<detail::MailboxState>& state_ptr);
+
+  std::shared_ptr<detail::MailboxState> state_ptr_;
+};
+
+// Receives handler calls as messages in a mailbox. Once the receiver is destroyed, no more
+// messages are received, and any received message running on another thread is waited for
+class MailboxReceiver {
+ public:
+  MailboxReceiver() = default;
+  explicit MailboxReceiver(const Mailbox& mailbox);
+  MailboxReceiver(const MailboxReceiver&) = delete;
+  MailboxReceiver(MailboxReceiver&& receiver) = default;
+  ~MailboxReceiver();
+
+  MailboxReceiver& operator=(const MailboxReceiver&) = delete;
+  MailboxReceiver& operator=(MailboxReceiver&& receiver);
+
+  bool IsEmpty() const;
+  // The handler is called from the mailbox with a copy of the value
+  template <typename T>
+  std::function<void(const T&)> Receive(const std::function<void(const T&)>& handler) const;
+  // Like receiving, but the values wait in a bounded queue (drained by the mailbox) rather than
+  // in the mailbox itself, so a slow receiver holds back or drops the values of a fast sender.
+  // The queue is closed with the receiver
+  template <typename T>
+  std::function<void(const T&)> ReceiveQueued(
+      const std::function<void(const T&)>& handler,
+      const std::shared_ptr<detail::BoundedQueue<T>>& queue_ptr);
+
+ private:
+  template <typename T>
+  struct ReceivedHandler {
+    std::shared_ptr<const std::atomic<bool>> open_ptr;
+    std::function<void(const T&)> handler;
+  };
+
+  template <typename T>
+  struct ReceivedMessage {
+    void operator()() const;
+
+    std::shared_ptr<const ReceivedHandler<T>> received_handler_ptr;
+    T value;
+  };
+
+  template <typename T>
+  struct QueueDrain {
+    void operator()() const;
+
+    Mailbox mailbox;
+    std::shared_ptr<const ReceivedHandler<T>> received_handler_ptr;
+    std::shared_ptr<detail::BoundedQueue<T>> queue_ptr;
+  };
+
+  void Close_();
+
+  Mailbox mailbox_;
+  std::shared_ptr<std::atomic<bool>> open_ptr_;
+  std::vector<std::shared_ptr<detail::QueueCore>> queue_core_ptrs_;
+};
+
+// Runs mailboxes on a pool of threads. Each thread takes ready mailboxes from its own queue
+// first, then steals from the others, so independent mailboxes run in parallel
+class Executor {
+  friend class detail::MailboxState;
+
+ public:
+  // Called on the executor's thread with anything thrown by a message, after which the mailbox
+  // runs its next message. Without one, anything thrown terminates
+  using ErrorHandler = std::function<void(std::exception_ptr)>;
+
+  // Zero threads means one per core
+  explicit Executor(std::size_t num_threads = 0u,
+                    const ErrorHandler& error_handler = ErrorHandler());
+  Executor(const Executor&) = delete;
+  Executor(Executor&&) = delete;
+  // Stops the threads once their running messages finish, dropping any messages not yet run
+  // (the executor must outlive its mailboxes being posted to)
+  ~Executor();
+
+  Executor& operator=(const Executor&) = delete;
+  Executor& operator=(Executor&&) = delete;
+
+  Mailbox MakeMailbox();
+  std::size_t NumThreads() const;
+  // Blocks until every message posted (including by messages being run) has run, which must
+  // not be called from the executor's threads
+  void WaitIdle();
+
+ private:
+  struct Worker {
+    std::mutex mutex;
+    std::deque<std::shared_ptr<detail::MailboxState>> ready_mailbox_ptrs;
+    std::thread thread;
+  };
+
+  struct WorkerContext {
+    const Executor* executor_ptr;
+    std::size_t worker_index;
+  };
+
+  static WorkerContext& CurrentWorker_();
+
+  // Yielding mailboxes go to the front, so mailboxes which just got a message run first
+  void Schedule_(std::shared_ptr<detail::MailboxState>&& mailbox_ptr, bool yielding);
+  bool TryTake_(std::size_t worker_index, std::shared_ptr<detail::MailboxState>& mailbox_ptr);
+  void RunWorker_(std::size_t worker_index);
+  void AddPending_();
+  void FinishPending_();
+  void HandleError_(std::exception_ptr error_ptr) const;
+
+  ErrorHandler error_handler_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::atomic<std::size_t> next_worker_index_{0u};
+  std::atomic<std::size_t> num_ready_{0u};
+  std::atomic<std::size_t> num_sleeping_{0u};
+  std::atomic<bool> stopped_{false};
+  std::mutex sleep_mutex_;
+  std::condition_variable wake_condition_;
+  std::atomic<std::size_t> num_pending_{0u};
+  std::mutex idle_mutex_;
+  std::condition_variable idle_condition_;
+};
+
+namespace detail {
+
+class MailboxState : public std::enable_shared_from_this<MailboxState> {
+ public:
+  using Message = Mailbox::Message;
+
+  explicit MailboxState(Executor* executor_ptr);
+
+  void Post(Message&& message);
+  // Runs a batch of messages, rescheduling the mailbox if there are more
+  void Run();
+  // Waits until no message is running, unless it's running on this thread
+  void WaitNotRunning();
+
+ private:
+  void FinishRunning_();
+
+  Executor* executor_ptr_;
+  std::mutex mutex_;
+  std::condition_variable not_running_condition_;
+  std::deque<Message> messages_;
+  bool scheduled_ = false;
+  std::thread::id running_thread_id_;
+  std::size_t num_running_waiters_ = 0u;
+};
+
+}  // namespace detail
+
+inline Mailbox::Mailbox(const std::shared_ptr<detail::MailboxState>& state_ptr)
+    : state_ptr_(state_ptr)
+{
+  // Do nothing
+}
+
+inline void Mailbox::Post(Message&& message) const
+{
+  if (state_ptr_) {
+    state_ptr_->Post(std::move(message));
+  }
+}
+
+inline bool Mailbox::IsEmpty() const
+{
+  return !state_ptr_;
+}
+
+inline MailboxReceiver::MailboxReceiver(const Mailbox& mailbox)
+    : mailbox_(mailbox), open_ptr_(std::make_shared<std::atomic<bool>>(true))
+{
+  // Do nothing
+}
+
+inline MailboxReceiver::~MailboxReceiver()
+{
+  Close_();
+}
+
+inline MailboxReceiver& MailboxReceiver::operator=(MailboxReceiver&& receiver)
+{
+  if (this != &receiver) {
+    Close_();
+    mailbox_ = std::move(receiver.mailbox_);
+    open_ptr_ = std::move(receiver.open_ptr_);
+    queue_core_ptrs_ = std::move(receiver.queue_core_ptrs_);
+  }
+  return *this;
+}
+
+inline bool MailboxReceiver::IsEmpty() const
+{
+  return !open_ptr_;
+}
+
+template <typename T>
+std::function<void(const T&)> MailboxReceiver::Receive(
+    const std::function<void(const T&)>& handler) const
+{
+  const std::shared_ptr<const ReceivedHandler<T>> received_handler_ptr =
+      std::make_shared<ReceivedHandler<T>>(ReceivedHandler<T>{open_ptr_, handler});
+  const Mailbox mailbox = mailbox_;
+  return [mailbox, received_handler_ptr](const T& value) {
+    mailbox.Post(ReceivedMessage<T>{received_handler_ptr, value});
+  };
+}
+
+template <typename T>
+std::function<void(const T&)> MailboxReceiver::ReceiveQueued(
+    const std::function<void(const T&)>& handler,
+    const std::shared_ptr<detail::BoundedQueue<T>>& queue_ptr)
+{
+  queue_core_ptrs_.push_back(queue_ptr);
+  const std::shared_ptr<const ReceivedHandler<T>> received_handler_ptr =
+      std::make_shared<ReceivedHandler<T>>(ReceivedHandler<T>{open_ptr_, handler});
+  const Mailbox mailbox = mailbox_;
+  return [mailbox, received_handler_ptr, queue_ptr](const T& value) {
+    if (queue_ptr->Push(value)) {
+      mailbox.Post(QueueDrain<T>{mailbox, received_handler_ptr, queue_ptr});
+    }
+  };
+}
+
+template <typename T>
+void MailboxReceiver::ReceivedMessage<T>::operator()() const
+{
+  if (received_handler_ptr->open_ptr->load(std::memory_order_acquire)) {
+    received_handler_ptr->handler(value);
+  }
+}
+
+template <typename T>
+void MailboxReceiver::QueueDrain<T>::operator()() const
+{
+  T value;
+  for (std::size_t ii = 0; ii < MAILBOX_BATCH_SIZE; ++ii) {
+    if (!queue_ptr->Pop(value)) {
+      return;
+    }
+    if (received_handler_ptr->open_ptr->load(std::memory_order_acquire)) {
+      received_handler_ptr->handler(value);
+    }
+  }
+  // Let the other messages in the mailbox run before draining the rest
+  mailbox.Post(QueueDrain<T>(*this));
+}
+
+inline void MailboxReceiver::Close_()
+{
+  if (!open_ptr_) {
+    return;
+  }
+  open_ptr_->store(false, std::memory_order_release);
+  // Blocked senders would otherwise wait forever
+  for (const std::shared_ptr<detail::QueueCore>& queue_core_ptr : queue_core_ptrs_) {
+    queue_core_ptr->Close();
+  }
+  queue_core_ptrs_.clear();
+  if (mailbox_.state_ptr_) {
+    mailbox_.state_ptr_->WaitNotRunning();
+  }
+  open_ptr_ = nullptr;
+  mailbox_ = Mailbox();
+}
+
+inline Executor::Executor(std::size_t num_threads, const ErrorHandler& error_handler)
+    : error_handler_(error_handler)
+{
+  if (num_threads == 0u) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (std::size_t ii = 0; ii < num_threads; ++ii) {
+    workers_.emplace_back(new Worker());
+  }
+  // Start the threads once all the workers exist, since they steal from each other
+  for (std::size_t ii = 0; ii < num_threads; ++ii) {
+    workers_[ii]->thread = std::thread([this, ii]() { RunWorker_(ii); });
+  }
+}
+
+inline Executor::~Executor()
+{
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    stopped_.store(true);
+    wake_condition_.notify_all();
+  }
+  for (const std::unique_ptr<Worker>& worker_ptr : workers_) {
+    worker_ptr->thread.join();
+  }
+}
+
+inline Mailbox Executor::MakeMailbox()
+{
+  return Mailbox(std::make_shared<detail::MailboxState>(this));
+}
+
+inline std::size_t Executor::NumThreads() const
+{
+  return workers_.size();
+}
+
+inline void Executor::WaitIdle()
+{
+  std::unique_lock<std::mutex> lock(idle_mutex_);
+  idle_condition_.wait(lock, [this]() { return num_pending_.load() == 0u; });
+}
+
+inline Executor::WorkerContext& Executor::CurrentWorker_()
+{
+  static thread_local WorkerContext worker_context = {nullptr, 0u};
+  return worker_context;
+}
+
+inline void Executor::Schedule_(std::shared_ptr<detail::MailboxState>&& mailbox_ptr,
+                                bool yielding)
+{
+  // Keep work on the scheduling thread if it's one of ours, so it's still hot in the cache
+  const WorkerContext& worker_context = CurrentWorker_();
+  const std::size_t worker_index =
+      (worker_context.executor_ptr == this)
+          ? worker_context.worker_index
+          : next_worker_index_.fetch_add(1u, std::memory_order_relaxed) % workers_.size();
+  Worker& worker = *workers_[worker_index];
+  {
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (yielding) {
+      worker.ready_mailbox_ptrs.push_front(std::move(mailbox_ptr));
+    }
+    else {
+      worker.ready_mailbox_ptrs.push_back(std::move(mailbox_ptr));
+    }
+  }
+  num_ready_.fetch_add(1u);
+  // Pairs with the workers counting themselves as sleeping before checking for ready mailboxes
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (num_sleeping_.load() != 0u) {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    wake_condition_.notify_one();
+  }
+}
+
+inline bool Executor::TryTake_(std::size_t worker_index,
+                               std::shared_ptr<detail::MailboxState>& mailbox_ptr)
+{
+  // Take the newest of our own, or steal the oldest of another's
+  for (std::size_t ii = 0; ii < workers_.size(); ++ii) {
+    Worker& worker = *workers_[(worker_index + ii) % workers_.size()];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.ready_mailbox_ptrs.empty()) {
+      continue;
+    }
+    if (ii == 0u) {
+      mailbox_ptr = std::move(worker.ready_mailbox_ptrs.back());
+      worker.ready_mailbox_ptrs.pop_back();
+    }
+    else {
+      mailbox_ptr = std::move(worker.ready_mailbox_ptrs.front());
+      worker.ready_mailbox_ptrs.pop_front();
+    }
+    num_ready_.fetch_sub(1u);
+    return true;
+  }
+  return false;
+}
+
+inline void Executor::RunWorker_(std::size_t worker_index)
+{
+  CurrentWorker_() = {this, worker_index};
+  std::shared_ptr<detail::MailboxState> mailbox_ptr;
+  // Checked before taking any mailbox, or mailboxes which post to themselves would never stop
+  while (!stopped_.load()) {
+    if (TryTake_(worker_index, mailbox_ptr)) {
+      mailbox_ptr->Run();
+      mailbox_ptr = nullptr;
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    num_sleeping_.fetch_add(1u);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    wake_condition_.wait(lock, [this]() { return stopped_.load() || num_ready_.load() != 0u; });
+    num_sleeping_.fetch_sub(1u);
+  }
+}
+
+inline void Executor::AddPending_()
+{
+  num_pending_.fetch_add(1u);
+}
+
+inline void Executor::FinishPending_()
+{
+  if (num_pending_.fetch_sub(1u) == 1u) {
+    std::lock_guard<std::mutex> lock(idle_mutex_);
+    idle_condition_.notify_all();
+  }
+}
+
+inline void Executor::HandleError_(std::exception_ptr error_ptr) const
+{
+  if (!error_handler_) {
+    std::terminate();
+  }
+  error_handler_(error_ptr);
+}
+
+namespace detail {
+
+inline MailboxState::MailboxState(Executor* executor_ptr) : executor_ptr_(executor_ptr)
+{
+  // Do nothing
+}
+
+inline void MailboxState::Post(Message&& message)
+{
+  executor_ptr_->AddPending_();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    messages_.push_back(std::move(message));
+    // Already scheduled mailboxes will run the message with the others
+    if (scheduled_) {
+      return;
+    }
+    scheduled_ = true;
+  }
+  executor_ptr_->Schedule_(shared_from_this(), false);
+}
+
+inline void MailboxState::Run()
+{
+  for (std::size_t ii = 0; ii < MAILBOX_BATCH_SIZE; ++ii) {
+    // The executor is being destroyed, so the rest of the messages are dropped
+    if (executor_ptr_->stopped_.load()) {
+      return;
+    }
+    Message message;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (messages_.empty()) {
+        scheduled_ = false;
+        return;
+      }
+      message = std::move(messages_.front());
+      messages_.pop_front();
+      running_thread_id_ = std::this_thread::get_id();
+    }
+    // Finished however the message ends, or waiters would wait forever
+    struct RunGuard {
+      ~RunGuard()
+      {
+        message = nullptr;
+        state.FinishRunning_();
+      }
+
+      MailboxState& state;
+      Message& message;
+    } run_guard{*this, message};
+    try {
+      message();
+    }
+    catch (...) {
+      executor_ptr_->HandleError_(std::current_exception());
+    }
+  }
+  // Still scheduled, so nothing else can schedule it in the meantime
+  executor_ptr_->Schedule_(shared_from_this(), true);
+}
+
+inline void MailboxState::FinishRunning_()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_thread_id_ = std::thread::id();
+    if (num_running_waiters_ != 0u) {
+      not_running_condition_.notify_all();
+    }
+  }
+  executor_ptr_->FinishPending_();
+}
+
+inline void MailboxState::WaitNotRunning()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (running_thread_id_ == std::this_thread::get_id()) {
+    return;
+  }
+  ++num_running_waiters_;
+  not_running_condition_.wait(lock, [this]() { return running_thread_id_ == std::thread::id(); });
+  --num_running_waiters_;
+}
+
+}  // namespace detail
+}  // namespace tn
+}  // namespace tsig
+
+#endif  // TSIG_TN_EXECUTOR_HPP
@@ -0,0 +1,303 @@
+// Copyright (c) 2021 Tim Perkins
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// “Software”), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TSIG_TN_MESSAGE_POOL_HPP
+#define TSIG_TN_MESSAGE_POOL_HPP
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace tsig {
+namespace tn {
+
+namespace detail {
+
+template <typename T>
+class MessagePoolState;
+
+}  // namespace detail
+
+// Recycles messages, so a steady flow of messages never allocates. Acquired messages return to
+// the pool when the last pointer to them is dropped (on any thread), without being destroyed, so
+// they keep their capacity. The pool is a handle, and copies share the same messages
+template <typename T>
+class MessagePool {
+ public:
+  MessagePool();
+
+  // The message was used before, so anything which isn't overwritten must be cleared
+  std::shared_ptr<T> Acquire() const;
+  // Makes sure there are this many free messages
+  void Reserve(std::size_t num_messages) const;
+  // Also prepares any new messages, like reserving their capacity up front
+  template <typename Prepare>
+  void Reserve(std::size_t num_messages, Prepare prepare) const;
+  std::size_t NumFree() const;
+
+ private:
+  std::shared_ptr<detail::MessagePoolState<T>> state_ptr_;
+};
+
+namespace detail {
+
+template <typename T>
+class MessagePoolState : public std::enable_shared_from_this<MessagePoolState<T>> {
+ public:
+  // Returns messages to the pool, rather than deleting them
+  struct Recycler {
+    void operator()(T* message_ptr) const;
+
+    std::shared_ptr<MessagePoolState> state_ptr;
+  };
+
+  // Allocates the shared pointer control blocks from the pool
+  template <typename U>
+  struct BlockAllocator {
+    using value_type = U;
+
+    explicit BlockAllocator(const std::shared_ptr<MessagePoolState>& state_ptr);
+    template <typename V>
+    BlockAllocator(const BlockAllocator<V>& allocator);
+
+    U* allocate(std::size_t num_values);
+    void deallocate(U* value_ptr, std::size_t num_values);
+
+    template <typename V>
+    bool operator==(const BlockAllocator<V>& allocator) const;
+    template <typename V>
+    bool operator!=(const BlockAllocator<V>& allocator) const;
+
+    std::shared_ptr<MessagePoolState> state_ptr;
+  };
+
+  MessagePoolState() = default;
+  MessagePoolState(const MessagePoolState&) = delete;
+  ~MessagePoolState();
+
+  MessagePoolState& operator=(const MessagePoolState&) = delete;
+
+  std::shared_ptr<T> Acquire();
+  template <typename Prepare>
+  void Reserve(std::size_t num_messages, Prepare& prepare);
+  std::size_t NumFree() const;
+
+ private:
+  void* AllocateBlock_(std::size_t size);
+  void DeallocateBlock_(void* block_ptr, std::size_t size);
+
+  // Released from any thread which drops the last pointer
+  mutable std::mutex mutex_;
+  std::vector<T*> free_message_ptrs_;
+  // Control blocks are all the same size, which is known once the first is allocated
+  std::size_t block_size_ = 0u;
+  std::vector<void*> free_block_ptrs_;
+};
+
+}  // namespace detail
+
+template <typename T>
+MessagePool<T>::MessagePool() : state_ptr_(std::make_shared<detail::MessagePoolState<T>>())
+{
+  // Do nothing
+}
+
+template <typename T>
+std::shared_ptr<T> MessagePool<T>::Acquire() const
+{
+  return state_ptr_->Acquire();
+}
+
+template <typename T>
+void MessagePool<T>::Reserve(std::size_t num_messages) const
+{
+  Reserve(num_messages, [](T&) {});
+}
+
+template <typename T>
+template <typename Prepare>
+void MessagePool<T>::Reserve(std::size_t num_messages, Prepare prepare) const
+{
+  state_ptr_->Reserve(num_messages, prepare);
+}
+
+template <typename T>
+std::size_t MessagePool<T>::NumFree() const
+{
+  return state_ptr_->NumFree();
+}
+
+namespace detail {
+
+template <typename T>
+void MessagePoolState<T>::Recycler::operator()(T* message_ptr) const
+{
+  std::lock_guard<std::mutex> lock(state_ptr->mutex_);
+  state_ptr->free_message_ptrs_.push_back(message_ptr);
+}
+
+template <typename T>
+template <typename U>
+MessagePoolState<T>::BlockAllocator<U>::BlockAllocator(
+    const std::shared_ptr<MessagePoolState>& state_ptr)
+    : state_ptr(state_ptr)
+{
+  // Do nothing
+}
+
+template <typename T>
+template <typename U>
+template <typename V>
+MessagePoolState<T>::BlockAllocator<U>::BlockAllocator(const BlockAllocator<V>& allocator)
+    : state_ptr(allocator.state_ptr)
+{
+  // Do nothing
+}
+
+template <typename T>
+template <typename U>
+U* MessagePoolState<T>::BlockAllocator<U>::allocate(std::size_t num_values)
+{
+  return static_cast<U*>(state_ptr->AllocateBlock_(num_values * sizeof(U)));
+}
+
+template <typename T>
+template <typename U>
+void MessagePoolState<T>::BlockAllocator<U>::deallocate(U* value_ptr, std::size_t num_values)
+{
+  state_ptr->DeallocateBlock_(value_ptr, num_values * sizeof(U));
+}
+
+template <typename T>
+template <typename U>
+template <typename V>
+bool MessagePoolState<T>::BlockAllocator<U>::operator==(const BlockAllocator<V>& allocator) const
+{
+  return state_ptr == allocator.state_ptr;
+}
+
+template <typename T>
+template <typename U>
+template <typename V>
+bool MessagePoolState<T>::BlockAllocator<U>::operator!=(const BlockAllocator<V>& allocator) const
+{
+  return state_ptr != allocator.state_ptr;
+}
+
+template <typename T>
+MessagePoolState<T>::~MessagePoolState()
+{
+  // Only free messages are left, since acquired messages keep the pool alive
+  for (T* const message_ptr : free_message_ptrs_) {
+    delete message_ptr;
+  }
+  for (void* const block_ptr : free_block_ptrs_) {
+    ::operator delete(block_ptr);
+  }
+}
+
+template <typename T>
+std::shared_ptr<T> MessagePoolState<T>::Acquire()
+{
+  T* message_ptr = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!free_message_ptrs_.empty()) {
+      message_ptr = free_message_ptrs_.back();
+      free_message_ptrs_.pop_back();
+    }
+  }
+  if (!message_ptr) {
+    message_ptr = new T();
+  }
+  // If the control block can't be allocated, the message is recycled
+  const std::shared_ptr<MessagePoolState> state_ptr = this->shared_from_this();
+  return std::shared_ptr<T>(message_ptr, Recycler{state_ptr}, BlockAllocator<T>(state_ptr));
+}
+
+template <typename T>
+template <typename Prepare>
+void MessagePoolState<T>::Reserve(std::size_t num_messages, Prepare& prepare)
+{
+  // Acquire them all at once, so their control blocks are allocated too
+  std::vector<std::shared_ptr<T>> message_ptrs;
+  message_ptrs.reserve(num_messages);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_message_ptrs_.reserve(num_messages);
+    while (free_message_ptrs_.size() < num_messages) {
+      std::unique_ptr<T> message_ptr(new T());
+      prepare(*message_ptr);
+      free_message_ptrs_.push_back(message_ptr.release());
+    }
+    free_block_ptrs_.reserve(num_messages);
+  }
+  for (std::size_t ii = 0; ii < num_messages; ++ii) {
+    message_ptrs.push_back(Acquire());
+  }
+}
+
+template <typename T>
+std::size_t MessagePoolState<T>::NumFree() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return free_message_ptrs_.size();
+}
+
+template <typename T>
+void* MessagePoolState<T>::AllocateBlock_(std::size_t size)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (block_size_ == 0u) {
+      block_size_ = size;
+    }
+    if (size == block_size_ && !free_block_ptrs_.empty()) {
+      void* const block_ptr = free_block_ptrs_.back();
+      free_block_ptrs_.pop_back();
+      return block_ptr;
+    }
+  }
+  return ::operator new(size);
+}
+
+template <typename T>
+void MessagePoolState<T>::DeallocateBlock_(void* block_ptr, std::size_t size)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (size == block_size_) {
+      free_block_ptrs_.push_back(block_ptr);
+      return;
+    }
+  }
+  ::operator delete(block_ptr);
+}
+
+}  // namespace detail
+}  // namespace tn
+}  // namespace tsig
+
+#endif  // TSIG_TN_MESSAGE_POOL_HPP
@@ -24,6 +24,13 @@
 #define TSIG_TN_NODE_HPP
 
 #include <tsig/signal.hpp>
+#include <tsig/tn/executor.hpp>
+#include <tsig/tn/message_pool.hpp>
+#include <tsig/tn/queue.hpp>
+
+#include <array>
+#include <memory>
+#include <tuple>
 
 #if defined(__GNUC__) && (__GNUC__ >= 4)
 #define TSIG_CHECK_RESULT __attribute__((warn_unused_result))
@@ -36,13 +43,58 @@
 namespace tsig {
 namespace tn {
 
+// Used as part of the node type DSL, for ports of immutable shared data. The producer allocates
+// the data once, and consumers can keep it without copying
+template <typename T>
+struct Shared {
+  // Empty
+};
+
+// Sinks of shared ports also hand out messages from the port's pool, to be filled and sent
+template <typename T>
+class SharedDataSink {
+ public:
+  using Send = std::function<void(const std::shared_ptr<const T>&)>;
+
+  SharedDataSink() = default;
+  explicit SharedDataSink(const Send& send);
+
+  void operator()(const std::shared_ptr<const T>& data_ptr) const;
+  std::shared_ptr<T> Acquire() const;
+  const MessagePool<T>& GetPool() const;
+
+ private:
+  Send send_;
+  MessagePool<T> pool_;
+};
+
+namespace detail {
+
+template <typename T>
+struct PortDataOf {
+  using type = T;
+  using Sink = std::function<void(const T&)>;
+};
+
+template <typename T>
+struct PortDataOf<Shared<T>> {
+  using type = std::shared_ptr<const T>;
+  using Sink = SharedDataSink<T>;
+};
+
+}  // namespace detail
+
+// The data carried by a port (which is a shared pointer for shared ports)
+template <typename T>
+using PortData = typename detail::PortDataOf<T>::type;
+
 // Handlers are used to receive data from other nodes
 template <typename T>
-using DataHandler = std::function<void(const T&)>;
+using DataHandler = std::function<void(const PortData<T>&)>;
 
 // Sinks are used to send data to other node
 template <typename T>
-using DataSink = std::function<void(const T&)>;
+using DataSink = typename detail::PortDataOf<T>::Sink;
 
 // Connectors are used to accept connections
 template <typename T>
@@ -92,23 +144,52 @@ class Node<WithInputs<InputTypes...>, WithOutputs<OutputTypes...>> {
   template <size_t output_index>
   DataSink<OutputAt<output_index>> GetSink();
 
+  // Handlers of nodes run on an executor are called in the mailbox (which can be shared by a
+  // group of nodes) rather than by the emitting thread. The outputs are then emitted from the
+  // executor's threads, so they become multi threaded. Must be called before accepting or
+  // connecting
+  void RunOn(const Mailbox& mailbox);
+  void RunOn(Executor& executor);
+
   template <size_t input_index>
   void Accept(const DataConnector<InputAt<input_index>>& connector);
   template <size_t input_index, typename U>
   void Accept(U& connectable);
+  // Nodes run on an executor queue the input values in a bounded queue, rather than the mailbox
+  // (other nodes call their handlers directly, so there's nothing to queue)
+  template <size_t input_index>
+  void Accept(const DataConnector<InputAt<input_index>>& connector, const QueueOptions& options);
+  template <size_t input_index, typename U>
+  void Accept(U& connectable, const QueueOptions& options);
 
   template <size_t output_index>
   TSIG_CHECK_RESULT tsig::Sigcon Connect(const DataHandler<OutputAt<output_index>>& handler);
   template <size_t output_index, size_t input_index, typename U>
   void Connect(U& acceptable);
+  template <size_t output_index, size_t input_index, typename U>
+  void Connect(U& acceptable, const QueueOptions& options);
+
+  // All zero unless the input was accepted with a queue
+  template <size_t input_index>
+  QueueStats GetQueueStats() const;
 
  private:
   static constexpr size_t num_inputs = sizeof...(InputTypes);
   static constexpr size_t num_outputs = sizeof...(OutputTypes);
 
+  using OutputSignals = std::tuple<tsig::Signal<void(const PortData<OutputTypes>&)>...>;
+  using MultiThreadedOutputSignals =
+      std::tuple<tsig::Signal<void(const PortData<OutputTypes>&), tsig::MultiThreaded>...>;
+
+  // Destroyed last, after disconnecting from the inputs
+  MailboxReceiver receiver_;
   std::array<tsig::Sigcon, num_inputs> sigcons_;
-  std::tuple<typename tsig::Signal<void(const InputTypes&)>::Handler...> handlers_;
-  std::tuple<tsig::Signal<void(const OutputTypes&)>...> signals_;
+  // Closed before disconnecting from the inputs, which waits for any blocked senders
+  std::array<detail::QueueCloser, num_inputs> queue_closers_;
+  std::tuple<DataHandler<InputTypes>...> handlers_;
+  OutputSignals signals_;
+  // Used instead once run on an executor (multi threaded signals aren't free when idle)
+  std::unique_ptr<MultiThreadedOutputSignals> multi_threaded_signals_ptr_;
 };
 
 // Used to construct a node from a task
@@ -149,6 +230,30 @@ GetAllDataSinks(NodeType&, std::tuple<T...>&);
 
 }  // namespace detail
 
+template <typename T>
+SharedDataSink<T>::SharedDataSink(const Send& send) : send_(send)
+{
+  // Do nothing
+}
+
+template <typename T>
+void SharedDataSink<T>::operator()(const std::shared_ptr<const T>& data_ptr) const
+{
+  send_(data_ptr);
+}
+
+template <typename T>
+std::shared_ptr<T> SharedDataSink<T>::Acquire() const
+{
+  return pool_.Acquire();
+}
+
+template <typename T>
+const MessagePool<T>& SharedDataSink<T>::GetPool() const
+{
+  return pool_;
+}
+
 template <typename... InputTypes, typename... OutputTypes>
 template <size_t input_index>
 void Node<WithInputs<InputTypes...>, WithOutputs<OutputTypes...>>::RegisterHandler(
@@ -163,9 +268,30 @@ DataSink<typename Node<WithInputs<InputTypes...>,
                        WithOutputs<OutputTypes...>>::template OutputAt<output_index>>
 Node<WithInputs<InputTypes...>, WithOutputs<OutputTypes...>>::GetSink()
 {
-  return [this](const OutputAt<output_index>& value) {  //
-    std::get<output_index>(signals_).Emit(value);
-  };
+  return DataSink<OutputAt<output_index>>(
+      [this](const PortData<OutputAt<output_index>>& value) {
+        if (multi_threaded_signals_ptr_) {
+          std::get<output_index>(*multi_threaded_signals_ptr_).Emit(value);
+        }
+        else {
+          std::get<output_index>(signals_).Emit(value);
+        }
+      });
+}
+
+template <typename... InputTypes, typename... OutputTypes>
+void Node<WithInputs<InputTypes...>, WithOutputs<OutputTypes...>>::RunOn(const Mailbox& mailbox)
+{
+  receiver_ = MailboxReceiver(mailbox);
+  if (!multi_threaded_signals_ptr_) {
+    multi_threaded_signals_ptr_.reset(new MultiThreadedOutputSignals());
+  }
+}
+
+template <typename... InputTypes, typename... OutputTypes>
+void Node<WithInputs<InputTypes...>, WithOutputs<OutputTypes...>>::RunOn(Executor& executor)
+{
+  RunOn(executor.MakeMailbox());
 }
 
 template <typename... InputTypes, typename... OutputTypes>
@@ -173,7 +299,14 @@ template <size_t input_index>
 void Node<WithInputs<InputTypes...>, WithOutputs<OutputTypes...>>::Accept(
     const DataConnector<InputAt<input_index>>& connector)
 {
-  std::get<input_index>(sigcons_) = connector(std::get<input_index>(handlers_));
+  if (receiver_.IsEmpty()) {
+    std::get<input_index>(sigcons_) = connector(std::get<input_index>(handlers_));
+  }
+  else {
+    std::get<input_index>(sigcons_) =
+        connector(receiver_.Receive<PortData<InputAt<input_index>>>(
+            std::get<input_index>(handlers_)));
+  }
 }
 
 template <typename... InputTypes, typename... OutputTypes>
@@ -186,11 +319,43 @@ void Node<WithInputs<InputTypes...>, WithOutputs<OutputTypes...>>::Accept(U& con
       });
 }
 
+template <typename... InputTypes, typename... OutputTypes>
+template <size_t input_index>
+void Node<WithInputs<InputTypes...>, WithOutputs<OutputTypes...>>::Accept(
+    const DataConnector<InputAt<input_index>>& connector, const QueueOptions& options)
+{
+  if (receiver_.IsEmpty()) {
+    Accept<input_index>(connector);
+    return;
+  }
+  using Data = PortData<InputAt<input_index>>;
+  const std::shared_ptr<detail::BoundedQueue<Data>> queue_ptr =
+      std::make_shared<detail::BoundedQueue<Data>>(options);
+  std::get<input_index>(queue_closers_) = detail::QueueCloser(queue_ptr);
+  std::get<input_index>(sigcons_) =
+      connector(receiver_.ReceiveQueued<Data>(std::get<input_index>(handlers_), queue_ptr));
+}
+
+template <typename... InputTypes, typename... OutputTypes>
+template <size_t input_index, typename U>
+void Node<WithInputs<InputTypes...>, WithOutputs<OutputTypes...>>::Accept(
+    U& connectable, const QueueOptions& options)
+{
+  Accept<input_index>(
+      [&connectable](const DataHandler<InputAt<input_index>>& handler) -> tsig::Sigcon {
+        return connectable.Connect(handler);
+      },
+      options);
+}
+
 template <typename... InputTypes, typename... OutputTypes>
 template <size_t output_index>
 tsig::Sigcon Node<WithInputs<InputTypes...>, WithOutputs<OutputTypes...>>::Connect(
     const DataHandler<OutputAt<output_index>>& handler)
 {
+  if (multi_threaded_signals_ptr_) {
+    return std::get<output_index>(*multi_threaded_signals_ptr_).Connect(handler);
+  }
   return std::get<output_index>(signals_).Connect(handler);
 }
 
@@ -204,6 +369,25 @@ void Node<WithInputs<InputTypes...>, WithOutputs<OutputTypes...>>::Connect(U& ac
       });
 }
 
+template <typename... InputTypes, typename... OutputTypes>
+template <size_t output_index, size_t input_index, typename U>
+void Node<WithInputs<InputTypes...>, WithOutputs<OutputTypes...>>::Connect(
+    U& acceptable, const QueueOptions& options)
+{
+  acceptable.template Accept<input_index>(
+      [this](const DataHandler<OutputAt<output_index>>& handler) -> tsig::Sigcon {
+        return Connect<output_index>(handler);
+      },
+      options);
+}
+
+template <typename... InputTypes, typename... OutputTypes>
+template <size_t input_index>
+QueueStats Node<WithInputs<InputTypes...>, WithOutputs<OutputTypes...>>::GetQueueStats() const
+{
+  return std::get<input_index>(queue_closers_).GetStats();
+}
+
 template <typename... InputTypes, typename... OutputTypes>
 template <typename TaskType>
 typename NodeBuilder<Node<WithInputs<InputTypes...>, WithOutputs<OutputTypes...>>>::NodeType
@@ -0,0 +1,275 @@
+// Copyright (c) 2021 Tim Perkins
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// “Software”), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TSIG_TN_QUEUE_HPP
+#define TSIG_TN_QUEUE_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace tsig {
+namespace tn {
+
+// Enough to ride out a short stall of the consumer
+static constexpr std::size_t DEFAULT_QUEUE_CAPACITY = 16u;
+
+// What a full queue does with another value. Blocking producers which run on the same executor
+// as their consumer can deadlock, if every thread ends up blocked
+enum class OverflowPolicy { BLOCK, DROP_OLDEST, DROP_NEWEST, KEEP_LATEST };
+
+// How values are queued between an output and an input run on an executor. Keeping the latest
+// value is like dropping the oldest, with a capacity of one
+struct QueueOptions {
+  explicit QueueOptions(OverflowPolicy overflow_policy = OverflowPolicy::BLOCK,
+                        std::size_t capacity = DEFAULT_QUEUE_CAPACITY);
+
+  OverflowPolicy overflow_policy;
+  std::size_t capacity;
+};
+
+struct QueueStats {
+  std::size_t capacity;
+  std::size_t size;
+  // The most values which were ever queued at once
+  std::size_t high_water_mark;
+  std::uint64_t num_pushed;
+  std::uint64_t num_dropped;
+  // Pushes which waited for room
+  std::uint64_t num_blocked;
+};
+
+namespace detail {
+
+// The untyped part of a bounded queue, which can be closed and looked at without the type
+class QueueCore {
+ public:
+  explicit QueueCore(const QueueOptions& options);
+  QueueCore(const QueueCore&) = delete;
+
+  QueueCore& operator=(const QueueCore&) = delete;
+
+  // Wakes any blocked producers, and drops anything pushed afterwards
+  void Close();
+  QueueStats GetStats() const;
+
+ protected:
+  // Blocks if that's the policy, and returns false if there's still no room
+  bool WaitForRoom_(std::unique_lock<std::mutex>& lock);
+  bool DropsOldest_() const;
+
+  mutable std::mutex mutex_;
+  std::condition_variable not_full_condition_;
+  const OverflowPolicy overflow_policy_;
+  const std::size_t capacity_;
+  std::size_t size_ = 0u;
+  bool closed_ = false;
+  // Set while a drain is on its way, so only one is ever posted
+  bool draining_ = false;
+  std::size_t high_water_mark_ = 0u;
+  std::uint64_t num_pushed_ = 0u;
+  std::uint64_t num_dropped_ = 0u;
+  std::uint64_t num_blocked_ = 0u;
+};
+
+// A bounded queue of values, with room for all of them made up front. Values are pushed by the
+// producers and popped by one consumer, which drains the queue
+template <typename T>
+class BoundedQueue : public QueueCore {
+ public:
+  explicit BoundedQueue(const QueueOptions& options);
+
+  // Returns true if the queue needs draining (then it won't again until it's drained)
+  bool Push(const T& value);
+  // Returns false once the queue is drained
+  bool Pop(T& value);
+
+ private:
+  std::vector<T> values_;
+  std::size_t begin_ = 0u;
+};
+
+// Closes the queue when destroyed or replaced, so nothing stays blocked on a queue which is no
+// longer drained
+class QueueCloser {
+ public:
+  QueueCloser() = default;
+  explicit QueueCloser(const std::shared_ptr<QueueCore>& queue_core_ptr);
+  QueueCloser(const QueueCloser&) = delete;
+  QueueCloser(QueueCloser&& closer) = default;
+  ~QueueCloser();
+
+  QueueCloser& operator=(const QueueCloser&) = delete;
+  QueueCloser& operator=(QueueCloser&& closer);
+
+  // All zero without a queue
+  QueueStats GetStats() const;
+
+ private:
+  void Close_();
+
+  std::shared_ptr<QueueCore> queue_core_ptr_;
+};
+
+}  // namespace detail
+
+inline QueueOptions::QueueOptions(OverflowPolicy overflow_policy, std::size_t capacity)
+    : overflow_policy(overflow_policy), capacity(capacity)
+{
+  // Do nothing
+}
+
+namespace detail {
+
+inline QueueCore::QueueCore(const QueueOptions& options)
+    : overflow_policy_(options.overflow_policy),
+      capacity_(options.overflow_policy == OverflowPolicy::KEEP_LATEST
+                    ? 1u
+                    : std::max<std::size_t>(options.capacity, 1u))
+{
+  // Do nothing
+}
+
+inline void QueueCore::Close()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  closed_ = true;
+  not_full_condition_.notify_all();
+}
+
+inline QueueStats QueueCore::GetStats() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return {capacity_, size_, high_water_mark_, num_pushed_, num_dropped_, num_blocked_};
+}
+
+inline bool QueueCore::WaitForRoom_(std::unique_lock<std::mutex>& lock)
+{
+  if (size_ < capacity_) {
+    return true;
+  }
+  if (overflow_policy_ != OverflowPolicy::BLOCK) {
+    return false;
+  }
+  ++num_blocked_;
+  not_full_condition_.wait(lock, [this]() { return closed_ || size_ < capacity_; });
+  return !closed_;
+}
+
+inline bool QueueCore::DropsOldest_() const
+{
+  return overflow_policy_ == OverflowPolicy::DROP_OLDEST
+         || overflow_policy_ == OverflowPolicy::KEEP_LATEST;
+}
+
+inline QueueCloser::QueueCloser(const std::shared_ptr<QueueCore>& queue_core_ptr)
+    : queue_core_ptr_(queue_core_ptr)
+{
+  // Do nothing
+}
+
+inline QueueCloser::~QueueCloser()
+{
+  Close_();
+}
+
+inline QueueCloser& QueueCloser::operator=(QueueCloser&& closer)
+{
+  if (this != &closer) {
+    Close_();
+    queue_core_ptr_ = std::move(closer.queue_core_ptr_);
+  }
+  return *this;
+}
+
+inline QueueStats QueueCloser::GetStats() const
+{
+  return queue_core_ptr_ ? queue_core_ptr_->GetStats() : QueueStats{0u, 0u, 0u, 0u, 0u, 0u};
+}
+
+inline void QueueCloser::Close_()
+{
+  if (queue_core_ptr_) {
+    queue_core_ptr_->Close();
+    queue_core_ptr_ = nullptr;
+  }
+}
+
+template <typename T>
+BoundedQueue<T>::BoundedQueue(const QueueOptions& options) : QueueCore(options)
+{
+  values_.resize(capacity_);
+}
+
+template <typename T>
+bool BoundedQueue<T>::Push(const T& value)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (closed_) {
+    ++num_dropped_;
+    return false;
+  }
+  if (!WaitForRoom_(lock)) {
+    ++num_dropped_;
+    if (closed_ || !DropsOldest_()) {
+      return false;
+    }
+    // The oldest value is overwritten by this one
+    begin_ = (begin_ + 1u) % capacity_;
+    --size_;
+  }
+  values_[(begin_ + size_) % capacity_] = value;
+  ++size_;
+  ++num_pushed_;
+  high_water_mark_ = std::max(high_water_mark_, size_);
+  if (draining_) {
+    return false;
+  }
+  draining_ = true;
+  return true;
+}
+
+template <typename T>
+bool BoundedQueue<T>::Pop(T& value)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (size_ == 0u) {
+    draining_ = false;
+    return false;
+  }
+  value = std::move(values_[begin_]);
+  begin_ = (begin_ + 1u) % capacity_;
+  --size_;
+  not_full_condition_.notify_one();
+  return true;
+}
+
+}  // namespace detail
+}  // namespace tn
+}  // namespace tsig
+
+#endif  // TSIG_TN_QUEUE_HPP
@@ -0,0 +1,508 @@
+// Copyright (c) 2021 Tim Perkins
+
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// “Software”), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TSIG_TN_SYNCHRONIZER_HPP
+#define TSIG_TN_SYNCHRONIZER_HPP
+
+#include <tsig/signal.hpp>
+#include <tsig/tn/node.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace tsig {
+namespace tn {
+
+// Enough to cover a little jitter between inputs running at the same rate
+static constexpr std::size_t DEFAULT_SYNC_QUEUE_SIZE = 8u;
+
+// Gets the stamp (like a timestamp or a sequence number) of a message from its stamp member
+struct StampMember {
+  template <typename T>
+  auto operator()(const T& message) const -> decltype(message.stamp);
+};
+
+// Matches messages with equal stamps
+template <std::size_t QueueSize = DEFAULT_SYNC_QUEUE_SIZE, typename StampOf = StampMember>
+struct ExactTime {
+  static constexpr std::size_t QUEUE_SIZE = QueueSize;
+
+  explicit ExactTime(const StampOf& stamp_of = StampOf());
+
+  template <typename Stamp>
+  bool IsMatch(const Stamp& oldest_stamp, const Stamp& newest_stamp) const;
+
+  StampOf stamp_of;
+};
+
+// Matches messages with stamps no more than the max interval apart. Messages are matched as soon
+// as they are close enough, rather than waiting for a closer match
+template <typename Interval, std::size_t QueueSize = DEFAULT_SYNC_QUEUE_SIZE,
+          typename StampOf = StampMember>
+struct ApproximateTime {
+  static constexpr std::size_t QUEUE_SIZE = QueueSize;
+
+  explicit ApproximateTime(const Interval& max_interval, const StampOf& stamp_of = StampOf());
+
+  template <typename Stamp>
+  bool IsMatch(const Stamp& oldest_stamp, const Stamp& newest_stamp) const;
+
+  Interval max_interval;
+  StampOf stamp_of;
+};
+
+// Matches the latest message of every input whenever any input receives a message (once they
+// all have one), without looking at stamps
+struct Latest {
+  // Empty
+};
+
+namespace detail {
+
+// A fixed size queue of port data, which never allocates
+template <typename T, std::size_t SIZE>
+class SyncQueue {
+ public:
+  SyncQueue() = default;
+
+  bool IsEmpty() const;
+  bool IsFull() const;
+  std::size_t Size() const;
+  const T& At(std::size_t index) const;
+  // Must not be full
+  void Push(const T& value);
+  // Must not be empty
+  void Pop();
+
+ private:
+  std::array<T, SIZE> values_;
+  std::size_t begin_ = 0u;
+  std::size_t size_ = 0u;
+};
+
+// Calls a synchronizer handler, for the input at the index
+template <typename SyncType, std::size_t input_index>
+struct SyncInputHandler {
+  template <typename Data>
+  void operator()(const Data& data) const;
+
+  SyncType* sync_ptr;
+};
+
+// The message carried by port data (which is pointed to for shared ports)
+template <typename T>
+const T& MessageOf(const T& data);
+template <typename T>
+const T& MessageOf(const std::shared_ptr<const T>& data_ptr);
+
+// Values keep their memory to be reused, but shared data is released to its producer
+template <typename T>
+void ReleasePortData(T& data);
+template <typename T>
+void ReleasePortData(std::shared_ptr<const T>& data_ptr);
+
+}  // namespace detail
+
+// Joins the messages of many inputs, and calls one fused handler with each match. The handlers
+// must be called one at a time (like the handlers of a node), and each input must receive its
+// messages in stamp order. Messages are buffered in fixed size queues, so nothing is allocated
+// after construction
+template <typename Policy, typename... InputTypes>
+class Synchronizer {
+  static_assert(sizeof...(InputTypes) > 0u, "Synchronizers need at least one input");
+
+ public:
+  template <size_t input_index>
+  using InputAt = typename std::tuple_element<input_index, std::tuple<InputTypes...>>::type;
+  using FusedHandler = std::function<void(const PortData<InputTypes>&...)>;
+
+  explicit Synchronizer(const FusedHandler& fused_handler, const Policy& policy = Policy());
+  // The handlers point to the synchronizer
+  Synchronizer(const Synchronizer&) = delete;
+
+  Synchronizer& operator=(const Synchronizer&) = delete;
+
+  // To be registered with the node (or combined with other handlers by the task)
+  DataHandlerTuple<InputTypes...> GetHandlers();
+  template <size_t input_index>
+  void Handle(const PortData<InputAt<input_index>>& data);
+
+  std::size_t NumMatched() const;
+  // Messages which were never matched, because they were too old or their queue was full
+  std::size_t NumDropped() const;
+
+ private:
+  static constexpr size_t num_inputs = sizeof...(InputTypes);
+
+  using Indices = typename tsig::detail::MakeIndexSequence<num_inputs>::type;
+  using Stamp = typename std::decay<decltype(std::declval<const Policy&>().stamp_of(
+      detail::MessageOf(std::declval<const PortData<InputAt<0>>&>())))>::type;
+
+  template <std::size_t... indices>
+  DataHandlerTuple<InputTypes...> GetHandlers_(tsig::detail::IndexSequence<indices...>);
+  template <std::size_t... indices>
+  void Match_(tsig::detail::IndexSequence<indices...>);
+  template <std::size_t input_index>
+  Stamp StampAt_(std::size_t index) const;
+  template <std::size_t input_index>
+  void SkipTo_(const Stamp& stamp);
+  template <std::size_t input_index>
+  void PopIf_(bool is_popped);
+
+  FusedHandler fused_handler_;
+  Policy policy_;
+  std::tuple<detail::SyncQueue<PortData<InputTypes>, Policy::QUEUE_SIZE>...> queues_;
+  std::size_t num_matched_ = 0u;
+  std::size_t num_dropped_ = 0u;
+};
+
+// Keeps only the latest message of each input
+template <typename... InputTypes>
+class Synchronizer<Latest, InputTypes...> {
+  static_assert(sizeof...(InputTypes) > 0u, "Synchronizers need at least one input");
+
+ public:
+  template <size_t input_index>
+  using InputAt = typename std::tuple_element<input_index, std::tuple<InputTypes...>>::type;
+  using FusedHandler = std::function<void(const PortData<InputTypes>&...)>;
+
+  explicit Synchronizer(const FusedHandler& fused_handler, const Latest& policy = Latest());
+  // The handlers point to the synchronizer
+  Synchronizer(const Synchronizer&) = delete;
+
+  Synchronizer& operator=(const Synchronizer&) = delete;
+
+  // To be registered with the node (or combined with other handlers by the task)
+  DataHandlerTuple<InputTypes...> GetHandlers();
+  template <size_t input_index>
+  void Handle(const PortData<InputAt<input_index>>& data);
+
+  std::size_t NumMatched() const;
+  // Messages replaced before every input had one
+  std::size_t NumDropped() const;
+
+ private:
+  static constexpr size_t num_inputs = sizeof...(InputTypes);
+
+  using Indices = typename tsig::detail::MakeIndexSequence<num_inputs>::type;
+
+  template <std::size_t... indices>
+  DataHandlerTuple<InputTypes...> GetHandlers_(tsig::detail::IndexSequence<indices...>);
+  template <std::size_t... indices>
+  void Match_(tsig::detail::IndexSequence<indices...>);
+
+  FusedHandler fused_handler_;
+  std::tuple<PortData<InputTypes>...> latest_data_;
+  std::array<bool, num_inputs> has_latest_data_;
+  std::size_t num_missing_ = num_inputs;
+  std::size_t num_matched_ = 0u;
+  std::size_t num_dropped_ = 0u;
+};
+
+template <typename T>
+auto StampMember::operator()(const T& message) const -> decltype(message.stamp)
+{
+  return message.stamp;
+}
+
+template <std::size_t QueueSize, typename StampOf>
+ExactTime<QueueSize, StampOf>::ExactTime(const StampOf& stamp_of) : stamp_of(stamp_of)
+{
+  // Do nothing
+}
+
+template <std::size_t QueueSize, typename StampOf>
+template <typename Stamp>
+bool ExactTime<QueueSize, StampOf>::IsMatch(const Stamp& oldest_stamp,
+                                            const Stamp& newest_stamp) const
+{
+  return !(oldest_stamp < newest_stamp);
+}
+
+template <typename Interval, std::size_t QueueSize, typename StampOf>
+ApproximateTime<Interval, QueueSize, StampOf>::ApproximateTime(const Interval& max_interval,
+                                                               const StampOf& stamp_of)
+    : max_interval(max_interval), stamp_of(stamp_of)
+{
+  // Do nothing
+}
+
+template <typename Interval, std::size_t QueueSize, typename StampOf>
+template <typename Stamp>
+bool ApproximateTime<Interval, QueueSize, StampOf>::IsMatch(const Stamp& oldest_stamp,
+                                                            const Stamp& newest_stamp) const
+{
+  return !(max_interval < newest_stamp - oldest_stamp);
+}
+
+template <typename Policy, typename... InputTypes>
+Synchronizer<Policy, InputTypes...>::Synchronizer(const FusedHandler& fused_handler,
+                                                  const Policy& policy)
+    : fused_handler_(fused_handler), policy_(policy)
+{
+  // Do nothing
+}
+
+template <typename Policy, typename... InputTypes>
+DataHandlerTuple<InputTypes...> Synchronizer<Policy, InputTypes...>::GetHandlers()
+{
+  return GetHandlers_(Indices());
+}
+
+template <typename Policy, typename... InputTypes>
+template <size_t input_index>
+void Synchronizer<Policy, InputTypes...>::Handle(const PortData<InputAt<input_index>>& data)
+{
+  auto& queue = std::get<input_index>(queues_);
+  if (queue.IsFull()) {
+    queue.Pop();
+    ++num_dropped_;
+  }
+  queue.Push(data);
+  Match_(Indices());
+}
+
+template <typename Policy, typename... InputTypes>
+std::size_t Synchronizer<Policy, InputTypes...>::NumMatched() const
+{
+  return num_matched_;
+}
+
+template <typename Policy, typename... InputTypes>
+std::size_t Synchronizer<Policy, InputTypes...>::NumDropped() const
+{
+  return num_dropped_;
+}
+
+template <typename Policy, typename... InputTypes>
+template <std::size_t... indices>
+DataHandlerTuple<InputTypes...> Synchronizer<Policy, InputTypes...>::GetHandlers_(
+    tsig::detail::IndexSequence<indices...>)
+{
+  return DataHandlerTuple<InputTypes...>(
+      detail::SyncInputHandler<Synchronizer, indices>{this}...);
+}
+
+template <typename Policy, typename... InputTypes>
+template <std::size_t... indices>
+void Synchronizer<Policy, InputTypes...>::Match_(tsig::detail::IndexSequence<indices...>)
+{
+  while (true) {
+    const std::array<bool, num_inputs> is_empty = {{std::get<indices>(queues_).IsEmpty()...}};
+    if (std::find(is_empty.begin(), is_empty.end(), true) != is_empty.end()) {
+      return;
+    }
+    // Every input has a message at least as new as the newest of the oldest messages, so the
+    // candidates are the newest messages which aren't newer than that
+    const std::array<Stamp, num_inputs> oldest_stamps = {{StampAt_<indices>(0u)...}};
+    const Stamp newest_stamp = *std::max_element(oldest_stamps.begin(), oldest_stamps.end());
+    const int skipped[] = {(SkipTo_<indices>(newest_stamp), 0)...};
+    static_cast<void>(skipped);
+    const std::array<Stamp, num_inputs> stamps = {{StampAt_<indices>(0u)...}};
+    const auto oldest_iter = std::min_element(stamps.begin(), stamps.end());
+    if (policy_.IsMatch(*oldest_iter, newest_stamp)) {
+      fused_handler_(std::get<indices>(queues_).At(0u)...);
+      const int popped[] = {(std::get<indices>(queues_).Pop(), 0)...};
+      static_cast<void>(popped);
+      ++num_matched_;
+    }
+    else {
+      // The oldest candidate can't match any messages still to come either
+      const std::size_t oldest_index = static_cast<std::size_t>(oldest_iter - stamps.begin());
+      const int popped[] = {(PopIf_<indices>(indices == oldest_index), 0)...};
+      static_cast<void>(popped);
+      ++num_dropped_;
+    }
+  }
+}
+
+template <typename Policy, typename... InputTypes>
+template <std::size_t input_index>
+typename Synchronizer<Policy, InputTypes...>::Stamp Synchronizer<Policy, InputTypes...>::StampAt_(
+    std::size_t index) const
+{
+  return policy_.stamp_of(detail::MessageOf(std::get<input_index>(queues_).At(index)));
+}
+
+template <typename Policy, typename... InputTypes>
+template <std::size_t input_index>
+void Synchronizer<Policy, InputTypes...>::SkipTo_(const Stamp& stamp)
+{
+  auto& queue = std::get<input_index>(queues_);
+  while (queue.Size() > 1u && !(stamp < StampAt_<input_index>(1u))) {
+    queue.Pop();
+    ++num_dropped_;
+  }
+}
+
+template <typename Policy, typename... InputTypes>
+template <std::size_t input_index>
+void Synchronizer<Policy, InputTypes...>::PopIf_(bool is_popped)
+{
+  if (is_popped) {
+    std::get<input_index>(queues_).Pop();
+  }
+}
+
+template <typename... InputTypes>
+Synchronizer<Latest, InputTypes...>::Synchronizer(const FusedHandler& fused_handler,
+                                                  const Latest&)
+    : fused_handler_(fused_handler), has_latest_data_()
+{
+  // Do nothing
+}
+
+template <typename... InputTypes>
+DataHandlerTuple<InputTypes...> Synchronizer<Latest, InputTypes...>::GetHandlers()
+{
+  return GetHandlers_(Indices());
+}
+
+template <typename... InputTypes>
+template <size_t input_index>
+void Synchronizer<Latest, InputTypes...>::Handle(const PortData<InputAt<input_index>>& data)
+{
+  std::get<input_index>(latest_data_) = data;
+  if (!has_latest_data_[input_index]) {
+    has_latest_data_[input_index] = true;
+    --num_missing_;
+  }
+  else if (num_missing_ != 0u) {
+    ++num_dropped_;
+  }
+  if (num_missing_ == 0u) {
+    Match_(Indices());
+  }
+}
+
+template <typename... InputTypes>
+std::size_t Synchronizer<Latest, InputTypes...>::NumMatched() const
+{
+  return num_matched_;
+}
+
+template <typename... InputTypes>
+std::size_t Synchronizer<Latest, InputTypes...>::NumDropped() const
+{
+  return num_dropped_;
+}
+
+template <typename... InputTypes>
+template <std::size_t... indices>
+DataHandlerTuple<InputTypes...> Synchronizer<Latest, InputTypes...>::GetHandlers_(
+    tsig::detail::IndexSequence<indices...>)
+{
+  return DataHandlerTuple<InputTypes...>(
+      detail::SyncInputHandler<Synchronizer, indices>{this}...);
+}
+
+template <typename... InputTypes>
+template <std::size_t... indices>
+void Synchronizer<Latest, InputTypes...>::Match_(tsig::detail::IndexSequence<indices...>)
+{
+  fused_handler_(std::get<indices>(latest_data_)...);
+  ++num_matched_;
+}
+
+namespace detail {
+
+template <typename T, std::size_t SIZE>
+bool SyncQueue<T, SIZE>::IsEmpty() const
+{
+  return size_ == 0u;
+}
+
+template <typename T, std::size_t SIZE>
+bool SyncQueue<T, SIZE>::IsFull() const
+{
+  return size_ == SIZE;
+}
+
+template <typename T, std::size_t SIZE>
+std::size_t SyncQueue<T, SIZE>::Size() const
+{
+  return size_;
+}
+
+template <typename T, std::size_t SIZE>
+const T& SyncQueue<T, SIZE>::At(std::size_t index) const
+{
+  return values_[(begin_ + index) % SIZE];
+}
+
+template <typename T, std::size_t SIZE>
+void SyncQueue<T, SIZE>::Push(const T& value)
+{
+  values_[(begin_ + size_) % SIZE] = value;
+  ++size_;
+}
+
+template <typename T, std::size_t SIZE>
+void SyncQueue<T, SIZE>::Pop()
+{
+  ReleasePortData(values_[begin_]);
+  begin_ = (begin_ + 1u) % SIZE;
+  --size_;
+}
+
+template <typename SyncType, std::size_t input_index>
+template <typename Data>
+void SyncInputHandler<SyncType, input_index>::operator()(const Data& data) const
+{
+  sync_ptr->template Handle<input_index>(data);
+}
+
+template <typename T>
+const T& MessageOf(const T& data)
+{
+  return data;
+}
+
+template <typename T>
+const T& MessageOf(const std::shared_ptr<const T>& data_ptr)
+{
+  return *data_ptr;
+}
+
+template <typename T>
+void ReleasePortData(T&)
+{
+  // Do nothing
+}
+
+template <typename T>
+void ReleasePortData(std::shared_ptr<const T>& data_ptr)
+{
+  data_ptr = nullptr;
+}
+
+}  // namespace detail
+}  // namespace tn
+}  // namespace tsig
+
+#endif  // TSIG_TN_SYNCHRONIZER_HPP